@@ -0,0 +1,230 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "batch_board.h"
+#include "classes.h"
+#include "generator.h"
+#include "hal_native.h"
+
+/** Throughput of the batched board engine (src/batch_board.h) against Grid, on one core.
+ * Plays the same seeded boards to the end with random clicks on groups, in every lane engine the build has, then
+ * replays the clicks of every game through Grid::deleteSameColorNeighbors. The blocks every click removed, the final
+ * board, the score and the end of the game must be the same as with Grid, the program fails if they are not.
+ * Prints one JSON line per engine: moves per second and speedup over Grid.
+ * Usage: program [--games N] [--seed N] [--width N] [--height N] [--colors N] */
+
+// A game as the batch played it.
+struct PlayedGame
+{
+    std::vector<uint8_t> clicks;  // Cell of every move.
+    std::vector<uint8_t> removed; // Blocks every move removed.
+    PackedBoard finalBoard;
+    uint32_t score = 0;
+};
+
+// Play all boards to the end with random moves, LANES games at a time. Returns the games and the time it took.
+template <typename Lanes>
+static std::vector<PlayedGame> playBatch(const std::vector<PackedBoard> &boards, uint32_t seed, double &seconds,
+                                         long &numMoves)
+{
+    const int LANES = BatchBoards<Lanes>::LANES;
+    BatchBoards<Lanes> batch(boards[0].getWidth(), boards[0].getHeight());
+    batch.seed(seed);
+    std::vector<PlayedGame> games(boards.size());
+    int laneGame[LANES];       // Game in every lane, -1 once no game is left for it.
+    uint8_t clicks[LANES];
+    uint8_t removed[LANES];
+    size_t nextGame = 0;
+    numMoves = 0;
+
+    auto startTime = std::chrono::steady_clock::now();
+    for (int lane = 0; lane < LANES; lane++)
+    {
+        laneGame[lane] = nextGame < boards.size() ? nextGame : -1;
+        if (laneGame[lane] >= 0)
+        {
+            batch.load(lane, boards[nextGame++]);
+        }
+    }
+    for (;;)
+    {
+        batch.pickRandomMoves(clicks);
+
+        // A lane without a move has finished its game: it takes the next board and moves in the next round.
+        bool playing = false;
+        for (int lane = 0; lane < LANES; lane++)
+        {
+            if (laneGame[lane] >= 0 && clicks[lane] == EMPTY_CELL)
+            {
+                PlayedGame &game = games[laneGame[lane]];
+                batch.store(lane, game.finalBoard);
+                game.score = batch.getScore(lane);
+                laneGame[lane] = nextGame < boards.size() ? nextGame : -1;
+                if (laneGame[lane] >= 0)
+                {
+                    batch.load(lane, boards[nextGame++]);
+                }
+            }
+            if (laneGame[lane] < 0)
+            {
+                clicks[lane] = EMPTY_CELL;
+            }
+            playing = playing || laneGame[lane] >= 0;
+        }
+        if (!playing)
+        {
+            break;
+        }
+
+        numMoves += batch.play(clicks, removed);
+        for (int lane = 0; lane < LANES; lane++)
+        {
+            if (clicks[lane] != EMPTY_CELL)
+            {
+                games[laneGame[lane]].clicks.push_back(clicks[lane]);
+                games[laneGame[lane]].removed.push_back(removed[lane]);
+            }
+        }
+    }
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    return games;
+}
+
+// Replay the games through Grid. Returns the number of games that differ, and the time the moves took.
+static int replayGrid(const std::vector<PackedBoard> &boards, int numColors, const std::vector<PlayedGame> &games,
+                      double &seconds)
+{
+    int width = boards[0].getWidth();
+    int height = boards[0].getHeight();
+    Grid grid(width, height, numColors);
+    int numMismatches = 0;
+    seconds = 0;
+    for (size_t g = 0; g < boards.size(); g++)
+    {
+        const PlayedGame &game = games[g];
+        grid.setMatrix(boards[g]);
+        grid.setGameEnded(0);
+        bool same = true;
+        auto startTime = std::chrono::steady_clock::now();
+        for (size_t move = 0; move < game.clicks.size(); move++)
+        {
+            int scoreBefore = grid.getScore();
+            grid.placeCursor(game.clicks[move] / height, game.clicks[move] % height);
+            grid.deleteSameColorNeighbors();
+            grid.checkEndCondition();
+            same = same && grid.getScore() - scoreBefore == game.removed[move];
+        }
+        seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+        // The batch ends a game when no move is left, which is how Grid ends a game that is not won.
+        same = same && grid.anyPossibilityLeft() == 0 && grid.getScore() == (int)game.score;
+        for (int cellIndex = 0; cellIndex < width * height; cellIndex++)
+        {
+            same = same && grid.matrix[cellIndex] == game.finalBoard[cellIndex];
+        }
+        if (!same && numMismatches++ == 0)
+        {
+            fprintf(stderr, "game %zu differs from Grid\n", g);
+        }
+    }
+    return numMismatches;
+}
+
+// Play the games with one engine, check them against Grid and print its JSON line.
+template <typename Lanes>
+static bool runEngine(const char *name, const std::vector<PackedBoard> &boards, int numColors, uint32_t seed,
+                      double gridMovesPerSecond)
+{
+    double seconds;
+    long numMoves;
+    std::vector<PlayedGame> games = playBatch<Lanes>(boards, seed, seconds, numMoves);
+    double gridSeconds;
+    int numMismatches = replayGrid(boards, numColors, games, gridSeconds);
+    double movesPerSecond = numMoves / seconds;
+    double speedup = gridMovesPerSecond > 0 ? movesPerSecond / gridMovesPerSecond : 0;
+    printf("{\"engine\": \"%s\", \"lanes\": %d, \"games\": %zu, \"moves\": %ld, \"seconds\": %.3f, "
+           "\"moves_per_s\": %.0f, \"speedup\": %.2f, \"mismatches\": %d}\n",
+           name, BatchBoards<Lanes>::LANES, boards.size(), numMoves, seconds, movesPerSecond,
+           speedup, numMismatches);
+    return numMismatches == 0;
+}
+
+int main(int argc, char **argv)
+{
+    int numGames = 20000;
+    uint32_t seed = 1;
+    int width = 16;
+    int height = 6;
+    int numColors = 3;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--games") == 0)
+        {
+            numGames = atoi(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "--seed") == 0)
+        {
+            seed = strtoul(argv[i + 1], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--width") == 0)
+        {
+            width = atoi(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "--height") == 0)
+        {
+            height = atoi(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "--colors") == 0)
+        {
+            numColors = atoi(argv[i + 1]);
+        }
+    }
+    if (numGames < 1 || width < 1 || height < 1 || width * height > BATCH_MAX_CELLS || numColors < 1 ||
+        numColors > MAX_BLOCK_TYPES)
+    {
+        fprintf(stderr, "boards must have 1 to %d cells and 1 to %d colors\n", BATCH_MAX_CELLS, MAX_BLOCK_TYPES);
+        return 1;
+    }
+
+    // Grid needs the hardware abstraction layer, but draws nothing here.
+    FrameBufferDisplay display(SCREEN_WIDTH, SCREEN_HEIGHT);
+    ScriptedInput input;
+    MemoryStorage storage;
+    VirtualClock clock;
+    SeededRng rng(seed);
+    hal.display = &display;
+    hal.input = &input;
+    hal.storage = &storage;
+    hal.clock = &clock;
+    hal.rng = &rng;
+    storage.begin(MEM_SIZE);
+
+    std::vector<PackedBoard> boards(numGames, PackedBoard(width, height));
+    for (int g = 0; g < numGames; g++)
+    {
+        generateBoard(boards[g], numColors, seed + g);
+    }
+
+    // Grid is timed on the games of the scalar engine, the clicks do not change its speed much.
+    double seconds;
+    long numMoves;
+    std::vector<PlayedGame> games = playBatch<ScalarLanes>(boards, seed, seconds, numMoves);
+    double gridSeconds;
+    int numMismatches = replayGrid(boards, numColors, games, gridSeconds);
+    double gridMovesPerSecond = gridSeconds > 0 ? numMoves / gridSeconds : 0;
+    printf("{\"engine\": \"grid\", \"lanes\": 1, \"games\": %zu, \"moves\": %ld, \"seconds\": %.3f, "
+           "\"moves_per_s\": %.0f, \"speedup\": 1.00, \"mismatches\": %d}\n",
+           boards.size(), numMoves, gridSeconds, gridMovesPerSecond, numMismatches);
+
+    bool ok = numMismatches == 0;
+    ok = runEngine<ScalarLanes>("scalar", boards, numColors, seed, gridMovesPerSecond) && ok;
+#if defined(__SSE2__)
+    ok = runEngine<Sse2Lanes>("sse2", boards, numColors, seed, gridMovesPerSecond) && ok;
+#endif
+#if defined(__AVX2__)
+    ok = runEngine<Avx2Lanes>("avx2", boards, numColors, seed, gridMovesPerSecond) && ok;
+#endif
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,336 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+#include "classes.h"
+#include "hal_native.h"
+#include "save_format.h"
+
+/** Benchmark of the Grid hot paths on the host.
+ * Every operation runs once on each of a set of seeded random boards per size,
+ * and the results are written as JSON (ns/op, allocations/op, p50 and p99 latency).
+ * moveFrame is a whole move with the frame that shows it, and reports the cells the move changed:
+ * its cost follows those cells and the size of the view, not the size of the board.
+ * cursorStep is a step of the cursor that scrolls the view on boards bigger than the screen, with its frame.
+ * An operation that can not run on a size gets a row with the reason, no timings: saveGame over 255 columns or rows,
+ * or when the save does not fit before the move log of the BOARD_WIDTH x BOARD_HEIGHT layout (pio run -e bench builds
+ * with the largest layout, so every size up to 255 is saved).
+ * Usage: program [--boards N] [--seed N] [--out FILE] */
+
+// Allocation counting. Every operator new goes through here.
+// GCC cannot see that the replaced new and delete pair up through malloc and free.
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+static bool countAllocations = false;
+static long numAllocations = 0;
+
+void *operator new(size_t size)
+{
+    if (countAllocations)
+    {
+        numAllocations++;
+    }
+    void *memory = malloc(size ? size : 1);
+    if (memory == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete(void *memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept
+{
+    free(memory);
+}
+
+// Measurements of one operation on one board size.
+struct Result
+{
+    std::string name;
+    int width;
+    int height;
+    std::vector<double> latencies; // ns per call
+    long allocations = 0;
+    long changedCells = 0; // Cells changed by the measured moves.
+    const char *skipped = nullptr; // Why the operation can not run on this size, nullptr if it was measured.
+};
+
+// Time a single call of operation and add it to result.
+template <typename Operation>
+void measure(Result &result, Operation operation)
+{
+    numAllocations = 0;
+    countAllocations = true;
+    auto start = std::chrono::steady_clock::now();
+    operation();
+    auto end = std::chrono::steady_clock::now();
+    countAllocations = false;
+    result.allocations += numAllocations;
+    result.latencies.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+}
+
+// Percentile of sorted latencies.
+static double percentile(const std::vector<double> &sorted, double fraction)
+{
+    size_t index = (size_t)(fraction * (sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+/** Find a region of at least 2 blocks by trying cells in a seeded order.
+ * Returns false if the board has no move. */
+static bool findRegion(Grid &grid, std::vector<int> &region, int &startCol, int &startRow)
+{
+    PackedBoard &board = grid.matrix;
+    int width = board.getWidth();
+    int height = board.getHeight();
+    std::vector<uint8_t> visited(board.getNumCells());
+    for (int attempt = 0; attempt < board.getNumCells(); attempt++)
+    {
+        int cellIndex = (attempt * 7919 + hal.rng->nextInt(board.getNumCells())) % board.getNumCells();
+        if (board[cellIndex] == EMPTY_CELL)
+        {
+            continue;
+        }
+        std::fill(visited.begin(), visited.end(), 0);
+        region.assign(1, cellIndex);
+        visited[cellIndex] = 1;
+        for (size_t next = 0; next < region.size(); next++)
+        {
+            int col = region[next] / height;
+            int row = region[next] % height;
+            int neighbors[4][2] = {{col + 1, row}, {col - 1, row}, {col, row + 1}, {col, row - 1}};
+            for (auto &neighbor : neighbors)
+            {
+                if (neighbor[0] < 0 || neighbor[0] >= width || neighbor[1] < 0 || neighbor[1] >= height)
+                {
+                    continue;
+                }
+                int neighborIndex = board.index(neighbor[0], neighbor[1]);
+                if (!visited[neighborIndex] && board[neighborIndex] == board[cellIndex])
+                {
+                    visited[neighborIndex] = 1;
+                    region.push_back(neighborIndex);
+                }
+            }
+        }
+        if (region.size() >= 2)
+        {
+            startCol = cellIndex / height;
+            startRow = cellIndex % height;
+            return true;
+        }
+    }
+    return false;
+}
+
+int main(int argc, char **argv)
+{
+    int numBoards = 2000;
+    uint32_t seed = 1;
+    const char *outPath = nullptr;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--boards") == 0)
+        {
+            numBoards = atoi(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "--seed") == 0)
+        {
+            seed = strtoul(argv[i + 1], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--out") == 0)
+        {
+            outPath = argv[i + 1];
+        }
+    }
+
+    FrameBufferDisplay display(SCREEN_WIDTH, SCREEN_HEIGHT);
+    ScriptedInput input;
+    MemoryStorage storage;
+    VirtualClock clock;
+    SeededRng rng(seed);
+    hal.display = &display;
+    hal.input = &input;
+    hal.storage = &storage;
+    hal.clock = &clock;
+    hal.rng = &rng;
+
+    int sizes[][2] = {{16, 6}, {32, 16}, {64, 32}, {128, 128}, {256, 256}};
+    const char *names[] = {"deleteSameColorNeighbors", "updateBlocksPositions", "anyPossibilityLeft",
+                           "drawGrid", "saveGame", "undo", "redo", "moveFrame", "cursorStep"};
+    const int numOperations = sizeof(names) / sizeof(names[0]);
+    FrameSnapshot frame;
+    std::vector<Result> results;
+
+    for (auto &size : sizes)
+    {
+        int width = size[0];
+        int height = size[1];
+        int boards = numBoards;
+        fprintf(stderr, "%dx%d: %d boards\n", width, height, boards);
+
+        // Room for the largest save of this size.
+        storage.begin(SAVE_ADDRESS + maxSaveSize(width, height));
+
+        Result sizeResults[numOperations];
+        for (int i = 0; i < numOperations; i++)
+        {
+            sizeResults[i].name = names[i];
+            sizeResults[i].width = width;
+            sizeResults[i].height = height;
+            sizeResults[i].latencies.reserve(boards);
+        }
+        // saveGame returns without writing anything on these.
+        if (width > 255 || height > 255)
+        {
+            sizeResults[4].skipped = "boards over 255 columns or rows can not be saved"; // A dimension is a byte.
+        }
+        else if (SAVE_ADDRESS + (int)maxSaveSize(width, height) > LOG_ADDRESS)
+        {
+            sizeResults[4].skipped = "the save does not fit before the move log, build with a bigger BOARD_WIDTH";
+        }
+
+        std::vector<int> region;
+        std::vector<int> frameRegion;
+        for (int b = 0; b < boards; b++)
+        {
+            rng.randomize();
+            Grid grid(width, height, 3 + b % 3);
+            PackedBoard initial = grid.matrix;
+
+            measure(sizeResults[2], [&]
+                    { grid.anyPossibilityLeft(); });
+            // A full frame: the renderer forgets what is on the screen first.
+            renderer.invalidate();
+            measure(sizeResults[3], [&]
+                    { grid.drawGrid(); });
+            if (sizeResults[4].skipped == nullptr)
+            {
+                measure(sizeResults[4], [&]
+                        { grid.saveGame(); });
+            }
+
+            int startCol;
+            int startRow;
+            if (!findRegion(grid, region, startCol, startRow))
+            {
+                continue;
+            }
+
+            // A whole move from the cursor position.
+            grid.colCursor = startCol;
+            grid.rowCursor = startRow;
+            measure(sizeResults[0], [&]
+                    { grid.deleteSameColorNeighbors(); });
+
+            // Taking the move back and making it again from its diff.
+            measure(sizeResults[5], [&]
+                    { grid.undo(); });
+            measure(sizeResults[6], [&]
+                    { grid.redo(); });
+
+            // A move and its frame, once the screen shows the board.
+            if (findRegion(grid, frameRegion, startCol, startRow))
+            {
+                grid.placeCursor(startCol, startRow);
+                grid.fillSnapshot(frame);
+                renderer.drawFrame(frame);
+                PackedBoard before = grid.matrix;
+                measure(sizeResults[7], [&]
+                        {
+                            grid.deleteSameColorNeighbors();
+                            grid.fillSnapshot(frame);
+                            renderer.drawFrame(frame); });
+                for (int cellIndex = 0; cellIndex < before.getNumCells(); cellIndex++)
+                {
+                    sizeResults[7].changedCells += before[cellIndex] != grid.matrix[cellIndex];
+                }
+            }
+
+            // A step to the right from the last column before the view scrolls, and its frame.
+            grid.placeCursor(0, height - 1);
+            grid.fillSnapshot(frame);
+            grid.placeCursor(std::min(VIEW_COLS - VIEW_MARGIN - 1, width - 2), height - 1);
+            grid.fillSnapshot(frame);
+            renderer.drawFrame(frame);
+            measure(sizeResults[8], [&]
+                    {
+                        grid.moveCursor(1, 0);
+                        grid.fillSnapshot(frame);
+                        renderer.drawFrame(frame); });
+
+            // Only the collapse after the region was removed.
+            grid.setMatrix(initial);
+            grid.setGameEnded(0);
+            int mostLeftCol = width - 1;
+            int mostRightCol = 0;
+            for (int cellIndex : region)
+            {
+                grid.matrix[cellIndex] = EMPTY_CELL;
+                mostLeftCol = std::min(mostLeftCol, cellIndex / height);
+                mostRightCol = std::max(mostRightCol, cellIndex / height);
+            }
+            measure(sizeResults[1], [&]
+                    { grid.updateBlocksPositions(mostLeftCol, mostRightCol); });
+        }
+
+        for (Result &result : sizeResults)
+        {
+            results.push_back(result);
+        }
+    }
+
+    // Write the results as JSON.
+    FILE *out = outPath ? fopen(outPath, "w") : stdout;
+    if (out == nullptr)
+    {
+        fprintf(stderr, "could not open %s\n", outPath);
+        return 1;
+    }
+    fprintf(out, "{\n  \"seed\": %u,\n  \"benchmarks\": [\n", seed);
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        Result &result = results[i];
+        if (result.skipped)
+        {
+            fprintf(out, "    {\"name\": \"%s\", \"width\": %d, \"height\": %d, \"skipped\": \"%s\"}%s\n",
+                    result.name.c_str(), result.width, result.height, result.skipped,
+                    i + 1 < results.size() ? "," : "");
+            continue;
+        }
+        std::vector<double> sorted = result.latencies;
+        std::sort(sorted.begin(), sorted.end());
+        double total = 0;
+        for (double latency : sorted)
+        {
+            total += latency;
+        }
+        size_t ops = std::max<size_t>(sorted.size(), 1);
+        if (sorted.empty())
+        {
+            sorted.push_back(0);
+        }
+        fprintf(out,
+                "    {\"name\": \"%s\", \"width\": %d, \"height\": %d, \"ops\": %zu, "
+                "\"ns_per_op\": %.1f, \"allocs_per_op\": %.3f, \"changed_cells_per_op\": %.1f, "
+                "\"p50_ns\": %.1f, \"p99_ns\": %.1f}%s\n",
+                result.name.c_str(), result.width, result.height, result.latencies.size(),
+                total / ops, (double)result.allocations / ops, (double)result.changedCells / ops,
+                percentile(sorted, 0.50), percentile(sorted, 0.99),
+                i + 1 < results.size() ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+    if (out != stdout)
+    {
+        fclose(out);
+    }
+    return 0;
+}
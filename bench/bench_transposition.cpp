@@ -0,0 +1,195 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "classes.h"
+#include "hal_native.h"
+#include "solver.h"
+#include "transposition.h"
+
+/** Benchmark of the Zobrist hashing and of the transposition table, JSON lines on stdout.
+ *  - hash: random games through the Grid, with undos and redos, must keep the incremental hash equal to
+ *    a full rehash after every move. Prints the cost of both.
+ *  - solver: full searches of seeded boards keeping and leaving out the duplicate positions of a level: score,
+ *    nodes/s, duplicates left out.
+ *  - table: threads storing and probing the same slots must never read a mix of two entries.
+ * Usage: program [--boards N] [--seed N] [--threads N] */
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Play random games on the grid and compare the incremental hash with a full rehash after every change.
+static void benchHash(int width, int height, int numBoards, uint32_t seed)
+{
+    uint64_t numMoves = 0;
+    uint64_t numMismatches = 0;
+    double moveSeconds = 0;
+    double rehashSeconds = 0;
+    uint64_t sink = 0;
+    uint32_t rng = seed | 1;
+    auto nextRandom = [&rng](uint32_t bound)
+    {
+        rng ^= rng << 13;
+        rng ^= rng >> 17;
+        rng ^= rng << 5;
+        return (uint32_t)(((uint64_t)rng * bound) >> 32);
+    };
+
+    for (int i = 0; i < numBoards; i++)
+    {
+        Grid grid(width, height, 3 + i % 3, seed * 7919 + i);
+        numMismatches += grid.getHash() != grid.matrix.hash();
+        for (int attempt = 0; attempt < 4 * width * height && !grid.hasEnded(); attempt++)
+        {
+            grid.colCursor = nextRandom(width);
+            grid.rowCursor = nextRandom(height);
+            auto start = std::chrono::steady_clock::now();
+            bool moved = grid.deleteSameColorNeighbors();
+            moveSeconds += secondsSince(start);
+            if (!moved)
+            {
+                continue;
+            }
+            numMoves++;
+            if (nextRandom(8) == 0)
+            {
+                grid.undo();
+                numMismatches += grid.getHash() != grid.matrix.hash();
+                grid.redo();
+            }
+            start = std::chrono::steady_clock::now();
+            uint64_t full = grid.matrix.hash();
+            rehashSeconds += secondsSince(start);
+            sink += full;
+            numMismatches += grid.getHash() != full;
+        }
+    }
+    printf("{\"bench\": \"hash\", \"board\": \"%dx%d\", \"moves\": %llu, \"move_ns\": %.0f, \"rehash_ns\": %.0f, "
+           "\"mismatches\": %llu, \"sink\": %llu}\n",
+           width, height, (unsigned long long)numMoves, moveSeconds * 1e9 / numMoves, rehashSeconds * 1e9 / numMoves,
+           (unsigned long long)numMismatches, (unsigned long long)(sink & 1));
+}
+
+// Search seeded boards to the end of the widest beam, keeping and leaving out the duplicates.
+static void benchSolver(int width, int height, int numBoards, uint32_t seed)
+{
+    Solver solver;
+    for (int skipDuplicates = 0; skipDuplicates < 2; skipDuplicates++)
+    {
+        solver.setSkipDuplicates(skipDuplicates);
+        double totalScore = 0;
+        uint64_t numNodes = 0;
+        uint64_t numDuplicates = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < numBoards; i++)
+        {
+            PackedBoard board(width, height);
+            generateBoard(board, 3 + i % 3, seed * 7919 + i);
+            solver.start(board);
+            while (!solver.step(1000000))
+            {
+            }
+            totalScore += solver.getResult().score;
+            numNodes += solver.getResult().numNodes;
+            numDuplicates += solver.getResult().numDuplicates;
+        }
+        double seconds = secondsSince(start);
+        printf("{\"bench\": \"solver\", \"board\": \"%dx%d\", \"skip_duplicates\": %s, \"mean_score\": %.1f, "
+               "\"nodes\": %llu, \"nodes_per_s\": %.0f, \"duplicates\": %llu, \"hit_rate\": %.3f, \"seconds\": %.3f}\n",
+               width, height, skipDuplicates ? "true" : "false", totalScore / numBoards, (unsigned long long)numNodes,
+               numNodes / seconds, (unsigned long long)numDuplicates,
+               numNodes + numDuplicates ? (double)numDuplicates / (numNodes + numDuplicates) : 0.0, seconds);
+    }
+}
+
+// Threads store and probe keys that share few slots. Every hit must give back the entry stored for its key.
+static bool benchTable(int numThreads, int tableBits)
+{
+    TranspositionTable table(tableBits);
+    const uint64_t numOps = 1000000;
+    std::vector<std::thread> threads;
+    std::vector<uint64_t> hits(numThreads), torn(numThreads);
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < numThreads; t++)
+    {
+        threads.emplace_back([&, t]
+                             {
+                                 for (uint64_t i = 0; i < numOps; i++)
+                                 {
+                                     uint64_t key = zobristKey((i * 7 + t) % 4096, 0);
+                                     TranspositionEntry entry;
+                                     if (table.probe(key, entry))
+                                     {
+                                         hits[t]++;
+                                         torn[t] += entry.score != (int32_t)(uint32_t)key || entry.move != (int)(key >> 48) % 1000;
+                                     }
+                                     entry.score = (int32_t)(uint32_t)key;
+                                     entry.depth = 1;
+                                     entry.move = (int)(key >> 48) % 1000;
+                                     table.store(key, entry);
+                                 } });
+    }
+    uint64_t totalHits = 0;
+    uint64_t totalTorn = 0;
+    for (int t = 0; t < numThreads; t++)
+    {
+        threads[t].join();
+        totalHits += hits[t];
+        totalTorn += torn[t];
+    }
+    double seconds = secondsSince(start);
+    printf("{\"bench\": \"table\", \"threads\": %d, \"slots\": %llu, \"ops_per_s\": %.0f, \"hit_rate\": %.3f, \"torn\": %llu}\n",
+           numThreads, (unsigned long long)table.getNumSlots(), numThreads * numOps / seconds,
+           (double)totalHits / (numThreads * numOps), (unsigned long long)totalTorn);
+    return totalTorn == 0;
+}
+
+int main(int argc, char **argv)
+{
+    int numBoards = 50;
+    uint32_t seed = 1;
+    int numThreads = 4;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--boards") == 0)
+        {
+            numBoards = atoi(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "--seed") == 0)
+        {
+            seed = strtoul(argv[i + 1], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--threads") == 0)
+        {
+            numThreads = atoi(argv[i + 1]);
+        }
+    }
+
+    FrameBufferDisplay display(SCREEN_WIDTH, SCREEN_HEIGHT);
+    ScriptedInput input;
+    MemoryStorage storage;
+    VirtualClock clock;
+    SeededRng rng(seed);
+    hal.display = &display;
+    hal.input = &input;
+    hal.storage = &storage;
+    hal.clock = &clock;
+    hal.rng = &rng;
+    storage.begin(MEM_SIZE);
+
+    const int sizes[][2] = {{16, 6}, {32, 16}, {64, 32}};
+    for (const auto &size : sizes)
+    {
+        benchHash(size[0], size[1], numBoards, seed);
+    }
+    for (const auto &size : sizes)
+    {
+        benchSolver(size[0], size[1], size[0] * size[1] > 128 ? numBoards / 10 + 1 : numBoards, seed);
+    }
+    bool ok = benchTable(numThreads, 10);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,522 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <queue>
+#include <utility>
+#include <vector>
+#include "batch_board.h"
+#include "classes.h"
+#include "fixed_board.h"
+#include "generator.h"
+#include "hal_native.h"
+#include "moves.h"
+
+/** Differential fuzz target: every board engine against a frozen reference of the game rules.
+ * ReferenceGrid is the move logic of the original Grid (deleteSameColorNeighbors, updateRows, updateColumns,
+ * anyPossibilityLeft), kept as it was: a matrix of optional blocks, a breadth-first search with a queue, and the
+ * two collapse passes. An input is a board and a sequence of clicks. They are played on the reference and in
+ * lockstep on Grid, on MoveGenerator with a PackedBoard, on the fixed-size Board when the size has one and on
+ * lane 0 of BatchBoards. After every click the boards, the removed blocks, the score, the moves left, the end of
+ * the game and the Zobrist hashes must agree, otherwise the input is printed and the program aborts.
+ *
+ * Input: width, height and number of block types (one byte each), then one byte per cell (0xF0 and up is an
+ * empty cell, the board is settled first), then the clicks. A click byte below 0x80 picks a cell of the board,
+ * which may be empty or a single block; from 0x80 on it picks one of the moves. When the input runs out the
+ * missing bytes come from a generator seeded with the input, and the game is played to its end with random moves.
+ *
+ * With libFuzzer (clang -fsanitize=fuzzer -DFUZZ_LIBFUZZER) this file is the fuzz target. Without it, main()
+ * runs random inputs, or the input files it is given, and prints executions and moves per second as JSON.
+ * Usage: program [--runs N] [--seed N] [--max-len N] [FILE...] */
+
+// Largest boards the inputs make. Every cell index fits in a click byte of BatchBoards.
+#define FUZZ_MAX_WIDTH 20
+#define FUZZ_MAX_HEIGHT 12
+// Moves after which a game is stopped (more than a board can hold).
+#define FUZZ_MAX_MOVES (FUZZ_MAX_WIDTH * FUZZ_MAX_HEIGHT)
+
+/** The rules of the original Grid, frozen. Do not optimize: this is what the engines are checked against. */
+class ReferenceGrid
+{
+private:
+    int width;
+    int height;
+    int numBlocks = 0;
+    int score = 0;
+    int gameEnded = 0;
+    std::vector<std::vector<std::optional<int>>> matrix; // matrix[col][row], no value if there is no block.
+
+public:
+    explicit ReferenceGrid(const PackedBoard &board) : width(board.getWidth()), height(board.getHeight())
+    {
+        matrix.resize(width);
+        for (int col = 0; col < width; col++)
+        {
+            matrix[col].resize(height);
+            for (int row = 0; row < height; row++)
+            {
+                if (!board.isEmpty(col, row))
+                {
+                    matrix[col][row] = board.get(col, row);
+                    numBlocks++;
+                }
+            }
+        }
+    }
+
+    int getScore() const { return score; }
+    int getNumBlocks() const { return numBlocks; }
+    bool hasEnded() const { return gameEnded == 1; }
+    uint8_t get(int col, int row) const { return matrix[col][row].has_value() ? *matrix[col][row] : EMPTY_CELL; }
+
+    // Let the blocks fall and move the empty columns to the right, as updateBlocksPositions does after a move.
+    void settle()
+    {
+        updateRows(0, height - 1);
+        updateColumns(0, height - 1);
+    }
+
+    // The click of deleteSameColorNeighbors at (startCol, startRow). Returns the blocks it removed.
+    int click(int startCol, int startRow)
+    {
+        if (!matrix[startCol][startRow].has_value())
+        {
+            return 0;
+        }
+        int startType = matrix[startCol][startRow].value();
+
+        std::vector<std::vector<bool>> visited(width, std::vector<bool>(height, false));
+        std::queue<std::pair<int, int>> blocksQueue;
+        blocksQueue.push(std::make_pair(startCol, startRow));
+        visited[startCol][startRow] = true;
+        std::vector<std::pair<int, int>> result;
+        result.push_back(std::make_pair(startCol, startRow));
+
+        int dCol[] = {1, -1, 0, 0};
+        int dRow[] = {0, 0, 1, -1};
+        while (!blocksQueue.empty())
+        {
+            std::pair<int, int> curElement = blocksQueue.front();
+            blocksQueue.pop();
+            for (int i = 0; i < 4; i++)
+            {
+                int neighborCol = curElement.first + dCol[i];
+                int neighborRow = curElement.second + dRow[i];
+                if (neighborRow >= 0 && neighborRow < height && neighborCol >= 0 && neighborCol < width &&
+                    !visited[neighborCol][neighborRow])
+                {
+                    visited[neighborCol][neighborRow] = true;
+                    if (matrix[neighborCol][neighborRow].has_value() &&
+                        matrix[neighborCol][neighborRow].value() == startType)
+                    {
+                        blocksQueue.push(std::make_pair(neighborCol, neighborRow));
+                        result.push_back(std::make_pair(neighborCol, neighborRow));
+                    }
+                }
+            }
+        }
+
+        if (result.size() < 2)
+        {
+            return 0;
+        }
+        int mostLeftCol = width - 1;
+        int mostDownRow = 0;
+        for (const std::pair<int, int> &position : result)
+        {
+            matrix[position.first][position.second] = std::nullopt;
+            numBlocks -= 1;
+            score += 1;
+            mostLeftCol = std::min(mostLeftCol, position.first);
+            mostDownRow = std::max(mostDownRow, position.second);
+        }
+        updateRows(mostLeftCol, mostDownRow);
+        updateColumns(mostLeftCol, mostDownRow);
+        checkEndCondition();
+        return (int)result.size();
+    }
+
+    void updateRows(int mostLeftCol, int mostDownRow)
+    {
+        if (mostDownRow > 0)
+        {
+            for (int col = mostLeftCol; col < width; col++)
+            {
+                int newRow = mostDownRow;
+                int curRow = mostDownRow;
+                while (curRow >= 0)
+                {
+                    if (matrix[col][curRow].has_value())
+                    {
+                        if (newRow != curRow)
+                        {
+                            std::swap(matrix[col][newRow], matrix[col][curRow]);
+                        }
+                        newRow -= 1;
+                    }
+                    curRow -= 1;
+                }
+            }
+        }
+    }
+
+    void updateColumns(int mostLeftCol, int mostDownRow)
+    {
+        if (mostDownRow == height - 1)
+        {
+            int newColumn = mostLeftCol;
+            for (int curColumn = mostLeftCol; curColumn <= width - 1; curColumn++)
+            {
+                if (matrix[curColumn][mostDownRow].has_value())
+                {
+                    if (curColumn != newColumn)
+                    {
+                        std::swap(matrix[curColumn], matrix[newColumn]);
+                    }
+                    newColumn += 1;
+                }
+            }
+        }
+    }
+
+    void checkEndCondition()
+    {
+        if (anyPossibilityLeft() == 0 || numBlocks == 0)
+        {
+            gameEnded = 1;
+        }
+    }
+
+    int anyPossibilityLeft() const
+    {
+        int dCol[] = {1, -1, 0, 0};
+        int dRow[] = {0, 0, 1, -1};
+        for (int col = 0; col < width; col++)
+        {
+            for (int row = 0; row < height; row++)
+            {
+                if (!matrix[col][row].has_value())
+                {
+                    continue;
+                }
+                for (int i = 0; i < 4; i++)
+                {
+                    int newCol = col + dCol[i];
+                    int newRow = row + dRow[i];
+                    if (newRow >= 0 && newRow < height && newCol >= 0 && newCol < width &&
+                        matrix[newCol][newRow].has_value() && matrix[newCol][newRow].value() == matrix[col][row].value())
+                    {
+                        return 1;
+                    }
+                }
+            }
+        }
+        return 0;
+    }
+
+};
+
+// Bytes of the input, then bytes of a generator seeded with the whole input once it runs out.
+class InputReader
+{
+private:
+    const uint8_t *data;
+    size_t size;
+    size_t position = 0;
+    Xoshiro128 rng;
+
+    static uint32_t hashInput(const uint8_t *data, size_t size)
+    {
+        uint32_t hash = 2166136261u; // FNV-1a
+        for (size_t i = 0; i < size; i++)
+        {
+            hash = (hash ^ data[i]) * 16777619u;
+        }
+        return hash;
+    }
+
+public:
+    InputReader(const uint8_t *newData, size_t newSize) : data(newData), size(newSize), rng(hashInput(newData, newSize)) {}
+
+    bool isExhausted() const { return position >= size; }
+    uint8_t next() { return position < size ? data[position++] : (uint8_t)rng.next(); }
+};
+
+// Input being run, printed when a check fails.
+static const uint8_t *currentInput = nullptr;
+static size_t currentSize = 0;
+static long numMoves = 0;
+
+static void check(bool condition, const char *what, int move)
+{
+    if (condition)
+    {
+        return;
+    }
+    fprintf(stderr, "mismatch after click %d: %s\ninput (%zu bytes):", move, what, currentSize);
+    for (size_t i = 0; i < currentSize; i++)
+    {
+        fprintf(stderr, "%s%02x", i % 32 == 0 ? "\n" : " ", currentInput[i]);
+    }
+    fprintf(stderr, "\n");
+    abort();
+}
+
+// Whether a PackedBoard holds the same cells as the reference.
+static bool sameCells(const ReferenceGrid &reference, const PackedBoard &board)
+{
+    for (int col = 0; col < board.getWidth(); col++)
+    {
+        for (int row = 0; row < board.getHeight(); row++)
+        {
+            if (board.get(col, row) != reference.get(col, row))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// A move as forEachMove reports it.
+struct ReportedMove
+{
+    int cellIndex;
+    int blockType;
+    int size;
+
+    bool operator==(const ReportedMove &other) const
+    {
+        return cellIndex == other.cellIndex && blockType == other.blockType && size == other.size;
+    }
+};
+
+/** Play the game of the input on the reference and every engine, checking them after every click.
+ * fixed is the fixed-size Board of the board dimensions, or nullptr if they have none. */
+template <typename FixedBoard>
+static void playGame(InputReader &input, PackedBoard &board, FixedBoard *fixed)
+{
+    static Grid grid(1, 1, MAX_BLOCK_TYPES);
+    static MoveGenerator moves;
+    static BatchBoards<NativeLanes> *batch = nullptr;
+    static PackedBoard stored;
+    static std::vector<ReportedMove> generatorMoves;
+    static std::vector<ReportedMove> fixedMoves;
+
+    int width = board.getWidth();
+    int height = board.getHeight();
+    ReferenceGrid reference(board);
+    reference.settle();
+    for (int cellIndex = 0; cellIndex < board.getNumCells(); cellIndex++)
+    {
+        board[cellIndex] = reference.get(cellIndex / height, cellIndex % height);
+    }
+
+    grid.setMatrix(board);
+    moves.setDimensions(width, height);
+    uint64_t hash = board.hash();
+    if (batch == nullptr || batch->getWidth() != width || batch->getHeight() != height)
+    {
+        delete batch;
+        batch = new BatchBoards<NativeLanes>(width, height);
+    }
+    batch->load(0, board);
+    if (fixed != nullptr)
+    {
+        fixed->load(board);
+    }
+
+    for (int move = 0; move < FUZZ_MAX_MOVES; move++)
+    {
+        // The moves of the position, in the order the searches see them.
+        generatorMoves.clear();
+        moves.forEachMove(board, [](int cellIndex, int blockType, int size)
+                          { generatorMoves.push_back({cellIndex, blockType, size}); });
+        bool hasMove = reference.anyPossibilityLeft() == 1;
+        check(hasMove == !generatorMoves.empty(), "MoveGenerator moves left", move);
+        if (fixed != nullptr)
+        {
+            fixedMoves.clear();
+            fixed->forEachMove([](int cellIndex, int blockType, int size)
+                               { fixedMoves.push_back({cellIndex, blockType, size}); });
+            check(fixedMoves == generatorMoves, "fixed Board moves", move);
+        }
+        uint8_t batchHasMove[BatchBoards<NativeLanes>::LANES];
+        batch->findMoves(batchHasMove);
+        check(batchHasMove[0] == hasMove, "BatchBoards moves left", move);
+        if (!hasMove)
+        {
+            break;
+        }
+
+        // The next click: a cell from the input, or one of the moves once the input is used up.
+        bool inputLeft = !input.isExhausted();
+        uint8_t clickByte = input.next();
+        const ReportedMove *picked = nullptr;
+        int cellIndex;
+        if (!inputLeft || clickByte >= 0x80)
+        {
+            picked = &generatorMoves[(clickByte & 0x7F) % generatorMoves.size()];
+            cellIndex = picked->cellIndex;
+        }
+        else
+        {
+            cellIndex = (clickByte * board.getNumCells()) >> 7;
+        }
+        int col = cellIndex / height;
+        int row = cellIndex % height;
+
+        int removed = reference.click(col, row);
+        numMoves += removed > 0;
+        check(picked == nullptr || picked->size == removed, "MoveGenerator group size", move);
+
+        int scoreBefore = grid.getScore();
+        grid.placeCursor(col, row);
+        check(grid.getCursorGroupSize() == removed, "Grid group size at the cursor", move);
+        check(grid.deleteSameColorNeighbors() == (removed > 0), "Grid move made", move);
+        grid.checkEndCondition();
+        check(grid.getScore() - scoreBefore == removed && grid.getScore() == reference.getScore(), "Grid score", move);
+        check(grid.getNumBlocks() == reference.getNumBlocks(), "Grid blocks left", move);
+        check(sameCells(reference, grid.matrix), "Grid board", move);
+        check((grid.anyPossibilityLeft() == 1) == (reference.anyPossibilityLeft() == 1), "Grid moves left", move);
+        check(grid.hasEnded() == reference.hasEnded(), "Grid end of the game", move);
+        check(grid.getHash() == grid.matrix.hash(), "Grid hash", move);
+
+        if (removed > 0)
+        {
+            check(moves.play(board, cellIndex, &hash) == removed, "MoveGenerator removed blocks", move);
+            check(sameCells(reference, board), "MoveGenerator board", move);
+            check(hash == board.hash(), "MoveGenerator hash", move);
+            if (fixed != nullptr)
+            {
+                check(fixed->play(cellIndex) == removed, "fixed Board removed blocks", move);
+                fixed->store(stored);
+                check(sameCells(reference, stored), "fixed Board board", move);
+                check(fixed->isCleared() == (reference.getNumBlocks() == 0), "fixed Board cleared", move);
+            }
+        }
+
+        uint8_t clicks[BatchBoards<NativeLanes>::LANES];
+        uint8_t batchRemoved[BatchBoards<NativeLanes>::LANES];
+        memset(clicks, EMPTY_CELL, sizeof(clicks));
+        clicks[0] = cellIndex;
+        batch->play(clicks, batchRemoved);
+        check(batchRemoved[0] == removed, "BatchBoards removed blocks", move);
+        check(batch->getScore(0) == (uint32_t)reference.getScore(), "BatchBoards score", move);
+        batch->store(0, stored);
+        check(sameCells(reference, stored), "BatchBoards board", move);
+    }
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static bool halReady = false;
+    static FrameBufferDisplay display(SCREEN_WIDTH, SCREEN_HEIGHT);
+    static ScriptedInput scriptedInput;
+    static MemoryStorage storage;
+    static VirtualClock clock;
+    static SeededRng rng(1);
+    if (!halReady)
+    {
+        // Grid needs the hardware abstraction layer, but draws nothing here.
+        hal.display = &display;
+        hal.input = &scriptedInput;
+        hal.storage = &storage;
+        hal.clock = &clock;
+        hal.rng = &rng;
+        storage.begin(MEM_SIZE);
+        halReady = true;
+    }
+    currentInput = data;
+    currentSize = size;
+
+    InputReader input(data, size);
+    int width = 1 + input.next() % FUZZ_MAX_WIDTH;
+    int height = 1 + input.next() % FUZZ_MAX_HEIGHT;
+    int numColors = 1 + input.next() % MAX_BLOCK_TYPES;
+    PackedBoard board(width, height);
+    for (int cellIndex = 0; cellIndex < board.getNumCells(); cellIndex++)
+    {
+        uint8_t cellByte = input.next();
+        board[cellIndex] = cellByte >= 0xF0 ? EMPTY_CELL : cellByte % numColors;
+    }
+
+    bool fixedSize = withFixedBoard(width, height, [&](auto &fixed)
+                                    { playGame(input, board, &fixed); });
+    if (!fixedSize)
+    {
+        playGame(input, board, (Board<1, 1, 1> *)nullptr);
+    }
+    return 0;
+}
+
+#ifndef FUZZ_LIBFUZZER
+int main(int argc, char **argv)
+{
+    long numRuns = 100000;
+    uint32_t seed = 1;
+    size_t maxLength = 512;
+    std::vector<const char *> files;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc)
+        {
+            numRuns = atol(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            seed = strtoul(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--max-len") == 0 && i + 1 < argc)
+        {
+            maxLength = strtoul(argv[++i], nullptr, 10);
+        }
+        else
+        {
+            files.push_back(argv[i]);
+        }
+    }
+
+    // Replay the given inputs, e.g. a crash libFuzzer saved.
+    if (!files.empty())
+    {
+        for (const char *path : files)
+        {
+            FILE *file = fopen(path, "rb");
+            if (file == nullptr)
+            {
+                fprintf(stderr, "could not open %s\n", path);
+                return 1;
+            }
+            std::vector<uint8_t> data;
+            int c;
+            while ((c = fgetc(file)) != EOF)
+            {
+                data.push_back(c);
+            }
+            fclose(file);
+            LLVMFuzzerTestOneInput(data.data(), data.size());
+            printf("%s: ok\n", path);
+        }
+        return 0;
+    }
+
+    Xoshiro128 rng(seed);
+    std::vector<uint8_t> data(maxLength);
+    auto startTime = std::chrono::steady_clock::now();
+    for (long run = 0; run < numRuns; run++)
+    {
+        size_t length = rng.nextBelow(maxLength + 1);
+        for (size_t i = 0; i < length; i++)
+        {
+            data[i] = rng.next();
+        }
+        LLVMFuzzerTestOneInput(data.data(), length);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    printf("{\"runs\": %ld, \"moves\": %ld, \"seconds\": %.3f, \"execs_per_s\": %.0f, \"moves_per_s\": %.0f}\n",
+           numRuns, numMoves, seconds, numRuns / seconds, numMoves / seconds);
+    return 0;
+}
+#endif
@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "classes.h"
+#include "hal_native.h"
+#include "journal.h"
+
+/** Crash-recovery test of the journaled storage on the simulated flash.
+ * Commits random images and small changes, cuts the power at random points (in the middle of a record, a commit mark,
+ * a sector header or an erase) and reboots into a new JournalStorage on the same flash.
+ * Every boot must find exactly the last completed commit, or the one the power cut tore if its commit mark made it.
+ * Prints the number of commits, power cuts and recoveries, and the wear of every sector.
+ * Usage: program [--commits N] [--seed N] [--flash FILE] */
+
+// Next random image: often a few changed bytes (like a logged move), else a save-sized prefix of data
+// followed by zeros, sometimes the whole memory.
+static void randomImage(std::mt19937 &random, std::vector<uint8_t> &image)
+{
+    if (random() % 2 == 0)
+    {
+        size_t offset = random() % image.size();
+        size_t end = std::min(image.size(), offset + 1 + random() % 4);
+        for (size_t i = offset; i < end; i++)
+        {
+            image[i] = random() % 256;
+        }
+        return;
+    }
+    size_t length = random() % 16 == 0 ? image.size() : random() % 96;
+    for (size_t i = 0; i < image.size(); i++)
+    {
+        image[i] = i < length ? random() % 256 : 0;
+    }
+}
+
+// Boot a new journal on the flash and compare what it loads.
+static bool readBack(JournalStorage &journal, const std::vector<uint8_t> &expected)
+{
+    for (size_t i = 0; i < expected.size(); i++)
+    {
+        if (journal.readByte(i) != expected[i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    int numCommits = 20000;
+    uint32_t seed = 1;
+    std::string flashPath;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--commits") == 0)
+        {
+            numCommits = atoi(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "--seed") == 0)
+        {
+            seed = strtoul(argv[i + 1], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--flash") == 0)
+        {
+            flashPath = argv[i + 1];
+        }
+    }
+    if (!flashPath.empty())
+    {
+        remove(flashPath.c_str());
+    }
+
+    std::mt19937 random(seed);
+    FileFlash flash(flashPath);
+    std::vector<uint8_t> committed(MEM_SIZE, 0); // Last commit that completed.
+    std::vector<uint8_t> torn(MEM_SIZE, 0);      // Commit the power cut went through, if any.
+    std::vector<uint8_t> image(MEM_SIZE, 0);
+    bool hasTorn = false;
+    int numDone = 0;
+    int numBoots = 0;
+    int numPowerCuts = 0;
+    int numTornKept = 0;
+    int numErases = 0;
+
+    while (numDone < numCommits)
+    {
+        // Boot.
+        flash.restorePower();
+        JournalStorage journal(flash);
+        numBoots++;
+        if (!journal.begin(MEM_SIZE))
+        {
+            printf("boot %d: begin failed\n", numBoots);
+            return 1;
+        }
+        if (hasTorn && readBack(journal, torn))
+        {
+            numTornKept++;
+            committed = torn;
+        }
+        else if (!readBack(journal, committed))
+        {
+            printf("boot %d: the journal lost the last commit (%d commits done)\n", numBoots, numDone);
+            return 1;
+        }
+        hasTorn = false;
+
+        // Commit until the power goes off, or reboot cleanly every so often.
+        bool cutPower = random() % 8 != 0;
+        if (cutPower)
+        {
+            flash.cutPowerAfter(random() % 4096);
+        }
+        int numBeforeReboot = 1 + random() % 200;
+        for (int i = 0; i < numBeforeReboot && numDone < numCommits; i++)
+        {
+            randomImage(random, image);
+            for (size_t address = 0; address < image.size(); address++)
+            {
+                journal.writeByte(address, image[address]);
+            }
+            numDone++;
+            if (journal.commit())
+            {
+                committed = image;
+                continue;
+            }
+            if (!flash.isPowerOff())
+            {
+                printf("commit %d failed with the power on\n", numDone);
+                return 1;
+            }
+            numPowerCuts++;
+            torn = image;
+            hasTorn = true;
+            break;
+        }
+        numErases += journal.getNumErases();
+    }
+
+    printf("commits: %d, boots: %d, power cuts: %d, torn commits kept: %d\n", numDone, numBoots, numPowerCuts, numTornKept);
+    printf("sector erases: %d (%.1f commits per erase)\n", numErases, numErases > 0 ? (double)numDone / numErases : 0.0);
+    for (int sector = 0; sector < flash.numSectors(); sector++)
+    {
+        printf("sector %d: %d erases\n", sector, flash.getEraseCount(sector));
+    }
+    return 0;
+}
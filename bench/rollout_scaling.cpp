@@ -0,0 +1,137 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "board.h"
+#include "generator.h"
+#include "rollout.h"
+
+/** Scaling of the Monte Carlo rollout engine over the cores of the host.
+ * Analyses the same seeded 16x6 level boards with 1, 2, 4 ... N worker threads and prints one JSON line per
+ * thread count: rollouts per second, speedup over one thread and number of stolen tasks.
+ * The results must be the same for every thread count, the program fails if they are not.
+ * Usage: program [--positions N] [--seed N] [--rollouts N] [--level N] [--threads N] */
+
+struct Analysis
+{
+    uint64_t numRollouts = 0;
+    int64_t totalScore = 0;
+    int64_t bestScores = 0;
+};
+
+// Analyse all boards with the given number of workers. Returns the merged numbers and the time it took.
+static Analysis analyse(const std::vector<PackedBoard> &boards, int numWorkers, int numRollouts, int level,
+                        uint32_t seed, double &seconds, uint32_t &numSteals)
+{
+    RolloutEngine engine(numWorkers);
+    Analysis analysis;
+    numSteals = 0;
+    auto startTime = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < boards.size(); i++)
+    {
+        if (!engine.start(boards[i], numRollouts, level, seed + i))
+        {
+            continue;
+        }
+        std::vector<std::thread> threads;
+        for (int worker = 1; worker < numWorkers; worker++)
+        {
+            threads.emplace_back([&engine, worker]
+                                 { engine.work(worker); });
+        }
+        engine.work(0);
+        for (std::thread &thread : threads)
+        {
+            thread.join();
+        }
+        numSteals += engine.getNumSteals();
+
+        RolloutResult result = engine.getResult();
+        analysis.numRollouts += result.numRollouts;
+        analysis.bestScores += result.bestScore;
+        for (const RolloutMoveStats &move : result.moves)
+        {
+            analysis.totalScore += move.totalScore;
+        }
+    }
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    return analysis;
+}
+
+int main(int argc, char **argv)
+{
+    int numPositions = 20;
+    uint32_t seed = 1;
+    int numRollouts = 256;
+    int level = 0;
+    int maxThreads = std::thread::hardware_concurrency();
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--positions") == 0)
+        {
+            numPositions = atoi(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "--seed") == 0)
+        {
+            seed = strtoul(argv[i + 1], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--rollouts") == 0)
+        {
+            numRollouts = atoi(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "--level") == 0)
+        {
+            level = atoi(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "--threads") == 0)
+        {
+            maxThreads = atoi(argv[i + 1]);
+        }
+    }
+    if (maxThreads < 1)
+    {
+        maxThreads = 1;
+    }
+
+    // The level boards: 16x6 with 3 to 5 block types, like the game makes them.
+    std::vector<PackedBoard> boards;
+    for (int i = 0; i < numPositions; i++)
+    {
+        PackedBoard board(16, 6);
+        generateBoard(board, 3 + i % 3, seed * 7919 + i);
+        boards.push_back(board);
+    }
+
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < maxThreads; threads *= 2)
+    {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    Analysis reference;
+    double referenceRate = 0;
+    bool same = true;
+    for (int threads : threadCounts)
+    {
+        double seconds = 0;
+        uint32_t numSteals = 0;
+        Analysis analysis = analyse(boards, threads, numRollouts, level, seed, seconds, numSteals);
+        double rate = analysis.numRollouts / seconds;
+        if (threads == 1)
+        {
+            reference = analysis;
+            referenceRate = rate;
+        }
+        bool matches = analysis.numRollouts == reference.numRollouts && analysis.totalScore == reference.totalScore &&
+                       analysis.bestScores == reference.bestScores;
+        same = same && matches;
+        printf("{\"threads\": %d, \"level\": %d, \"rollouts\": %llu, \"seconds\": %.3f, \"rollouts_per_s\": %.0f, "
+               "\"speedup\": %.2f, \"steals\": %u, \"mean_score\": %.1f, \"same_result\": %s}\n",
+               threads, level, (unsigned long long)analysis.numRollouts, seconds, rate, rate / referenceRate, numSteals,
+               analysis.numRollouts ? (double)analysis.totalScore / analysis.numRollouts : 0.0, matches ? "true" : "false");
+    }
+    return same ? 0 : 1;
+}
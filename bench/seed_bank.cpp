@@ -0,0 +1,91 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "board.h"
+#include "generator.h"
+
+/** Writes the bank of good level seeds (src/seed_bank.cpp) that Grid draws its levels from.
+ * For every number of block types, the first SEED_BANK_SIZE seeds from --first-seed on whose SEED_BANK_WIDTH x
+ * SEED_BANK_HEIGHT boards pass the quality filter of src/generator.h. Prints how many seeds were tried and
+ * a checksum of the boards (the XOR of their Zobrist hashes), which only depends on the generator and the seeds.
+ * Usage: program [--first-seed N] [--out FILE] */
+
+int main(int argc, char **argv)
+{
+    uint32_t firstSeed = 1;
+    const char *outPath = "src/seed_bank.cpp";
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--first-seed") == 0)
+        {
+            firstSeed = strtoul(argv[i + 1], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--out") == 0)
+        {
+            outPath = argv[i + 1];
+        }
+    }
+
+    std::vector<uint32_t> seeds(SEED_BANK_COLORS * SEED_BANK_SIZE);
+    uint64_t checksum = 0;
+    PackedBoard board(SEED_BANK_WIDTH, SEED_BANK_HEIGHT);
+    MoveGenerator moves;
+    moves.setDimensions(SEED_BANK_WIDTH, SEED_BANK_HEIGHT);
+    for (int row = 0; row < SEED_BANK_COLORS; row++)
+    {
+        int numBlockTypes = SEED_BANK_MIN_COLORS + row;
+        uint32_t *bank = &seeds[row * SEED_BANK_SIZE];
+        auto startTime = std::chrono::steady_clock::now();
+        int numFound = findGoodSeeds(SEED_BANK_WIDTH, SEED_BANK_HEIGHT, numBlockTypes, firstSeed, bank, SEED_BANK_SIZE,
+                                     SEED_BANK_SIZE * 1000);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        if (numFound < SEED_BANK_SIZE)
+        {
+            fprintf(stderr, "only %d good seeds with %d block types\n", numFound, numBlockTypes);
+            return 1;
+        }
+
+        double totalGroups = 0;
+        double totalRemaining = 0;
+        for (int i = 0; i < SEED_BANK_SIZE; i++)
+        {
+            generateBoard(board, numBlockTypes, bank[i]);
+            BoardQuality quality = measureBoard(board, moves);
+            totalGroups += quality.numGroups;
+            totalRemaining += quality.greedyRemaining;
+            checksum ^= board.hash() * (i + 1);
+        }
+        uint32_t numTried = bank[SEED_BANK_SIZE - 1] - firstSeed + 1;
+        printf("{\"colors\": %d, \"tried\": %u, \"kept\": %.3f, \"us_per_seed\": %.1f, \"mean_groups\": %.1f, "
+               "\"mean_greedy_left\": %.1f}\n",
+               numBlockTypes, numTried, (double)SEED_BANK_SIZE / numTried, seconds * 1e6 / numTried,
+               totalGroups / SEED_BANK_SIZE, totalRemaining / SEED_BANK_SIZE);
+    }
+
+    FILE *out = fopen(outPath, "w");
+    if (!out)
+    {
+        fprintf(stderr, "could not write %s\n", outPath);
+        return 1;
+    }
+    fprintf(out, "// Bank of good level seeds. Written by bench/seed_bank.cpp (pio run -e seeds), do not edit.\n");
+    fprintf(out, "// First seed %u, board checksum %016llx.\n", firstSeed, (unsigned long long)checksum);
+    fprintf(out, "#include \"generator.h\"\n\n");
+    fprintf(out, "const uint32_t seedBank[SEED_BANK_COLORS][SEED_BANK_SIZE] = {\n");
+    for (int row = 0; row < SEED_BANK_COLORS; row++)
+    {
+        fprintf(out, "    // %d block types\n    {\n", SEED_BANK_MIN_COLORS + row);
+        for (int i = 0; i < SEED_BANK_SIZE; i++)
+        {
+            fprintf(out, "%s0x%08X,%s", i % 8 == 0 ? "        " : " ", seeds[row * SEED_BANK_SIZE + i],
+                    i % 8 == 7 ? "\n" : "");
+        }
+        fprintf(out, "    },\n");
+    }
+    fprintf(out, "};\n");
+    fclose(out);
+    printf("{\"out\": \"%s\", \"checksum\": \"%016llx\"}\n", outPath, (unsigned long long)checksum);
+    return 0;
+}
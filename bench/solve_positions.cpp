@@ -0,0 +1,126 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "classes.h"
+#include "hal_native.h"
+#include "solver.h"
+
+/** Headless scoring of positions with the hint solver.
+ * Every position is a seeded random 16x6 board. The solver searches it with the given budget,
+ * and with --autoplay the whole game is played by asking the solver for every move.
+ * Prints one JSON line per position and a summary: score, line length, widest beam, nodes and time.
+ * With --skip-duplicates 0 the solver keeps every copy of a position in a level of its beam.
+ * Usage: program [--positions N] [--seed N] [--budget-us N] [--autoplay 0|1] [--skip-duplicates 0|1] */
+
+// Play the game to the end, one solver search per move. Returns the standard SameGame score.
+static int32_t autoplay(Solver &solver, PackedBoard board, uint32_t budgetMicros, int &numMoves)
+{
+    int32_t score = 0;
+    numMoves = 0;
+    Grid grid(board.getWidth(), board.getHeight(), MAX_BLOCK_TYPES);
+    grid.setMatrix(board);
+    for (;;)
+    {
+        SolverResult result = solver.solve(grid.matrix, budgetMicros);
+        if (result.cellIndex < 0)
+        {
+            break;
+        }
+        int blocksBefore = 0;
+        for (int cellIndex = 0; cellIndex < grid.matrix.getNumCells(); cellIndex++)
+        {
+            blocksBefore += grid.matrix[cellIndex] != EMPTY_CELL;
+        }
+        grid.colCursor = result.cellIndex / grid.getHeight();
+        grid.rowCursor = result.cellIndex % grid.getHeight();
+        grid.deleteSameColorNeighbors();
+        int blocksAfter = 0;
+        for (int cellIndex = 0; cellIndex < grid.matrix.getNumCells(); cellIndex++)
+        {
+            blocksAfter += grid.matrix[cellIndex] != EMPTY_CELL;
+        }
+        score += moveScore(blocksBefore - blocksAfter);
+        numMoves++;
+        if (blocksAfter == 0)
+        {
+            score += CLEAR_BONUS;
+        }
+    }
+    return score;
+}
+
+int main(int argc, char **argv)
+{
+    int numPositions = 100;
+    uint32_t seed = 1;
+    uint32_t budgetMicros = HINT_SLICE_US * HINT_SLICES;
+    bool playGames = false;
+    bool skipDuplicates = true;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--positions") == 0)
+        {
+            numPositions = atoi(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "--seed") == 0)
+        {
+            seed = strtoul(argv[i + 1], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--budget-us") == 0)
+        {
+            budgetMicros = strtoul(argv[i + 1], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--autoplay") == 0)
+        {
+            playGames = atoi(argv[i + 1]) != 0;
+        }
+        else if (strcmp(argv[i], "--skip-duplicates") == 0)
+        {
+            skipDuplicates = atoi(argv[i + 1]) != 0;
+        }
+    }
+
+    FrameBufferDisplay display(SCREEN_WIDTH, SCREEN_HEIGHT);
+    ScriptedInput input;
+    MemoryStorage storage;
+    SystemClock clock;
+    SeededRng rng(seed);
+    hal.display = &display;
+    hal.input = &input;
+    hal.storage = &storage;
+    hal.clock = &clock;
+    hal.rng = &rng;
+    storage.begin(MEM_SIZE);
+
+    Solver solver;
+    solver.setSkipDuplicates(skipDuplicates);
+    double totalScore = 0;
+    double totalMicros = 0;
+    double totalNodes = 0;
+    for (int position = 0; position < numPositions; position++)
+    {
+        rng.randomize();
+        Grid grid(16, 6, 3 + position % 3);
+
+        uint32_t startTime = clock.micros();
+        SolverResult result = solver.solve(grid.matrix, budgetMicros);
+        uint32_t elapsed = clock.micros() - startTime;
+
+        int32_t score = result.score;
+        int numMoves = result.numMoves;
+        if (playGames)
+        {
+            score = autoplay(solver, grid.matrix, budgetMicros, numMoves);
+        }
+        printf("{\"position\": %d, \"colors\": %d, \"score\": %d, \"moves\": %d, \"beam\": %d, \"nodes\": %u, \"us\": %u}\n",
+               position, grid.getNumDifferentBlocks(), score, numMoves, result.beamWidth, result.numNodes, elapsed);
+        totalScore += score;
+        totalMicros += elapsed;
+        totalNodes += result.numNodes;
+    }
+
+    printf("{\"positions\": %d, \"budget_us\": %u, \"mean_score\": %.1f, \"mean_us\": %.1f, \"nodes_per_ms\": %.1f}\n",
+           numPositions, budgetMicros, totalScore / numPositions, totalMicros / numPositions,
+           totalMicros > 0 ? totalNodes * 1000 / totalMicros : 0.0);
+    return 0;
+}
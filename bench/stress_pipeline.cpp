@@ -0,0 +1,207 @@
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "classes.h"
+#include "hal_native.h"
+#include "pipeline.h"
+
+/** Stress test of the render pipeline with two std::threads, meant to run under ThreadSanitizer.
+ * The producer plays games as fast as it can and publishes every frame and save,
+ * the consumer draws and commits them like the render core of the device.
+ * At the end the screen and the flash must match the last state of the game.
+ * Usage: program [--items N] [--moves N] [--seed N] */
+
+// Push a sequence of numbers through a queue and check that they come out complete and in order.
+static bool stressQueue(uint64_t numItems)
+{
+    SpscQueue<uint64_t, 64> queue;
+    std::thread producer([&]
+                         {
+                             for (uint64_t i = 0; i < numItems; i++)
+                             {
+                                 while (!queue.tryPush(i))
+                                 {
+                                     std::this_thread::yield();
+                                 }
+                             } });
+
+    bool ok = true;
+    uint64_t expected = 0;
+    while (expected < numItems)
+    {
+        uint64_t item;
+        if (!queue.tryPop(item))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        if (item != expected)
+        {
+            fprintf(stderr, "queue: got %llu, expected %llu\n", (unsigned long long)item, (unsigned long long)expected);
+            ok = false;
+            break;
+        }
+        expected++;
+    }
+    producer.join();
+    return ok;
+}
+
+// Find a cell of a region of at least 2 blocks. Returns false if the board has no move.
+static bool findMove(Grid &grid, int &moveCol, int &moveRow)
+{
+    PackedBoard &board = grid.matrix;
+    int start = hal.rng->nextInt(board.getNumCells());
+    for (int i = 0; i < board.getNumCells(); i++)
+    {
+        int cellIndex = (start + i) % board.getNumCells();
+        int col = cellIndex / board.getHeight();
+        int row = cellIndex % board.getHeight();
+        uint8_t blockType = board[cellIndex];
+        if (blockType == EMPTY_CELL)
+        {
+            continue;
+        }
+        if ((col + 1 < board.getWidth() && board.get(col + 1, row) == blockType) ||
+            (row + 1 < board.getHeight() && board.get(col, row + 1) == blockType))
+        {
+            moveCol = col;
+            moveRow = row;
+            return true;
+        }
+    }
+    return false;
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t numItems = 1000000;
+    int numMoves = 20000;
+    uint32_t seed = 1;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--items") == 0)
+        {
+            numItems = strtoull(argv[i + 1], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--moves") == 0)
+        {
+            numMoves = atoi(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "--seed") == 0)
+        {
+            seed = strtoul(argv[i + 1], nullptr, 10);
+        }
+    }
+
+    if (!stressQueue(numItems))
+    {
+        return 1;
+    }
+    printf("queue: %llu items in order\n", (unsigned long long)numItems);
+
+    // The consumer owns the panel and the flash, the producer only sees the copy in RAM.
+    FrameBufferDisplay display(SCREEN_WIDTH, SCREEN_HEIGHT);
+    ScriptedInput input;
+    MemoryStorage flash;
+    MirrorStorage storage(flash, pipeline);
+    VirtualClock clock;
+    SeededRng rng(seed);
+    hal.display = &display;
+    hal.input = &input;
+    hal.storage = &storage;
+    hal.clock = &clock;
+    hal.rng = &rng;
+    hal.storage->begin(MEM_SIZE);
+
+    std::atomic<bool> producing{true};
+    FrameSnapshot frame;
+    Grid grid;
+
+    std::thread consumer([&]
+                         {
+                             while (producing.load())
+                             {
+                                 pipeline.consume(flash);
+                             } });
+
+    // Producer: play moves, publish a frame after each one and save now and then.
+    for (int move = 0; move < numMoves; move++)
+    {
+        int moveCol;
+        int moveRow;
+        if (grid.hasEnded() || !findMove(grid, moveCol, moveRow))
+        {
+            grid = Grid();
+        }
+        else
+        {
+            grid.colCursor = moveCol;
+            grid.rowCursor = moveRow;
+            grid.deleteSameColorNeighbors();
+        }
+
+        if (move % 100 == 0)
+        {
+            grid.saveGame();
+            hal.storage->commitIfPending();
+        }
+
+        frame.sequence++;
+        frame.changed = {0, -1};
+        grid.fillSnapshot(frame);
+        if (!pipeline.publishFrame(frame))
+        {
+            grid.markDirty(frame.changed);
+        }
+    }
+
+    // Publish the last state until it gets through, then stop the consumer.
+    grid.saveGame();
+    while (!hal.storage->commitIfPending())
+    {
+        std::this_thread::yield();
+    }
+    frame.changed = {0, -1};
+    grid.fillSnapshot(frame);
+    while (!pipeline.publishFrame(frame))
+    {
+        std::this_thread::yield();
+    }
+    producing.store(false);
+    consumer.join();
+    pipeline.consume(flash);
+
+    bool ok = true;
+
+    // The flash must hold the last save.
+    for (size_t address = 0; address < flash.size(); address++)
+    {
+        if (flash.readByte(address) != storage.readByte(address))
+        {
+            fprintf(stderr, "flash differs at %zu\n", address);
+            ok = false;
+            break;
+        }
+    }
+
+    // The screen must show the last frame, as a full redraw with a fresh renderer would.
+    FrameBufferDisplay reference(SCREEN_WIDTH, SCREEN_HEIGHT);
+    hal.display = &reference;
+    Renderer fresh;
+    frame.changed = {0, grid.getWidth() - 1};
+    fresh.drawFrame(frame);
+    if (reference.getPixels() != display.getPixels())
+    {
+        fprintf(stderr, "screen differs from a full redraw\n");
+        ok = false;
+    }
+
+    printf("pipeline: %d moves, %u frames drawn, %u dropped, %u saves\n", numMoves,
+           pipeline.getNumDrawnFrames(), pipeline.getNumDroppedFrames(), pipeline.getNumSaves());
+    printf("%s\n", ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include "trace.h"
+
+/** Decoder of the trace dump (see trace.h) into Chrome trace JSON, for chrome://tracing or ui.perfetto.dev.
+ * The input is what the device wrote to Serial (the other lines of the log are skipped) or the --trace file
+ * of the native build. Spans become complete events, counters become counter tracks, and every core or thread
+ * gets its own track. A summary of the spans is written to stderr.
+ * Usage: program [--in FILE] [--out FILE] (stdin and stdout by default) */
+
+// Spans of one name, for the summary.
+struct SpanStats
+{
+    long count = 0;
+    double totalUs = 0;
+    double maxUs = 0;
+};
+
+// Name as a JSON string.
+static std::string jsonString(const std::string &text)
+{
+    std::string quoted = "\"";
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            quoted += '\\';
+        }
+        quoted += (unsigned char)c < 0x20 ? ' ' : c;
+    }
+    return quoted + "\"";
+}
+
+int main(int argc, char **argv)
+{
+    const char *inPath = nullptr;
+    const char *outPath = nullptr;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--in") == 0)
+        {
+            inPath = argv[i + 1];
+        }
+        else if (strcmp(argv[i], "--out") == 0)
+        {
+            outPath = argv[i + 1];
+        }
+    }
+
+    FILE *in = inPath ? fopen(inPath, "r") : stdin;
+    if (in == nullptr)
+    {
+        fprintf(stderr, "could not open %s\n", inPath);
+        return 1;
+    }
+    FILE *out = outPath ? fopen(outPath, "w") : stdout;
+    if (out == nullptr)
+    {
+        fprintf(stderr, "could not open %s\n", outPath);
+        return 1;
+    }
+
+    double ticksPerUs = 1;
+    std::map<int, std::string> names;
+    std::map<std::string, SpanStats> stats;
+    std::vector<int> threads;
+    long numEvents = 0;
+    long numLost = 0;
+    long numBadLines = 0;
+
+    // The tick counter is 32 bits. The events come out roughly in time order, so each start is taken as the
+    // nearest time to the previous one, which unwraps the counter as long as the dump keeps up.
+    bool haveTime = false;
+    uint32_t lastStart = 0;
+    int64_t lastTime = 0;
+    int64_t firstTime = 0;
+
+    fprintf(out, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    char line[256];
+    while (fgets(line, sizeof(line), in) != nullptr)
+    {
+        line[strcspn(line, "\r\n")] = 0;
+        if (strncmp(line, "trace-clock ", 12) == 0)
+        {
+            ticksPerUs = std::max(1.0, atof(line + 12));
+            continue;
+        }
+        if (strncmp(line, "trace-name ", 11) == 0)
+        {
+            char *name = nullptr;
+            int id = strtol(line + 11, &name, 10);
+            names[id] = *name == ' ' ? name + 1 : name;
+            continue;
+        }
+        if (strncmp(line, "trace-lost ", 11) == 0)
+        {
+            numLost += atol(line + 11);
+            continue;
+        }
+        if (strncmp(line, "trace ", 6) != 0)
+        {
+            continue; // Not part of the dump.
+        }
+
+        TraceRecord record;
+        if (!parseTraceRecord(line + 6, record))
+        {
+            numBadLines++;
+            continue;
+        }
+        if (!haveTime)
+        {
+            haveTime = true;
+            lastTime = firstTime = record.start;
+        }
+        else
+        {
+            lastTime += (int32_t)(record.start - lastStart);
+        }
+        lastStart = record.start;
+
+        bool newThread = true;
+        for (int thread : threads)
+        {
+            newThread = newThread && thread != record.thread;
+        }
+        if (newThread)
+        {
+            threads.push_back(record.thread);
+        }
+
+        auto found = names.find(record.nameId);
+        std::string name = found != names.end() ? found->second : "name " + std::to_string(record.nameId);
+        double ts = (lastTime - firstTime) / ticksPerUs;
+        if (record.type == TRACE_SPAN)
+        {
+            double dur = record.value / ticksPerUs;
+            fprintf(out, "%s{\"name\": %s, \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": 0, \"tid\": %d}",
+                    numEvents > 0 ? ",\n" : "", jsonString(name).c_str(), ts, dur, record.thread);
+            SpanStats &span = stats[name];
+            span.count++;
+            span.totalUs += dur;
+            span.maxUs = std::max(span.maxUs, dur);
+        }
+        else
+        {
+            fprintf(out, "%s{\"name\": %s, \"ph\": \"C\", \"ts\": %.3f, \"pid\": 0, \"args\": {\"value\": %u}}",
+                    numEvents > 0 ? ",\n" : "", jsonString(name).c_str(), ts, (unsigned)record.value);
+        }
+        numEvents++;
+    }
+
+    // Name the tracks. On the device a thread is a core.
+    for (int thread : threads)
+    {
+        fprintf(out, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": %d, "
+                     "\"args\": {\"name\": \"thread %d\"}}",
+                numEvents > 0 ? ",\n" : "", thread, thread);
+        numEvents++;
+    }
+    fprintf(out, "\n]}\n");
+    if (out != stdout)
+    {
+        fclose(out);
+    }
+    if (in != stdin)
+    {
+        fclose(in);
+    }
+
+    fprintf(stderr, "%ld events, %ld lost, %ld unreadable lines\n", numEvents - (long)threads.size(), numLost,
+            numBadLines);
+    for (auto &entry : stats)
+    {
+        const SpanStats &span = entry.second;
+        fprintf(stderr, "  %-16s %8ld spans, mean %9.1f us, max %9.1f us\n", entry.first.c_str(), span.count,
+                span.totalUs / span.count, span.maxUs);
+    }
+    return 0;
+}
@@ -0,0 +1,146 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include "classes.h"
+#include "hal_native.h"
+
+/** Check of undo and redo (src/undo_history.h) on random play.
+ * Plays seeded boards of random sizes, some of them taller than 256 rows, with random clicks, undos and redos
+ * through Grid. After every undo or redo the board, the score, the Zobrist hash and the end of the game must be
+ * the same as when the position was first reached, the program fails if they are not.
+ * Prints the number of boards, moves, undos and redos, and the mismatches.
+ * Usage: program [--boards N] [--steps N] [--seed N] */
+
+// A position as it was reached by a click.
+struct Position
+{
+    PackedBoard board;
+    int score = 0;
+    bool ended = false;
+};
+
+static Position currentPosition(Grid &grid)
+{
+    Position position;
+    position.board = grid.matrix;
+    position.score = grid.getScore();
+    position.ended = grid.hasEnded();
+    return position;
+}
+
+// Check that the grid is at the position, and that its hash is the one of its board.
+static bool samePosition(Grid &grid, const Position &position)
+{
+    return grid.matrix == position.board && grid.getScore() == position.score &&
+           grid.hasEnded() == position.ended && grid.getHash() == grid.matrix.hash();
+}
+
+int main(int argc, char **argv)
+{
+    int numBoards = 400;
+    int numSteps = 300;
+    uint32_t seed = 1;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--boards") == 0)
+        {
+            numBoards = atoi(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "--steps") == 0)
+        {
+            numSteps = atoi(argv[i + 1]);
+        }
+        else if (strcmp(argv[i], "--seed") == 0)
+        {
+            seed = strtoul(argv[i + 1], nullptr, 10);
+        }
+    }
+
+    // Grid needs the hardware abstraction layer, but nothing is looked at here.
+    FrameBufferDisplay display(SCREEN_WIDTH, SCREEN_HEIGHT);
+    ScriptedInput input;
+    MemoryStorage storage;
+    VirtualClock clock;
+    SeededRng rng(seed);
+    hal.display = &display;
+    hal.input = &input;
+    hal.storage = &storage;
+    hal.clock = &clock;
+    hal.rng = &rng;
+    storage.begin(MEM_SIZE);
+
+    std::mt19937 random(seed);
+    long numMoves = 0;
+    long numUndos = 0;
+    long numRedos = 0;
+    int numMismatches = 0;
+    for (int b = 0; b < numBoards; b++)
+    {
+        // Every tenth board is a narrow, tall one.
+        int width = b % 10 == 9 ? 1 + random() % 4 : 1 + random() % 32;
+        int height = b % 10 == 9 ? 257 + random() % 144 : 1 + random() % 32;
+        int numColors = 2 + random() % 4;
+        Grid grid(width, height, numColors, seed + b);
+
+        std::vector<Position> played; // Positions before the moves that can be undone, the last one on top.
+        std::vector<Position> undone; // Positions after the moves that can be redone, the next one on top.
+        bool same = true;
+        for (int step = 0; step < numSteps && same; step++)
+        {
+            int action = random() % 8;
+            if (action < 5)
+            {
+                grid.colCursor = random() % width;
+                grid.rowCursor = random() % height;
+                Position before = currentPosition(grid);
+                if (grid.deleteSameColorNeighbors())
+                {
+                    numMoves++;
+                    played.push_back(before);
+                    undone.clear();
+                }
+            }
+            else if (action < 7)
+            {
+                Position after = currentPosition(grid);
+                if (grid.undo())
+                {
+                    numUndos++;
+                    // The history drops its oldest moves when it is full, but the move it undoes is the last one.
+                    same = !played.empty() && samePosition(grid, played.back());
+                    if (same)
+                    {
+                        played.pop_back();
+                        undone.push_back(after);
+                    }
+                }
+            }
+            else
+            {
+                Position before = currentPosition(grid);
+                if (grid.redo())
+                {
+                    numRedos++;
+                    same = !undone.empty() && samePosition(grid, undone.back());
+                    if (same)
+                    {
+                        undone.pop_back();
+                        played.push_back(before);
+                    }
+                }
+            }
+        }
+        if (!same)
+        {
+            numMismatches++;
+            fprintf(stderr, "board %d (%dx%d, %d colors) differs after an undo or a redo\n", b, width, height,
+                    numColors);
+        }
+    }
+
+    printf("%d boards, %ld moves, %ld undos, %ld redos, %d mismatches\n", numBoards, numMoves, numUndos, numRedos,
+           numMismatches);
+    return numMismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,439 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include "board.h"
+#include "generator.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// Most cells of a board in a BatchBoards: a packed cell index fits in a byte next to EMPTY_CELL.
+#define BATCH_MAX_CELLS 254
+
+/** Byte lanes for BatchBoards: a vector of SIZE bytes and the operations on all of them at once.
+ * A mask has every bit of a lane set (0xFF) or none. select(mask, a, b) takes a where mask is set and b elsewhere,
+ * andNot(a, b) is ~a & b and any(mask) tells if a lane of a mask is set.
+ * ScalarLanes works anywhere (8 lanes in a 64-bit word), Sse2Lanes and Avx2Lanes are built on hosts with those
+ * instruction sets. NativeLanes is the widest one the build has. */
+struct ScalarLanes
+{
+    static constexpr int SIZE = 8;
+    using Vec = uint64_t;
+
+    static constexpr uint64_t LOW_BITS = 0x7F7F7F7F7F7F7F7FULL;
+    static constexpr uint64_t ONES = 0x0101010101010101ULL;
+
+    static Vec load(const uint8_t *bytes)
+    {
+        Vec vec;
+        memcpy(&vec, bytes, sizeof(vec));
+        return vec;
+    }
+    static void store(uint8_t *bytes, Vec vec) { memcpy(bytes, &vec, sizeof(vec)); }
+    static Vec set1(uint8_t value) { return ONES * value; }
+    // A byte is zero when adding 0x7F to its low bits does not carry into its high bit and its high bit is clear.
+    static Vec eq(Vec a, Vec b)
+    {
+        Vec diff = a ^ b;
+        Vec nonZero = ((diff & LOW_BITS) + LOW_BITS) | diff;
+        return ((~nonZero & ~LOW_BITS) >> 7) * 0xFF;
+    }
+    static Vec bitAnd(Vec a, Vec b) { return a & b; }
+    static Vec bitOr(Vec a, Vec b) { return a | b; }
+    static Vec andNot(Vec a, Vec b) { return ~a & b; }
+    static Vec select(Vec mask, Vec a, Vec b) { return (mask & a) | (~mask & b); }
+    // Bytewise add: the low bits are added without carries between the bytes, then the high bits are put back.
+    static Vec add(Vec a, Vec b) { return ((a & LOW_BITS) + (b & LOW_BITS)) ^ ((a ^ b) & ~LOW_BITS); }
+    static bool any(Vec mask) { return mask != 0; }
+};
+
+#if defined(__SSE2__)
+struct Sse2Lanes
+{
+    static constexpr int SIZE = 16;
+    using Vec = __m128i;
+
+    static Vec load(const uint8_t *bytes) { return _mm_loadu_si128((const __m128i *)bytes); }
+    static void store(uint8_t *bytes, Vec vec) { _mm_storeu_si128((__m128i *)bytes, vec); }
+    static Vec set1(uint8_t value) { return _mm_set1_epi8((char)value); }
+    static Vec eq(Vec a, Vec b) { return _mm_cmpeq_epi8(a, b); }
+    static Vec bitAnd(Vec a, Vec b) { return _mm_and_si128(a, b); }
+    static Vec bitOr(Vec a, Vec b) { return _mm_or_si128(a, b); }
+    static Vec andNot(Vec a, Vec b) { return _mm_andnot_si128(a, b); }
+    static Vec select(Vec mask, Vec a, Vec b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+    static Vec add(Vec a, Vec b) { return _mm_add_epi8(a, b); }
+    static bool any(Vec mask) { return _mm_movemask_epi8(mask) != 0; }
+};
+#endif
+
+#if defined(__AVX2__)
+struct Avx2Lanes
+{
+    static constexpr int SIZE = 32;
+    using Vec = __m256i;
+
+    static Vec load(const uint8_t *bytes) { return _mm256_loadu_si256((const __m256i *)bytes); }
+    static void store(uint8_t *bytes, Vec vec) { _mm256_storeu_si256((__m256i *)bytes, vec); }
+    static Vec set1(uint8_t value) { return _mm256_set1_epi8((char)value); }
+    static Vec eq(Vec a, Vec b) { return _mm256_cmpeq_epi8(a, b); }
+    static Vec bitAnd(Vec a, Vec b) { return _mm256_and_si256(a, b); }
+    static Vec bitOr(Vec a, Vec b) { return _mm256_or_si256(a, b); }
+    static Vec andNot(Vec a, Vec b) { return _mm256_andnot_si256(a, b); }
+    static Vec select(Vec mask, Vec a, Vec b) { return _mm256_blendv_epi8(b, a, mask); }
+    static Vec add(Vec a, Vec b) { return _mm256_add_epi8(a, b); }
+    static bool any(Vec mask) { return _mm256_movemask_epi8(mask) != 0; }
+};
+using NativeLanes = Avx2Lanes;
+#elif defined(__SSE2__)
+using NativeLanes = Sse2Lanes;
+#else
+using NativeLanes = ScalarLanes;
+#endif
+
+/** LANES boards of the same dimensions, played side by side for offline analysis (level seeds, balancing).
+ * The boards are stored as structure of arrays: for every cell the bytes of all lanes are next to each other, so
+ * the flood fill, the fall of the blocks, the removal of empty columns and the search for moves run on all lanes
+ * with one vector operation per cell. The cells have a border of empty cells like a fixed Board, so the neighbors
+ * of a cell need no bounds checks.
+ * A lane follows the rules of Grid: a click removes the group of two or more blocks under it, scores one point per
+ * block, the blocks fall down and the empty columns close to the left. Cells are named by their packed index
+ * (col * height + row). Boards have at most BATCH_MAX_CELLS cells and block types below EMPTY_CELL. */
+template <typename Lanes>
+class BatchBoards
+{
+public:
+    static constexpr int LANES = Lanes::SIZE;
+
+private:
+    using Vec = typename Lanes::Vec;
+
+    int width;
+    int height;
+    int stride;                  // Cells of a column, with the border.
+    int numCells;                // Cells with the border.
+    std::vector<uint8_t> cells;  // numCells * LANES bytes: the lanes of a cell are next to each other.
+    std::vector<uint8_t> masks;  // Same layout: the region of the flood fill, or the cells that are moves.
+    std::vector<uint8_t> columns; // Columns a move touched in any lane.
+    uint32_t scores[LANES];
+    int numBlocks[LANES];
+    std::vector<Xoshiro128> rngs; // One per lane, for pickRandomMoves.
+
+    // Index in cells of the cell at (col, row) of the board.
+    int cellAt(int col, int row) const { return (col + 1) * stride + row + 1; }
+
+    Vec get(const std::vector<uint8_t> &bytes, int i) const { return Lanes::load(&bytes[i * LANES]); }
+    void put(std::vector<uint8_t> &bytes, int i, Vec vec) { Lanes::store(&bytes[i * LANES], vec); }
+
+    // Let the blocks of the touched columns fall, then move the columns that still hold blocks to the left.
+    void collapse(int firstCol);
+
+public:
+    BatchBoards(int newWidth, int newHeight);
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+    // Put a board of the batch dimensions in a lane, with a score of 0.
+    void load(int lane, const PackedBoard &board);
+    // Copy the board of a lane, which is resized to the batch dimensions.
+    void store(int lane, PackedBoard &board) const;
+
+    uint32_t getScore(int lane) const { return scores[lane]; }
+    int getNumBlocks(int lane) const { return numBlocks[lane]; }
+
+    // Set hasMove[lane] to 1 if the lane has a group of two or more blocks left, 0 otherwise. Returns the lanes with one.
+    int findMoves(uint8_t *hasMove) const;
+
+    // Seed the random generators of pickRandomMoves, lane l with seed + l.
+    void seed(uint32_t newSeed);
+
+    /** Pick a random block of a group of two or more in every lane and put its cell in cellIndices (EMPTY_CELL if
+     * the lane has no move left). Every such block is as likely, so bigger groups are picked more often.
+     * Returns the lanes with a move. */
+    int pickRandomMoves(uint8_t *cellIndices);
+
+    /** Click cellIndices[lane] in every lane. Lanes where it is not a block of a group of two or more, or that get
+     * EMPTY_CELL, do not change. removed[lane] is set to the blocks the click removed. Returns the lanes that moved. */
+    int play(const uint8_t *cellIndices, uint8_t *removed);
+};
+
+template <typename Lanes>
+BatchBoards<Lanes>::BatchBoards(int newWidth, int newHeight)
+    : width(newWidth), height(newHeight), stride(newHeight + 2), numCells((newWidth + 2) * (newHeight + 2)),
+      cells(numCells * LANES, EMPTY_CELL), masks(numCells * LANES, 0), columns(newWidth, 0)
+{
+    for (int lane = 0; lane < LANES; lane++)
+    {
+        scores[lane] = 0;
+        numBlocks[lane] = 0;
+    }
+    seed(1);
+}
+
+template <typename Lanes>
+void BatchBoards<Lanes>::load(int lane, const PackedBoard &board)
+{
+    numBlocks[lane] = 0;
+    scores[lane] = 0;
+    for (int col = 0; col < width; col++)
+    {
+        for (int row = 0; row < height; row++)
+        {
+            uint8_t blockType = board.get(col, row);
+            cells[cellAt(col, row) * LANES + lane] = blockType;
+            numBlocks[lane] += blockType != EMPTY_CELL;
+        }
+    }
+}
+
+template <typename Lanes>
+void BatchBoards<Lanes>::store(int lane, PackedBoard &board) const
+{
+    board.resize(width, height);
+    for (int col = 0; col < width; col++)
+    {
+        for (int row = 0; row < height; row++)
+        {
+            board[board.index(col, row)] = cells[cellAt(col, row) * LANES + lane];
+        }
+    }
+}
+
+template <typename Lanes>
+int BatchBoards<Lanes>::findMoves(uint8_t *hasMove) const
+{
+    const Vec empty = Lanes::set1(EMPTY_CELL);
+    Vec found = Lanes::set1(0);
+    for (int col = 0; col < width; col++)
+    {
+        for (int row = 0; row < height; row++)
+        {
+            // Every pair of neighbors is seen from its upper or left cell. The border never matches a block.
+            int i = cellAt(col, row);
+            Vec cell = get(cells, i);
+            Vec same = Lanes::bitOr(Lanes::eq(cell, get(cells, i + 1)), Lanes::eq(cell, get(cells, i + stride)));
+            found = Lanes::bitOr(found, Lanes::andNot(Lanes::eq(cell, empty), same));
+        }
+    }
+    uint8_t bytes[LANES];
+    Lanes::store(bytes, found);
+    int numLanes = 0;
+    for (int lane = 0; lane < LANES; lane++)
+    {
+        hasMove[lane] = bytes[lane] != 0;
+        numLanes += hasMove[lane];
+    }
+    return numLanes;
+}
+
+template <typename Lanes>
+void BatchBoards<Lanes>::seed(uint32_t newSeed)
+{
+    rngs.clear();
+    for (int lane = 0; lane < LANES; lane++)
+    {
+        rngs.emplace_back(newSeed + lane);
+    }
+}
+
+template <typename Lanes>
+int BatchBoards<Lanes>::pickRandomMoves(uint8_t *cellIndices)
+{
+    const Vec empty = Lanes::set1(EMPTY_CELL);
+    const Vec one = Lanes::set1(1);
+
+    // Mark the blocks with a neighbor of the same type and count them per lane.
+    Vec count = Lanes::set1(0);
+    for (int col = 0; col < width; col++)
+    {
+        for (int row = 0; row < height; row++)
+        {
+            int i = cellAt(col, row);
+            Vec cell = get(cells, i);
+            Vec same = Lanes::bitOr(Lanes::bitOr(Lanes::eq(cell, get(cells, i - 1)), Lanes::eq(cell, get(cells, i + 1))),
+                                    Lanes::bitOr(Lanes::eq(cell, get(cells, i - stride)),
+                                                 Lanes::eq(cell, get(cells, i + stride))));
+            Vec isMove = Lanes::andNot(Lanes::eq(cell, empty), same);
+            put(masks, i, isMove);
+            count = Lanes::add(count, Lanes::bitAnd(isMove, one));
+        }
+    }
+
+    // Draw the number of the block to pick in every lane.
+    uint8_t counts[LANES];
+    uint8_t picks[LANES];
+    Lanes::store(counts, count);
+    int numLanes = 0;
+    for (int lane = 0; lane < LANES; lane++)
+    {
+        picks[lane] = counts[lane] > 0 ? rngs[lane].nextBelow(counts[lane]) : EMPTY_CELL;
+        numLanes += counts[lane] > 0;
+    }
+
+    // Find that block: the one that is a move when that many moves came before it.
+    Vec pick = Lanes::load(picks);
+    Vec seen = Lanes::set1(0);
+    Vec chosen = empty;
+    for (int col = 0; col < width; col++)
+    {
+        for (int row = 0; row < height; row++)
+        {
+            Vec isMove = get(masks, cellAt(col, row));
+            Vec hit = Lanes::bitAnd(isMove, Lanes::eq(seen, pick));
+            chosen = Lanes::select(hit, Lanes::set1(col * height + row), chosen);
+            seen = Lanes::add(seen, Lanes::bitAnd(isMove, one));
+        }
+    }
+    Lanes::store(cellIndices, chosen);
+    return numLanes;
+}
+
+template <typename Lanes>
+int BatchBoards<Lanes>::play(const uint8_t *cellIndices, uint8_t *removed)
+{
+    const Vec empty = Lanes::set1(EMPTY_CELL);
+    const Vec zero = Lanes::set1(0);
+    const Vec one = Lanes::set1(1);
+
+    // Start the region at the clicked cell of every lane, and take the block type there.
+    Vec start = Lanes::load(cellIndices);
+    Vec blockType = empty;
+    for (int col = 0; col < width; col++)
+    {
+        for (int row = 0; row < height; row++)
+        {
+            int i = cellAt(col, row);
+            Vec cell = get(cells, i);
+            Vec hit = Lanes::eq(start, Lanes::set1(col * height + row));
+            put(masks, i, Lanes::andNot(Lanes::eq(cell, empty), hit));
+            blockType = Lanes::select(hit, cell, blockType);
+        }
+    }
+
+    // Grow the regions with sweeps forward and backward until no lane grows. A sweep already sees the cells it added,
+    // so a region spreads along a whole column or row in one sweep.
+    Vec grown;
+    int firstCell = cellAt(0, 0);
+    int lastCell = cellAt(width - 1, height - 1);
+    bool backward = false;
+    do
+    {
+        grown = zero;
+        for (int step = 0; step <= lastCell - firstCell; step++)
+        {
+            int i = backward ? lastCell - step : firstCell + step;
+            Vec region = get(masks, i);
+            Vec neighbors = Lanes::bitOr(Lanes::bitOr(get(masks, i - 1), get(masks, i + 1)),
+                                         Lanes::bitOr(get(masks, i - stride), get(masks, i + stride)));
+            Vec added = Lanes::andNot(region, Lanes::bitAnd(neighbors, Lanes::eq(get(cells, i), blockType)));
+            put(masks, i, Lanes::bitOr(region, added));
+            grown = Lanes::bitOr(grown, added);
+        }
+        backward = !backward;
+    } while (Lanes::any(grown));
+
+    // Count the regions. Only the ones of two or more blocks are moves.
+    Vec size = zero;
+    for (int col = 0; col < width; col++)
+    {
+        for (int row = 0; row < height; row++)
+        {
+            size = Lanes::add(size, Lanes::bitAnd(get(masks, cellAt(col, row)), one));
+        }
+    }
+    Vec isMove = Lanes::andNot(Lanes::bitOr(Lanes::eq(size, zero), Lanes::eq(size, one)), Lanes::set1(0xFF));
+    Lanes::store(removed, Lanes::bitAnd(size, isMove));
+    if (!Lanes::any(isMove))
+    {
+        return 0;
+    }
+
+    // Remove the blocks of the moves.
+    int firstCol = width;
+    for (int col = 0; col < width; col++)
+    {
+        Vec touched = zero;
+        for (int row = 0; row < height; row++)
+        {
+            int i = cellAt(col, row);
+            Vec remove = Lanes::bitAnd(get(masks, i), isMove);
+            put(cells, i, Lanes::select(remove, empty, get(cells, i)));
+            touched = Lanes::bitOr(touched, remove);
+        }
+        columns[col] = Lanes::any(touched);
+        firstCol = columns[col] && col < firstCol ? col : firstCol;
+    }
+    collapse(firstCol);
+
+    int numLanes = 0;
+    for (int lane = 0; lane < LANES; lane++)
+    {
+        scores[lane] += removed[lane];
+        numBlocks[lane] -= removed[lane];
+        numLanes += removed[lane] > 0;
+    }
+    return numLanes;
+}
+
+template <typename Lanes>
+void BatchBoards<Lanes>::collapse(int firstCol)
+{
+    const Vec empty = Lanes::set1(EMPTY_CELL);
+
+    // A pass moves every block above an empty cell one row down, and the lowest of them all the way.
+    // It runs again until no block moves.
+    for (int col = firstCol; col < width; col++)
+    {
+        if (!columns[col])
+        {
+            continue;
+        }
+        int top = cellAt(col, 0);
+        Vec moved;
+        do
+        {
+            moved = Lanes::set1(0);
+            for (int i = top; i < top + height - 1; i++)
+            {
+                Vec block = get(cells, i);
+                Vec below = get(cells, i + 1);
+                Vec fall = Lanes::andNot(Lanes::eq(block, empty), Lanes::eq(below, empty));
+                put(cells, i + 1, Lanes::select(fall, block, below));
+                put(cells, i, Lanes::select(fall, empty, block));
+                moved = Lanes::bitOr(moved, fall);
+            }
+        } while (Lanes::any(moved));
+    }
+
+    // The same for the columns: an empty column (its bottom cell is empty) takes the column to its right.
+    int bottom = height - 1;
+    Vec moved;
+    do
+    {
+        moved = Lanes::set1(0);
+        for (int col = firstCol; col < width - 1; col++)
+        {
+            Vec shift = Lanes::andNot(Lanes::eq(get(cells, cellAt(col + 1, bottom)), empty),
+                                      Lanes::eq(get(cells, cellAt(col, bottom)), empty));
+            if (!Lanes::any(shift))
+            {
+                continue;
+            }
+            for (int row = 0; row < height; row++)
+            {
+                int left = cellAt(col, row);
+                int right = cellAt(col + 1, row);
+                Vec next = get(cells, right);
+                put(cells, left, Lanes::select(shift, next, get(cells, left)));
+                put(cells, right, Lanes::select(shift, empty, next));
+            }
+            moved = Lanes::bitOr(moved, shift);
+        }
+    } while (Lanes::any(moved));
+}
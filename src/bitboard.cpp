@@ -0,0 +1,110 @@
+#include "bitboard.h"
+
+// Set the board dimensions and precompute the edge masks.
+void BitBoardEngine::setDimensions(int boardWidth, int boardHeight)
+{
+    width = boardWidth;
+    height = boardHeight;
+
+    notTopRow = BitBoard();
+    notBottomRow = BitBoard();
+    for (int col = 0; col < width; col++)
+    {
+        for (int row = 0; row < height; row++)
+        {
+            int cellIndex = col * height + row;
+            if (row > 0)
+            {
+                notTopRow.set(cellIndex);
+            }
+            if (row < height - 1)
+            {
+                notBottomRow.set(cellIndex);
+            }
+        }
+    }
+}
+
+// Build the per-type masks from the board.
+void BitBoardEngine::load(const PackedBoard &board)
+{
+    for (int type = 0; type < MAX_BLOCK_TYPES; type++)
+    {
+        typeMasks[type] = BitBoard();
+    }
+
+    numTypes = 0;
+    int numCells = width * height;
+    for (int cellIndex = 0; cellIndex < numCells; cellIndex++)
+    {
+        uint8_t blockType = board[cellIndex];
+        if (blockType != EMPTY_CELL)
+        {
+            typeMasks[blockType].set(cellIndex);
+            if (blockType >= numTypes)
+            {
+                numTypes = blockType + 1;
+            }
+        }
+    }
+}
+
+/** Grow region by one cell in the four directions, restricted to mask.
+ * A shift by 1 moves a cell one row down (or up), but it would also wrap the bottom
+ * cell of a column onto the top of the next one. The row masks drop those wrapped cells.
+ * A shift by height moves a cell one column right (or left). */
+BitBoard BitBoardEngine::dilate(const BitBoard &region, const BitBoard &mask) const
+{
+    BitBoard grown = region;
+    grown |= region.shiftUp(1) & notTopRow;
+    grown |= region.shiftDown(1) & notBottomRow;
+    grown |= region.shiftUp(height);
+    grown |= region.shiftDown(height);
+    return grown & mask;
+}
+
+// Region of cells from mask connected to the cells of seed.
+BitBoard BitBoardEngine::floodFill(const BitBoard &seed, const BitBoard &mask) const
+{
+    BitBoard region = seed & mask;
+    while (true)
+    {
+        BitBoard grown = dilate(region, mask);
+        if (grown == region)
+        {
+            return region;
+        }
+        region = grown;
+    }
+}
+
+// Region of same-type cells connected to cellIndex.
+BitBoard BitBoardEngine::floodFill(int cellIndex) const
+{
+    for (int type = 0; type < numTypes; type++)
+    {
+        if (typeMasks[type].test(cellIndex))
+        {
+            return floodFill(BitBoard::single(cellIndex), typeMasks[type]);
+        }
+    }
+    return BitBoard(); // The cell is empty.
+}
+
+// Check if any two adjacent cells hold the same block type.
+bool BitBoardEngine::hasAnyMove() const
+{
+    for (int type = 0; type < numTypes; type++)
+    {
+        const BitBoard &mask = typeMasks[type];
+        // A cell whose lower neighbor has the same type.
+        BitBoard vertical = mask & mask.shiftDown(1) & notBottomRow;
+        // A cell whose right neighbor has the same type.
+        BitBoard horizontal = mask & mask.shiftDown(height);
+        if (!(vertical | horizontal).isEmpty())
+        {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <stdint.h>
+#include "board.h"
+
+// Number of cells a bitboard can hold. All shipped board sizes (up to 16x6) fit.
+#define BITBOARD_CELLS 128
+
+/** Set of cells stored as a 128-bit mask in two 64-bit words.
+ * Bit i is the cell with packed index i of a PackedBoard (column-major),
+ * so moving one row down is a shift by 1 and one column right is a shift by the height. */
+struct BitBoard
+{
+    uint64_t lo = 0; // Cells 0..63
+    uint64_t hi = 0; // Cells 64..127
+
+    BitBoard() {}
+    BitBoard(uint64_t low, uint64_t high) : lo(low), hi(high) {}
+
+    // Bitboard with only the cell at cellIndex set.
+    static BitBoard single(int cellIndex)
+    {
+        return cellIndex < 64 ? BitBoard(1ULL << cellIndex, 0) : BitBoard(0, 1ULL << (cellIndex - 64));
+    }
+
+    bool isEmpty() const { return (lo | hi) == 0; }
+    int count() const { return __builtin_popcountll(lo) + __builtin_popcountll(hi); }
+    bool test(int cellIndex) const
+    {
+        return cellIndex < 64 ? (lo >> cellIndex) & 1 : (hi >> (cellIndex - 64)) & 1;
+    }
+    void set(int cellIndex)
+    {
+        if (cellIndex < 64)
+            lo |= 1ULL << cellIndex;
+        else
+            hi |= 1ULL << (cellIndex - 64);
+    }
+
+    // Index of the lowest set cell. The bitboard must not be empty.
+    int lowest() const { return lo ? __builtin_ctzll(lo) : 64 + __builtin_ctzll(hi); }
+    // Index of the highest set cell. The bitboard must not be empty.
+    int highest() const { return hi ? 127 - __builtin_clzll(hi) : 63 - __builtin_clzll(lo); }
+
+    // Move every cell n positions to a higher index (0 <= n < 128).
+    BitBoard shiftUp(int n) const
+    {
+        if (n == 0)
+            return *this;
+        if (n >= 64)
+            return BitBoard(0, lo << (n - 64));
+        return BitBoard(lo << n, (hi << n) | (lo >> (64 - n)));
+    }
+
+    // Move every cell n positions to a lower index (0 <= n < 128).
+    BitBoard shiftDown(int n) const
+    {
+        if (n == 0)
+            return *this;
+        if (n >= 64)
+            return BitBoard(hi >> (n - 64), 0);
+        return BitBoard((lo >> n) | (hi << (64 - n)), hi >> n);
+    }
+
+    BitBoard operator|(const BitBoard &o) const { return BitBoard(lo | o.lo, hi | o.hi); }
+    BitBoard operator&(const BitBoard &o) const { return BitBoard(lo & o.lo, hi & o.hi); }
+    BitBoard operator~() const { return BitBoard(~lo, ~hi); }
+    BitBoard &operator|=(const BitBoard &o)
+    {
+        lo |= o.lo;
+        hi |= o.hi;
+        return *this;
+    }
+    BitBoard &operator&=(const BitBoard &o)
+    {
+        lo &= o.lo;
+        hi &= o.hi;
+        return *this;
+    }
+    bool operator==(const BitBoard &o) const { return lo == o.lo && hi == o.hi; }
+    bool operator!=(const BitBoard &o) const { return !(*this == o); }
+
+    // Call callback(cellIndex) for every set cell, from the lowest index to the highest.
+    template <typename Callback>
+    void forEach(Callback callback) const
+    {
+        for (uint64_t word = lo; word; word &= word - 1)
+            callback(__builtin_ctzll(word));
+        for (uint64_t word = hi; word; word &= word - 1)
+            callback(64 + __builtin_ctzll(word));
+    }
+};
+
+/** Flood fill and move detection on a board of at most BITBOARD_CELLS cells.
+ * One bitboard per block type is built from the PackedBoard, after which
+ * every query is a handful of shift-and-mask operations. Nothing is allocated. */
+class BitBoardEngine
+{
+private:
+    int width = 0;
+    int height = 0;
+    BitBoard notTopRow;     // Cells that are not in row 0.
+    BitBoard notBottomRow;  // Cells that are not in the last row.
+    BitBoard typeMasks[MAX_BLOCK_TYPES];
+    int numTypes = 0;
+
+    // Grow region by one step in the four directions, restricted to mask.
+    BitBoard dilate(const BitBoard &region, const BitBoard &mask) const;
+
+public:
+    // Check if a board of the given dimensions fits in a bitboard.
+    static bool fits(int boardWidth, int boardHeight)
+    {
+        return boardWidth * boardHeight <= BITBOARD_CELLS;
+    }
+
+    // Set the board dimensions and precompute the edge masks.
+    void setDimensions(int boardWidth, int boardHeight);
+
+    // Build the per-type masks from the board (dimensions must match).
+    void load(const PackedBoard &board);
+
+    // Mask of the cells holding the given block type.
+    const BitBoard &typeMask(int blockType) const { return typeMasks[blockType]; }
+    int getNumTypes() const { return numTypes; }
+
+    // Region of same-type cells connected to cellIndex (empty if the cell is empty).
+    BitBoard floodFill(int cellIndex) const;
+
+    // Region of cells from mask connected to the cells of seed.
+    BitBoard floodFill(const BitBoard &seed, const BitBoard &mask) const;
+
+    // Check if any two adjacent cells hold the same block type.
+    bool hasAnyMove() const;
+
+    /** Call callback(region, blockType) for every connected region with at least
+     * minSize cells. Regions of a type are reported in order of their lowest cell. */
+    template <typename Callback>
+    void forEachRegion(Callback callback, int minSize = 1) const
+    {
+        for (int type = 0; type < numTypes; type++)
+        {
+            BitBoard remaining = typeMasks[type];
+            while (!remaining.isEmpty())
+            {
+                BitBoard region = floodFill(BitBoard::single(remaining.lowest()), remaining);
+                remaining &= ~region;
+                if (region.count() >= minSize)
+                {
+                    callback(region, type);
+                }
+            }
+        }
+    }
+};
@@ -0,0 +1,130 @@
+#include <algorithm>
+#include "board.h"
+
+// Fill the Zobrist table at compile time.
+static constexpr std::array<uint64_t, ZOBRIST_TABLE_CELLS * MAX_BLOCK_TYPES> makeZobristTable()
+{
+    std::array<uint64_t, ZOBRIST_TABLE_CELLS * MAX_BLOCK_TYPES> keys = {};
+    for (int i = 0; i < ZOBRIST_TABLE_CELLS * MAX_BLOCK_TYPES; i++)
+    {
+        keys[i] = zobristMix(i / MAX_BLOCK_TYPES, i % MAX_BLOCK_TYPES);
+    }
+    return keys;
+}
+
+extern const std::array<uint64_t, ZOBRIST_TABLE_CELLS * MAX_BLOCK_TYPES> zobristTable = makeZobristTable();
+
+// Constructor of the PackedBoard class
+PackedBoard::PackedBoard(int newWidth, int newHeight)
+{
+    resize(newWidth, newHeight);
+}
+
+// Change the dimensions of the board. Only allocates when the board grows.
+void PackedBoard::resize(int newWidth, int newHeight)
+{
+    width = newWidth;
+    height = newHeight;
+    cells.assign(width * height, EMPTY_CELL);
+}
+
+// Make every cell of the board empty.
+void PackedBoard::clear()
+{
+    std::fill(cells.begin(), cells.end(), (uint8_t)EMPTY_CELL);
+}
+
+/** Single pass over the columns from firstCol to the right.
+ * Each column in [firstCol, lastCol] is compacted towards its bottom row,
+ * then every column that still holds blocks is copied to the next free column on the left.
+ * The columns that are left over at the right are cleared. */
+ColumnRange PackedBoard::collapse(int firstCol, int lastCol, uint64_t *hash)
+{
+    ColumnRange changed = {firstCol, lastCol};
+    int newCol = firstCol; // Where the next non-empty column goes.
+
+    for (int col = firstCol; col < width; col++)
+    {
+        uint8_t *columnCells = column(col);
+
+        // Make the blocks of the column "fall" down.
+        if (col <= lastCol)
+        {
+            int newRow = height - 1;
+            for (int row = height - 1; row >= 0; row--)
+            {
+                if (columnCells[row] != EMPTY_CELL)
+                {
+                    if (hash && newRow != row)
+                    {
+                        *hash ^= zobristKey(index(col, row), columnCells[row]) ^ zobristKey(index(col, newRow), columnCells[row]);
+                    }
+                    columnCells[newRow] = columnCells[row];
+                    newRow--;
+                }
+            }
+            // Clear the cells above the fallen blocks.
+            std::fill(columnCells, columnCells + newRow + 1, (uint8_t)EMPTY_CELL);
+        }
+
+        // Skip the empty columns, they get overwritten or cleared.
+        if (isColumnEmpty(col))
+        {
+            continue;
+        }
+
+        // Move the column to the left.
+        if (newCol != col)
+        {
+            if (hash)
+            {
+                // The blocks of a settled column are at the bottom, from its first non-empty row down.
+                for (int row = height - 1; row >= 0 && columnCells[row] != EMPTY_CELL; row--)
+                {
+                    *hash ^= zobristKey(index(col, row), columnCells[row]) ^ zobristKey(index(newCol, row), columnCells[row]);
+                }
+            }
+            std::copy(columnCells, columnCells + height, column(newCol));
+            if (changed.last < newCol)
+            {
+                changed.last = newCol;
+            }
+        }
+        newCol++;
+    }
+
+    // Clear the columns at the right that were moved to the left.
+    for (int col = newCol; col < width; col++)
+    {
+        if (!isColumnEmpty(col))
+        {
+            std::fill(column(col), column(col) + height, (uint8_t)EMPTY_CELL);
+            if (changed.last < col)
+            {
+                changed.last = col;
+            }
+        }
+    }
+    return changed;
+}
+
+// Zobrist hash of the blocks in the columns [firstCol, lastCol].
+uint64_t PackedBoard::hashColumns(int firstCol, int lastCol) const
+{
+    uint64_t hash = 0;
+    for (int col = firstCol; col <= lastCol; col++)
+    {
+        // The blocks of a settled column are at its bottom, an empty one has none.
+        for (int row = height - 1; row >= 0 && get(col, row) != EMPTY_CELL; row--)
+        {
+            hash ^= zobristKey(index(col, row), get(col, row));
+        }
+    }
+    return hash;
+}
+
+// Two boards are equal when they have the same dimensions and the same cells.
+bool PackedBoard::operator==(const PackedBoard &other) const
+{
+    return width == other.width && height == other.height && cells == other.cells;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <stdint.h>
+#include <array>
+#include <vector>
+
+// Value of a cell that holds no block.
+#define EMPTY_CELL 0xFF
+// Maximum number of different block types a board can hold.
+#define MAX_BLOCK_TYPES 8
+
+// Cells whose Zobrist keys are read from a table instead of mixed on every use.
+#define ZOBRIST_TABLE_CELLS 256
+
+// Zobrist key of a block of the given type in the cell, mixed from the cell and type (splitmix64).
+constexpr uint64_t zobristMix(int cellIndex, int blockType)
+{
+    uint64_t key = ((uint64_t)cellIndex * MAX_BLOCK_TYPES + blockType + 1) * 0x9E3779B97F4A7C15ULL;
+    key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    key = (key ^ (key >> 27)) * 0x94D049BB133111EBULL;
+    return key ^ (key >> 31);
+}
+
+// The keys of the first ZOBRIST_TABLE_CELLS cells, computed at compile time (read-only data, in flash on the device).
+extern const std::array<uint64_t, ZOBRIST_TABLE_CELLS * MAX_BLOCK_TYPES> zobristTable;
+
+/** Zobrist key of a block of the given type in the cell. The hash of a board is the XOR of the keys of its blocks,
+ * so a move updates it with the keys of the blocks it removes or moves. The keys of bigger boards are mixed on use,
+ * so boards of any size hash the same on the device and the host. */
+inline uint64_t zobristKey(int cellIndex, uint8_t blockType)
+{
+    return cellIndex < ZOBRIST_TABLE_CELLS ? zobristTable[cellIndex * MAX_BLOCK_TYPES + blockType]
+                                           : zobristMix(cellIndex, blockType);
+}
+
+// Inclusive range of board columns. Empty when first > last.
+struct ColumnRange
+{
+    int first;
+    int last;
+
+    bool isEmpty() const { return first > last; }
+};
+
+/** Packed storage of the game board.
+ * Every cell is one byte holding the block type (or EMPTY_CELL),
+ * and all cells live in one contiguous column-major array,
+ * so the cells of a column are next to each other in memory. */
+class PackedBoard
+{
+private:
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> cells; // width * height cells, column after column.
+
+public:
+    PackedBoard(int newWidth = 0, int newHeight = 0);
+
+    // Change the dimensions of the board. All cells become empty.
+    void resize(int newWidth, int newHeight);
+
+    // Make every cell of the board empty.
+    void clear();
+
+    // Accessors
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    int getNumCells() const { return width * height; }
+
+    // Index of the cell (col, row) in the packed array.
+    int index(int col, int row) const { return col * height + row; }
+
+    uint8_t get(int col, int row) const { return cells[index(col, row)]; }
+    bool isEmpty(int col, int row) const { return get(col, row) == EMPTY_CELL; }
+
+    // Access to a cell by its packed index.
+    uint8_t operator[](int cellIndex) const { return cells[cellIndex]; }
+    uint8_t &operator[](int cellIndex) { return cells[cellIndex]; }
+
+    // Pointer to the first (top) cell of a column. The column has height cells.
+    const uint8_t *column(int col) const { return &cells[index(col, 0)]; }
+    uint8_t *column(int col) { return &cells[index(col, 0)]; }
+
+    // Mutators
+    void set(int col, int row, uint8_t blockType) { cells[index(col, row)] = blockType; }
+    void erase(int col, int row) { cells[index(col, row)] = EMPTY_CELL; }
+
+    // Check if a column holds no block (a settled column is empty when its bottom cell is).
+    bool isColumnEmpty(int col) const { return get(col, height - 1) == EMPTY_CELL; }
+
+    /** Let the blocks of the columns [firstCol, lastCol] fall down, then shift every
+     * non-empty column from firstCol on to the left so that the empty columns end up at the right.
+     * Columns outside [firstCol, lastCol] must already be settled.
+     * If hash is given, the Zobrist hash is updated for every block that falls or shifts.
+     * Returns the range of columns whose content changed. */
+    ColumnRange collapse(int firstCol, int lastCol, uint64_t *hash = nullptr);
+
+    // Zobrist hash of the blocks in the columns [firstCol, lastCol], or of the whole board. The board must be settled.
+    uint64_t hashColumns(int firstCol, int lastCol) const;
+    uint64_t hash() const { return hashColumns(0, width - 1); }
+
+    bool operator==(const PackedBoard &other) const;
+    bool operator!=(const PackedBoard &other) const { return !(*this == other); }
+};
@@ -1,10 +1,16 @@
 #pragma once
 
-#include <M5StickC.h>
-#include <map>
 #include <vector>
-#include <optional>
-#include <queue>
+#include "hal.h"
+#include "board.h"
+#include "bitboard.h"
+#include "components.h"
+#include "renderer.h"
+#include "tilt_filter.h"
+#include "move_log.h"
+#include "undo_history.h"
+#include "solver.h"
+#include "generator.h"
 
 // Constants
 #define SCREEN_WIDTH 160
@@ -12,33 +18,56 @@
 #define BLOCK_WIDTH 10
 #define BLOCK_HEIGHT 10
 
-// Tilt constant used for moving the cursor
-#define MIN_TILT 0.15
+// Size of the boards of the game. Boards bigger than the screen scroll (e.g. -DBOARD_WIDTH=64 -DBOARD_HEIGHT=32).
+#ifndef BOARD_WIDTH
+#define BOARD_WIDTH 16
+#endif
+#ifndef BOARD_HEIGHT
+#define BOARD_HEIGHT 6
+#endif
+// Height of the score line above the board.
+#define STATUS_HEIGHT 10
+// Cells the screen shows at most: the visible part of a bigger board (the view).
+#define VIEW_COLS (SCREEN_WIDTH / BLOCK_WIDTH)
+#define VIEW_ROWS ((SCREEN_HEIGHT - STATUS_HEIGHT) / BLOCK_HEIGHT)
+// Cells the view keeps between the cursor and its edges while it scrolls.
+#define VIEW_MARGIN 2
+
+// Layout of the persistent storage. The save and the move log grow with the board size.
+#define HEADER_ADDRESS 0 // STORAGE_MAGIC (4 bytes), then STORAGE_VERSION (1 byte).
+#define SCORE_ADDRESS 8  // 1 byte that is 1 if there is a best score, then the best score (4 bytes).
+#define SAVE_ADDRESS 16  // The saved game (see save_format.h), at most SAVE_SIZE bytes.
+#define SAVE_SIZE ((int)maxSaveSize(BOARD_WIDTH, BOARD_HEIGHT))
+// The move log of the game being played, up to MEM_SIZE (see move_log.h). At 128 unless the save needs more room.
+#define LOG_ADDRESS (SAVE_ADDRESS + SAVE_SIZE > 128 ? SAVE_ADDRESS + SAVE_SIZE : 128)
+// Room the move log needs: its header, two checkpoints of the board and the moves between them.
+#define LOG_MIN_SIZE (MOVE_LOG_HEADER_SIZE + 2 * (4 + SAVE_SIZE) + 2 * MOVE_LOG_CHECKPOINT_MOVES + 1)
+// Size of the persistent storage in bytes: 1 KB, more if the move log of the board needs it.
+#define MEM_SIZE (LOG_ADDRESS + LOG_MIN_SIZE > 1024 ? LOG_ADDRESS + LOG_MIN_SIZE : 1024)
+static_assert(SAVE_ADDRESS + SAVE_SIZE <= LOG_ADDRESS, "The save would overwrite the move log");
+static_assert(LOG_ADDRESS + LOG_MIN_SIZE <= MEM_SIZE, "The move log does not fit in the storage");
+#define STORAGE_MAGIC 0x53474D45 // "EMGS"
+#define STORAGE_VERSION 1        // Raise when the layout changes, the storage is formatted again.
+
+// Timing of the game loop (in ms).
+#define FRAME_MS 20          // One tick of the scheduler.
+#define END_SCREEN_MS 5000   // How long the won/lost message stays on the screen.
+#define PERSIST_MS 1000      // How often pending saves are committed to flash.
+
+// Number of accelerometer samples taken from the input in one batch.
+#define ACCEL_BATCH_SIZE 16
+
+// Time the hint solver gets: one slice per tick, so the input keeps being handled, for at most HINT_SLICES ticks.
+#define HINT_SLICE_US 5000
+#define HINT_SLICES 3
+
+/** Check the header of the persistent storage and format it only if the header is missing or of an other version.
+ * Returns true if the storage was formatted. */
+bool prepareStorage(Storage &storage);
 
 // Grid class forward declaration for Cursor.
 class Grid;
 
-// Block Class Declaration
-class Block
-{
-private:
-    int width = BLOCK_WIDTH;
-    int height = BLOCK_HEIGHT;
-    int blockType; // Block type determines the color.
-
-public:
-    Block();
-
-    // Accessors
-    int getBlockType();
-
-    // Mutators
-    void setBlockType(int newBlockType);
-
-    // Method to draw a block
-    void drawBlock(int col, int row, int color, int topSpace);
-};
-
 // Cursor class
 class Cursor
 {
@@ -59,9 +88,6 @@ public:
     // Mutators
     void setX(int newX);
     void setY(int newY);
-
-    // Method to draw the cursor on the screen.
-    void drawCursor();
 };
 
 // Grid Class Declaration
@@ -73,25 +99,61 @@ private:
     int numDifferentBlocks;
     int numBlocks;
     int topSpace;
+    // Visible part of the board: its first column and row, and how many of them fit on the screen.
+    int viewCol = 0;
+    int viewRow = 0;
+    int viewCols = 0;
+    int viewRows = 0;
     int score = 0;
-    int bestScore = 0;
+    uint32_t seed = 0;           // Seed the board was generated from.
+    uint64_t hash = 0;           // Zobrist hash of the matrix, updated by every move.
+    static int bestScore;        // Shared by every grid: read from storage once, on first use.
+    static bool bestScoreLoaded;
     int gameEnded = 0; // variable that is 1 if the game has ended.
 
+    BitBoardEngine bitboard;      // Used for flood fill on boards that fit in it.
+    ComponentLabels components;   // Groups of the matrix, updated by every move: answers if a move is left.
+    std::vector<int> regionCells; // Packed indices of the last collected region (reserved for the whole board).
+    std::vector<uint8_t> saveBuffer;    // Encoded save (reserved for the whole board).
+    PackedBoard viewCells;              // Cells of the view, drawn by drawGrid.
+    UndoHistory history;                // Diffs of the last moves, for undo and redo.
+    ColumnRange dirtyColumns = {0, -1}; // Columns that changed since the last snapshot.
+    const char *endMessage = "";       // Message shown once the game has ended.
+
+    // Help method for deleteSameColorNeighbors. Collects the region at (col, row) in regionCells.
+    void collectRegion(int col, int row);
+    // Set up the bitboard, the region buffer and the save buffer for the current dimensions.
+    void prepareBoardBuffers();
+    // Fit the view to the board dimensions and the screen, and put it around the cursor.
+    void setupView();
+    // Scroll the view to keep the cursor VIEW_MARGIN cells away from its edges, and set the cursor position on the screen.
+    void scrollToCursor();
+    // Copy the cells of the view into window, the board the renderer draws.
+    void copyView(PackedBoard &window);
+    // The columns of the view in the given board columns, numbered from the first column of the view.
+    ColumnRange viewColumns(ColumnRange columns);
+    // Help method for loadGame and replay. Puts a saved board in the grid.
+    void setBoard(const SavedGame &saved);
+
+    friend bool prepareStorage(Storage &storage); // Forgets the best score when the storage is formatted.
+
 public:
-    std::map<int, int> blockColors = {
-        {0, RED},
-        {1, BLUE},
-        {2, GREEN},
-        {3, YELLOW},
-        {4, PURPLE},
-    }; // Map of block types to colors
+    uint16_t blockColors[MAX_BLOCK_TYPES] = {
+        COLOR_RED,
+        COLOR_BLUE,
+        COLOR_GREEN,
+        COLOR_YELLOW,
+        COLOR_PURPLE,
+    }; // Color of every block type
 
     Cursor cursor;
     int rowCursor;
     int colCursor;
-    std::vector<std::vector<std::optional<Block>>> matrix; // 2D matrix of blocks
+    PackedBoard matrix; // Block type of every cell, EMPTY_CELL if there is no block.
 
     Grid();
+    Grid(int newWidth, int newHeight, int newNumDifferentBlocks);
+    Grid(int newWidth, int newHeight, int newNumDifferentBlocks, uint32_t newSeed);
 
     void initializeGrid();
 
@@ -102,38 +164,55 @@ public:
     int getBlockColor(int blockType);
     int getNumBlocks();
     int getTopSpace();
+    int getScore();
+    uint32_t getSeed();
+    // Zobrist hash of the matrix. Only valid while the matrix is changed through the methods of the grid.
+    uint64_t getHash();
 
     // Mutators
     void setWidth(int newWidth);
     void setHeight(int newHeight);
     void setNumBlocks(int newAmount);
     void setGameEnded(int value);
+    // Put a board in the grid, with a score of 0 and no moves to undo (used by host tools).
+    void setMatrix(const PackedBoard &newMatrix);
 
     // Method to draw the grid
     void drawGrid();
+    // Methods to hand the grid to the renderer as a snapshot.
+    void markDirty(ColumnRange columns);
+    void markViewDirty(ColumnRange columns);
+    void fillSnapshot(FrameSnapshot &frame);
 
     // Methods to move the cursor
-    void moveCursor();
-    void eraseCursor(int col, int row);
-    int updateCursorPosition();
+    void moveCursor(int stepCol, int stepRow);
+    void placeCursor(int col, int row);
+    int updateCursorPosition(int stepCol, int stepRow);
 
-    // Methods to delete blocks of same color at cursor location.
-    void deleteSameColorNeighbors();
-    void updateBlocksPositions(int mostLeftCol, int mostDownRow);
-    void updateRows(int mostLeftCol, int mostDownRow);
-    void updateColumns(int mostLeftCol, int mostDownRow);
+    // Methods to delete blocks of same color at cursor location. Returns true if blocks were deleted.
+    bool deleteSameColorNeighbors();
+    void updateBlocksPositions(int mostLeftCol, int mostRightCol);
 
     // Methods to save and load the game.
     void saveGame();
     void loadGame();
+    // Method to continue a logged game. Returns false if a move of the log does not fit the board.
+    bool replay(const LoggedGame &logged);
+
+    // Methods to take back a move and to make it again. Return false if there is none.
+    bool undo();
+    bool redo();
 
     // Methods to save and load best score.
     void saveScore();
     void loadScore();
+    int getBestScore();
 
     // Method to check for the different end conditions.
     void checkEndCondition();
     int anyPossibilityLeft();
+    // Blocks the click at the cursor would remove, 0 if it is not a move.
+    int getCursorGroupSize();
 
     // Method to check if the gameEnded variable indicates 1.
     bool hasEnded();
@@ -145,11 +224,65 @@ public:
     int selectedOption;
     int numOptions;
 
-    Menu(int selectedOpt = 0, int numOpts = 4);
+    Menu(int selectedOpt = 0);
 
     // Method to scroll down the menu.
     void goDownMenu();
 
     // Method to draw the menu on the screen.
     void drawMenu();
-};
\ No newline at end of file
+    // Method to hand the menu to the renderer as a snapshot.
+    void fillSnapshot(FrameSnapshot &frame);
+};
+
+/** The game as a state machine driven by the scheduler.
+ * Each tick the input is sampled, the game is updated and a snapshot of the frame is published.
+ * Nothing blocks, so no button press is missed. */
+class Game
+{
+private:
+    enum GameState
+    {
+        STATE_PLAYING,
+        STATE_MENU,
+        STATE_END_SCREEN,
+    };
+
+    GameState state = STATE_PLAYING;
+    Grid grid;
+    Menu menu;
+    MoveLog moveLog; // Autosave of the grid: its seed and the moves since.
+    Solver solver;   // Looks for a hint in the background of the game.
+    int hintSlicesLeft = 0;
+    FrameSnapshot frame; // Reused for every published frame.
+
+    // Latest input sample.
+    bool pressedA = false;
+    bool pressedB = false;
+    TiltFilter tilt;                          // Turns the accelerometer samples into cursor steps.
+    AccelSample accelBatch[ACCEL_BATCH_SIZE]; // Samples taken from the input in one tick.
+
+    uint32_t endScreenUntil = 0;
+
+    void updatePlaying(uint32_t now);
+    void updateMenu(uint32_t now);
+    void startNewGame();
+
+    // Autosave through the move log.
+    bool resumeGame();
+    void startLog(bool withCheckpoint);
+    void logMove(int cellIndex);
+    void stepHint();
+    void publishLevel();
+
+public:
+    /** The hardware abstraction layer must be set up first, because the grid is made right away.
+     * The game that was being played when the power went off is resumed from the move log. */
+    Game();
+
+    // The scheduler tasks of the logic side. The frames and saves go through the pipeline.
+    void sampleInput(uint32_t now);
+    void update(uint32_t now);
+    void publish(uint32_t now);
+    void persist(uint32_t now);
+};
@@ -0,0 +1,232 @@
+#include <algorithm>
+#include "components.h"
+
+// Root of the group of a block, halving the path on the way.
+int ComponentLabels::find(int cellIndex)
+{
+    while (parent[cellIndex] != cellIndex)
+    {
+        parent[cellIndex] = parent[parent[cellIndex]];
+        cellIndex = parent[cellIndex];
+    }
+    return cellIndex;
+}
+
+// Merge the groups of two blocks. The bigger group keeps its root, so the paths to it stay short.
+void ComponentLabels::unite(int a, int b)
+{
+    a = find(a);
+    b = find(b);
+    if (a == b)
+    {
+        return;
+    }
+    if (sizes[a] < sizes[b])
+    {
+        std::swap(a, b);
+    }
+    numMoves -= (sizes[a] >= 2) + (sizes[b] >= 2);
+    parent[b] = a;
+    sizes[a] += sizes[b];
+    numMoves += sizes[a] >= 2;
+}
+
+/** Label a cell of a column scan: the block joins the group of the block above it, and is merged with the group on its
+ * left. The cells above and on the left must have their labels already. */
+void ComponentLabels::scanCell(const PackedBoard &board, int cellIndex, int row)
+{
+    uint8_t blockType = board[cellIndex];
+    retired[cellIndex] = false;
+    if (blockType == EMPTY_CELL)
+    {
+        parent[cellIndex] = -1;
+        return;
+    }
+
+    if (row > 0 && board[cellIndex - 1] == blockType)
+    {
+        int root = find(cellIndex - 1);
+        parent[cellIndex] = root;
+        numMoves += sizes[root] == 1;
+        sizes[root]++;
+    }
+    else
+    {
+        parent[cellIndex] = cellIndex;
+        sizes[cellIndex] = 1;
+    }
+
+    if (cellIndex >= height && board[cellIndex - height] == blockType)
+    {
+        unite(cellIndex, cellIndex - height);
+    }
+}
+
+// Label the columns [firstCol, lastCol] by a column scan.
+void ComponentLabels::scanColumns(const PackedBoard &board, int firstCol, int lastCol)
+{
+    int cellIndex = firstCol * height;
+    for (int col = firstCol; col <= lastCol; col++)
+    {
+        for (int row = 0; row < height; row++)
+        {
+            scanCell(board, cellIndex, row);
+            cellIndex++;
+        }
+    }
+}
+
+// Merge the group of the block with the groups of its four neighbors of the same type.
+void ComponentLabels::uniteNeighbors(const PackedBoard &board, int cellIndex)
+{
+    uint8_t blockType = board[cellIndex];
+    int row = cellIndex % height;
+    if (row > 0 && board[cellIndex - 1] == blockType)
+    {
+        unite(cellIndex, cellIndex - 1);
+    }
+    if (row + 1 < height && board[cellIndex + 1] == blockType)
+    {
+        unite(cellIndex, cellIndex + 1);
+    }
+    if (cellIndex >= height && board[cellIndex - height] == blockType)
+    {
+        unite(cellIndex, cellIndex - height);
+    }
+    if (cellIndex + height < board.getNumCells() && board[cellIndex + height] == blockType)
+    {
+        unite(cellIndex, cellIndex + height);
+    }
+}
+
+// Label every group of the board.
+void ComponentLabels::label(const PackedBoard &board)
+{
+    width = board.getWidth();
+    height = board.getHeight();
+    int numCells = board.getNumCells();
+
+    parent.resize(numCells);
+    sizes.resize(numCells);
+    retired.resize(numCells);
+    visits.assign(numCells, 0);
+    pendingCells.reserve(numCells);
+    numUpdates = 0;
+    numMoves = 0;
+
+    scanColumns(board, 0, width - 1);
+}
+
+// Update the labels after a move.
+void ComponentLabels::update(const PackedBoard &board, ColumnRange changed)
+{
+    int firstCell = changed.first * height;
+    int lastCell = (changed.last + 1) * height;
+    if (board.getWidth() != width || board.getHeight() != height || 2 * (lastCell - firstCell) > board.getNumCells())
+    {
+        // Another board, or a move that changed most of it: labeling it from scratch is faster.
+        label(board);
+        return;
+    }
+    if (changed.isEmpty())
+    {
+        return;
+    }
+
+    // The groups that had a block in the changed columns are retired: they may have lost blocks or fallen apart.
+    for (int cellIndex = firstCell; cellIndex < lastCell; cellIndex++)
+    {
+        if (parent[cellIndex] >= 0)
+        {
+            int root = find(cellIndex);
+            if (!retired[root])
+            {
+                retired[root] = true;
+                numMoves -= sizes[root] >= 2;
+            }
+        }
+    }
+
+    /** Their blocks outside the changed columns have to be labeled again too. They are connected to the changed
+     * columns through each other, so a fill from the columns on both sides finds them all. The links are only
+     * reset once the fill is done, because it follows them to the roots. */
+    numUpdates++;
+    pendingCells.clear();
+    auto visit = [&](int cellIndex)
+    {
+        if (parent[cellIndex] >= 0 && visits[cellIndex] != numUpdates && retired[find(cellIndex)])
+        {
+            visits[cellIndex] = numUpdates;
+            pendingCells.push_back(cellIndex);
+        }
+    };
+    for (int row = 0; row < height; row++)
+    {
+        if (firstCell > 0)
+        {
+            visit(firstCell - height + row);
+        }
+        if (lastCell < board.getNumCells())
+        {
+            visit(lastCell + row);
+        }
+    }
+    for (size_t next = 0; next < pendingCells.size(); next++)
+    {
+        int cellIndex = pendingCells[next];
+        int row = cellIndex % height;
+        if (row > 0)
+        {
+            visit(cellIndex - 1);
+        }
+        if (row + 1 < height)
+        {
+            visit(cellIndex + 1);
+        }
+        if (cellIndex - height >= 0 && (cellIndex - height < firstCell || cellIndex - height >= lastCell))
+        {
+            visit(cellIndex - height);
+        }
+        if (cellIndex + height < board.getNumCells() && (cellIndex + height < firstCell || cellIndex + height >= lastCell))
+        {
+            visit(cellIndex + height);
+        }
+    }
+    for (int cellIndex : pendingCells)
+    {
+        parent[cellIndex] = cellIndex;
+        sizes[cellIndex] = 1;
+        retired[cellIndex] = false;
+    }
+
+    // The changed columns are labeled by a column scan, which merges them with the column on their left.
+    scanColumns(board, changed.first, changed.last);
+    if (lastCell < board.getNumCells())
+    {
+        for (int cellIndex = lastCell - height; cellIndex < lastCell; cellIndex++)
+        {
+            if (board[cellIndex] != EMPTY_CELL && board[cellIndex + height] == board[cellIndex])
+            {
+                unite(cellIndex, cellIndex + height);
+            }
+        }
+    }
+
+    // Then the other blocks of the retired groups are merged with all their neighbors.
+    for (int cellIndex : pendingCells)
+    {
+        uniteNeighbors(board, cellIndex);
+    }
+}
+
+// Blocks in the group of the cell.
+int ComponentLabels::sizeAt(int cellIndex)
+{
+    return parent[cellIndex] < 0 ? 0 : sizes[find(cellIndex)];
+}
+
+// Check if two cells are in the same group.
+bool ComponentLabels::sameGroup(int cellIndex, int otherIndex)
+{
+    return parent[cellIndex] >= 0 && parent[otherIndex] >= 0 && find(cellIndex) == find(otherIndex);
+}
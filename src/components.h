@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "board.h"
+
+/** Labels of every group of same-type blocks of a board (its connected components), kept up to date after each move.
+ * A union-find over the cells: every block links to a block of its group, and the block at the end of the links
+ * (the root) holds the size of the group.
+ * label() visits the cells once, column after column: a block joins the group of the block above it if they have
+ * the same type, and is merged with the group on its left.
+ * update() retires the groups that had a block in the columns a move changed, labels those columns and the other
+ * blocks of the retired groups again, and merges them with their neighbors. The groups away from the move keep
+ * their links, so a move costs about the cells it touched, not the board.
+ * The number of groups of two or more blocks (the moves) is counted on the way, so checking for a move left is a
+ * lookup.
+ * The buffers are sized for the board once, so labeling never allocates while the board size stays the same. */
+class ComponentLabels
+{
+private:
+    int width = 0;
+    int height = 0;
+    std::vector<int> parent;       // Next block of the group of every cell, the cell itself for a root, -1 if empty.
+    std::vector<int> sizes;        // Blocks of the group of every root.
+    std::vector<uint8_t> retired;  // Roots of the groups retired by the running update.
+    std::vector<uint32_t> visits;  // Update that last found the cell as a block of a retired group.
+    std::vector<int> pendingCells; // Blocks of retired groups outside the changed columns (reserved for the board).
+    uint32_t numUpdates = 0;
+    int numMoves = 0;
+
+    int find(int cellIndex);
+    void unite(int a, int b);
+    void scanCell(const PackedBoard &board, int cellIndex, int row);
+    void scanColumns(const PackedBoard &board, int firstCol, int lastCol);
+    void uniteNeighbors(const PackedBoard &board, int cellIndex);
+
+public:
+    // Label every group of the board.
+    void label(const PackedBoard &board);
+
+    /** Update the labels after a move. changed holds the columns whose content changed (as collapse, undoMove and
+     * redoMove return them). The board must be the board the labels came from, after the move. */
+    void update(const PackedBoard &board, ColumnRange changed);
+
+    // Blocks in the group of the cell, 0 for an empty cell.
+    int sizeAt(int cellIndex);
+    // Check if two cells are in the same group.
+    bool sameGroup(int cellIndex, int otherIndex);
+
+    // Groups of two or more blocks.
+    int getNumMoves() const { return numMoves; }
+    bool hasMove() const { return numMoves > 0; }
+};
@@ -0,0 +1,257 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include "board.h"
+
+// Range of the board sizes that get a Board instantiation (the sizes the game ships, see Grid). Narrow it with build
+// flags to save flash; the other sizes fall back to PackedBoard and MoveGenerator.
+#ifndef FIXED_BOARD_MIN_WIDTH
+#define FIXED_BOARD_MIN_WIDTH 10
+#endif
+#ifndef FIXED_BOARD_MAX_WIDTH
+#define FIXED_BOARD_MAX_WIDTH 16
+#endif
+#ifndef FIXED_BOARD_MIN_HEIGHT
+#define FIXED_BOARD_MIN_HEIGHT 4
+#endif
+#ifndef FIXED_BOARD_MAX_HEIGHT
+#define FIXED_BOARD_MAX_HEIGHT 6
+#endif
+
+/** Board of W x H cells with up to Colors block types, and its move logic, with the dimensions known at compile time.
+ * The cells are stored column-major like a PackedBoard, with a border of empty cells around them: a column has
+ * H + 2 cells and there is an empty column on both sides. The neighbors of a cell are then at fixed offsets and
+ * always inside the array, and an empty cell never matches a block, so the flood fill has no bounds checks.
+ * With constant dimensions the compiler unrolls the column loops and turns the copies into a few wide moves.
+ * Moves are named by the packed index of a cell (col * H + row), and forEachMove reports them in the same order
+ * as MoveGenerator, so a search gives the same result on both. play() is the move of MoveGenerator::play.
+ * Block types must be below Colors. */
+template <int W, int H, int Colors>
+class Board
+{
+public:
+    static constexpr int WIDTH = W;
+    static constexpr int HEIGHT = H;
+    static constexpr int STRIDE = H + 2; // Cells of a column, with the border.
+    static constexpr int NUM_CELLS = (W + 2) * STRIDE;
+    static constexpr int NEIGHBOR_OFFSETS[4] = {-1, 1, -STRIDE, STRIDE};
+
+    static_assert(W > 0 && H > 0 && Colors > 0 && Colors <= MAX_BLOCK_TYPES, "Invalid board dimensions");
+
+private:
+    uint8_t cells[NUM_CELLS];
+
+    // Index in cells of the cell at (col, row) of the board.
+    static constexpr int cellAt(int col, int row) { return (col + 1) * STRIDE + row + 1; }
+    // Index in cells of the cell with a packed index.
+    static constexpr int fromPacked(int cellIndex) { return cellAt(cellIndex / H, cellIndex % H); }
+
+    uint8_t *column(int col) { return cells + cellAt(col, 0); }
+    bool isColumnEmpty(int col) const { return cells[cellAt(col, H - 1)] == EMPTY_CELL; }
+
+public:
+    Board() { memset(cells, EMPTY_CELL, sizeof(cells)); }
+
+    // Copy the cells of a W x H board.
+    void load(const PackedBoard &board)
+    {
+        for (int col = 0; col < W; col++)
+        {
+            memcpy(column(col), board.column(col), H);
+        }
+    }
+
+    // Copy the cells to a board, which is resized to W x H.
+    void store(PackedBoard &board) const
+    {
+        board.resize(W, H);
+        for (int col = 0; col < W; col++)
+        {
+            memcpy(board.column(col), cells + cellAt(col, 0), H);
+        }
+    }
+
+    // A settled board is empty when its first column is.
+    bool isCleared() const { return isColumnEmpty(0); }
+
+    // Call callback(cellIndex, blockType, size) for every region of at least two blocks, cellIndex is its lowest cell.
+    template <typename Callback>
+    void forEachMove(Callback callback) const;
+
+    // Remove the region at cellIndex (a packed index) and let the board collapse. Returns the number of removed blocks.
+    int play(int cellIndex);
+};
+
+template <int W, int H, int Colors>
+template <typename Callback>
+void Board<W, H, Colors>::forEachMove(Callback callback) const
+{
+    struct Region
+    {
+        uint8_t blockType;
+        int16_t cellIndex;
+        int16_t size;
+    };
+    uint8_t visited[NUM_CELLS];
+    int16_t stack[W * H];
+    Region regions[W * H / 2];
+    int numRegions = 0;
+    memset(visited, 0, sizeof(visited));
+
+    for (int col = 0; col < W; col++)
+    {
+        for (int row = 0; row < H; row++)
+        {
+            int start = cellAt(col, row);
+            uint8_t blockType = cells[start];
+            if (blockType == EMPTY_CELL || visited[start])
+            {
+                continue;
+            }
+            int top = 0;
+            int size = 1;
+            stack[top++] = start;
+            visited[start] = 1;
+            while (top > 0)
+            {
+                int i = stack[--top];
+                for (int offset : NEIGHBOR_OFFSETS)
+                {
+                    int neighbor = i + offset;
+                    if (cells[neighbor] == blockType && !visited[neighbor])
+                    {
+                        visited[neighbor] = 1;
+                        stack[top++] = neighbor;
+                        size++;
+                    }
+                }
+            }
+            if (size >= 2)
+            {
+                regions[numRegions++] = {blockType, (int16_t)(col * H + row), (int16_t)size};
+            }
+        }
+    }
+
+    // The bitboard of MoveGenerator reports the regions type after type.
+    for (int blockType = 0; blockType < Colors; blockType++)
+    {
+        for (int i = 0; i < numRegions; i++)
+        {
+            if (regions[i].blockType == blockType)
+            {
+                callback(regions[i].cellIndex, blockType, regions[i].size);
+            }
+        }
+    }
+}
+
+template <int W, int H, int Colors>
+int Board<W, H, Colors>::play(int cellIndex)
+{
+    int start = fromPacked(cellIndex);
+    uint8_t blockType = cells[start];
+    if (blockType == EMPTY_CELL)
+    {
+        return 0;
+    }
+
+    // Remove the region, the cells are emptied as they are found.
+    int16_t stack[W * H];
+    int top = 0;
+    int size = 1;
+    int firstCol = start / STRIDE - 1;
+    int lastCol = firstCol;
+    stack[top++] = start;
+    cells[start] = EMPTY_CELL;
+    while (top > 0)
+    {
+        int i = stack[--top];
+        int col = i / STRIDE - 1;
+        firstCol = col < firstCol ? col : firstCol;
+        lastCol = col > lastCol ? col : lastCol;
+        for (int offset : NEIGHBOR_OFFSETS)
+        {
+            int neighbor = i + offset;
+            if (cells[neighbor] == blockType)
+            {
+                cells[neighbor] = EMPTY_CELL;
+                stack[top++] = neighbor;
+                size++;
+            }
+        }
+    }
+
+    // Make the blocks of the changed columns fall down. Every cell is written, the slot of an empty cell is either
+    // filled by a block above it or left empty.
+    for (int col = firstCol; col <= lastCol; col++)
+    {
+        uint8_t *columnCells = column(col);
+        int newRow = H - 1;
+        for (int row = H - 1; row >= 0; row--)
+        {
+            uint8_t block = columnCells[row];
+            columnCells[newRow] = block;
+            newRow -= block != EMPTY_CELL;
+        }
+        for (; newRow >= 0; newRow--)
+        {
+            columnCells[newRow] = EMPTY_CELL;
+        }
+    }
+
+    // Move the columns that still hold blocks to the left, and clear the ones left over at the right.
+    int newCol = firstCol;
+    for (int col = firstCol; col < W; col++)
+    {
+        if (isColumnEmpty(col))
+        {
+            continue;
+        }
+        if (newCol != col)
+        {
+            memcpy(column(newCol), column(col), H);
+        }
+        newCol++;
+    }
+    for (int col = newCol; col < W; col++)
+    {
+        memset(column(col), EMPTY_CELL, H);
+    }
+    return size;
+}
+
+template <int W, int H, typename Function>
+bool dispatchFixedBoard(int width, int height, Function &function)
+{
+    if (width == W && height == H)
+    {
+        Board<W, H, MAX_BLOCK_TYPES> board;
+        function(board);
+        return true;
+    }
+    if constexpr (H < FIXED_BOARD_MAX_HEIGHT)
+    {
+        return dispatchFixedBoard<W, H + 1>(width, height, function);
+    }
+    else if constexpr (W < FIXED_BOARD_MAX_WIDTH)
+    {
+        return dispatchFixedBoard<W + 1, FIXED_BOARD_MIN_HEIGHT>(width, height, function);
+    }
+    return false;
+}
+
+/** Call function(board) with an empty Board of the given dimensions, if they are in the range of the fixed boards.
+ * function must take any Board (a generic lambda: [&](auto &board) { ... }). Returns false for the other sizes,
+ * which the caller handles with a PackedBoard. */
+template <typename Function>
+bool withFixedBoard(int width, int height, Function function)
+{
+    if (width < FIXED_BOARD_MIN_WIDTH || width > FIXED_BOARD_MAX_WIDTH || height < FIXED_BOARD_MIN_HEIGHT ||
+        height > FIXED_BOARD_MAX_HEIGHT)
+    {
+        return false;
+    }
+    return dispatchFixedBoard<FIXED_BOARD_MIN_WIDTH, FIXED_BOARD_MIN_HEIGHT>(width, height, function);
+}
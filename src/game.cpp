@@ -0,0 +1,245 @@
+#include "classes.h"
+#include "pipeline.h"
+
+// Constructor of the Game class. The first published frame draws the grid.
+Game::Game() : moveLog(LOG_ADDRESS, MEM_SIZE)
+{
+  if (!resumeGame())
+  {
+    startLog(false);
+    publishLevel();
+  }
+}
+
+// Read the buttons and the accelerometer once per tick.
+void Game::sampleInput(uint32_t now)
+{
+  (void)now;
+  hal.input->update();
+  pressedA = hal.input->wasPressedA();
+  pressedB = hal.input->wasPressedB();
+
+  // Feed all samples since the last tick to the filter.
+  // The IMU is mounted rotated, so x is the tilt down and y the tilt to the right.
+  int numSamples;
+  do
+  {
+    numSamples = hal.input->readAccelSamples(accelBatch, ACCEL_BATCH_SIZE);
+    for (int i = 0; i < numSamples; i++)
+    {
+      tilt.addSample(accelBatch[i].time, accelBatch[i].y, accelBatch[i].x);
+    }
+  } while (numSamples == ACCEL_BATCH_SIZE);
+}
+
+// Advance the game by one tick.
+void Game::update(uint32_t now)
+{
+  switch (state)
+  {
+  case STATE_PLAYING:
+    updatePlaying(now);
+    break;
+  case STATE_MENU:
+    updateMenu(now);
+    break;
+  case STATE_END_SCREEN:
+    // Keep the won/lost message on the screen for a while, then begin a new game.
+    if ((int32_t)(now - endScreenUntil) >= 0)
+    {
+      startNewGame();
+    }
+    break;
+  }
+}
+
+// Publish a snapshot of what the screen has to show to the render side.
+void Game::publish(uint32_t now)
+{
+  (void)now;
+  frame.sequence++;
+  frame.changed = {0, -1};
+  if (state == STATE_MENU)
+  {
+    menu.fillSnapshot(frame);
+  }
+  else
+  {
+    grid.fillSnapshot(frame);
+  }
+
+  // A dropped frame is not lost: its changed columns (of the view) go into the next one.
+  if (!pipeline.publishFrame(frame))
+  {
+    grid.markViewDirty(frame.changed);
+  }
+}
+
+// Hand pending saves to the persistence side, outside of the input path.
+void Game::persist(uint32_t now)
+{
+  (void)now;
+  hal.storage->commitIfPending();
+}
+
+// Help method for update. Moves the cursor and handles the buttons during a game.
+void Game::updatePlaying(uint32_t now)
+{
+  stepHint();
+
+  // Step the cursor when the device gets tilted, then faster and faster the more it is tilted.
+  CursorStep step = tilt.step(now);
+  if (step.col != 0 || step.row != 0)
+  {
+    grid.moveCursor(step.col, step.row);
+  }
+
+  // Enter the menu screen.
+  if (pressedB)
+  {
+    solver.cancel();
+    menu = Menu();
+    state = STATE_MENU;
+  }
+  // Update the game.
+  else if (pressedA)
+  {
+    int cellIndex = grid.matrix.index(grid.colCursor, grid.rowCursor);
+    if (grid.deleteSameColorNeighbors())
+    {
+      solver.cancel(); // A hint for the board before the move is of no use anymore.
+      logMove(cellIndex);
+    }
+    if (grid.hasEnded())
+    {
+      endScreenUntil = now + END_SCREEN_MS;
+      state = STATE_END_SCREEN;
+    }
+  }
+}
+
+// Help method for update. Scrolls through the menu and selects an option.
+void Game::updateMenu(uint32_t now)
+{
+  (void)now;
+  if (pressedB) // Scroll down the menu.
+  {
+    menu.goDownMenu();
+    return;
+  }
+  if (!pressedA)
+  {
+    return;
+  }
+
+  // Select an option.
+  state = STATE_PLAYING;
+  switch (menu.selectedOption)
+  {
+  case 0: // option 1: return (do nothing)
+    break;
+  case 1: // option 2: look for a good move. The search runs during the next ticks.
+    solver.start(grid.matrix);
+    hintSlicesLeft = HINT_SLICES;
+    break;
+  case 2: // option 3: take back the last move.
+  case 3: // option 4: make the move that was taken back again.
+    if (menu.selectedOption == 2 ? grid.undo() : grid.redo())
+    {
+      startLog(true); // The log only holds moves forward, so it starts over from the board as it is now.
+    }
+    break;
+  case 4: // option 5: we save the game.
+    grid.saveGame();
+    break;
+  case 5: // option 6: we load a previously saved game.
+    grid.loadGame();
+    startLog(true); // A loaded board has no seed to replay from.
+    break;
+  case 6: // option 7: begin a new game.
+    startNewGame();
+    break;
+  }
+}
+
+// Replace the grid by a new one.
+void Game::startNewGame()
+{
+  grid = Grid(); // The next frame draws the new grid.
+  state = STATE_PLAYING;
+  startLog(false);
+  publishLevel();
+}
+
+// Hand the new level to the background analysis, if the device runs one. It is skipped when the analysis is behind.
+void Game::publishLevel()
+{
+  LevelInfo level;
+  level.width = grid.getWidth();
+  level.height = grid.getHeight();
+  level.numBlockTypes = grid.getNumDifferentBlocks();
+  level.seed = grid.getSeed();
+  pipeline.publishLevel(level);
+}
+
+// Give the hint search its slice of this tick. When it is over, the cursor goes to the best move it found.
+void Game::stepHint()
+{
+  if (!solver.isRunning())
+  {
+    return;
+  }
+  hintSlicesLeft--;
+  if (!solver.step(HINT_SLICE_US) && hintSlicesLeft > 0)
+  {
+    return;
+  }
+  solver.cancel();
+  int cellIndex = solver.getResult().cellIndex;
+  if (cellIndex >= 0)
+  {
+    grid.placeCursor(cellIndex / grid.getHeight(), cellIndex % grid.getHeight());
+  }
+}
+
+// Continue the game of the move log, unless there is none or it has ended.
+bool Game::resumeGame()
+{
+  LoggedGame logged;
+  if (!moveLog.read(*hal.storage, logged))
+  {
+    return false;
+  }
+  Grid resumed;
+  if (!resumed.replay(logged) || resumed.hasEnded())
+  {
+    return false;
+  }
+  grid = std::move(resumed);
+  return true;
+}
+
+// Start the log of the current grid: its seed, and a checkpoint if the board does not come from the seed.
+void Game::startLog(bool withCheckpoint)
+{
+  if (!moveLog.start(*hal.storage, grid.getWidth(), grid.getHeight(), grid.getNumDifferentBlocks(), grid.getSeed()) ||
+      (withCheckpoint &&
+       !moveLog.appendCheckpoint(*hal.storage, grid.matrix, grid.getNumDifferentBlocks(), grid.getScore())))
+  {
+    moveLog.clear(*hal.storage); // This grid can not be logged.
+  }
+  hal.storage->requestCommit();
+}
+
+// Append an accepted move to the log, with a checkpoint now and then. The persistence task commits it.
+void Game::logMove(int cellIndex)
+{
+  if (!moveLog.appendMove(*hal.storage, cellIndex) ||
+      (moveLog.needsCheckpoint() &&
+       !moveLog.appendCheckpoint(*hal.storage, grid.matrix, grid.getNumDifferentBlocks(), grid.getScore())))
+  {
+    startLog(true); // The log is full: start over from a checkpoint of the board as it is now.
+    return;
+  }
+  hal.storage->requestCommit();
+}
@@ -0,0 +1,151 @@
+#include "fixed_board.h"
+#include "generator.h"
+
+static uint32_t rotateLeft(uint32_t value, int bits)
+{
+    return (value << bits) | (value >> (32 - bits));
+}
+
+// Constructor of the Xoshiro128 class. Every word of the state comes from splitmix32, so it is never all zero.
+Xoshiro128::Xoshiro128(uint32_t seed)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        seed += 0x9E3779B9;
+        uint32_t z = seed;
+        z = (z ^ (z >> 16)) * 0x85EBCA6B;
+        z = (z ^ (z >> 13)) * 0xC2B2AE35;
+        state[i] = z ^ (z >> 16);
+    }
+}
+
+// Next number of the sequence.
+uint32_t Xoshiro128::next()
+{
+    uint32_t result = rotateLeft(state[1] * 5, 7) * 9;
+    uint32_t shifted = state[1] << 9;
+    state[2] ^= state[0];
+    state[3] ^= state[1];
+    state[1] ^= state[2];
+    state[0] ^= state[3];
+    state[2] ^= shifted;
+    state[3] = rotateLeft(state[3], 11);
+    return result;
+}
+
+// Fill the board from the seed, column after column.
+void generateBoard(PackedBoard &board, int numBlockTypes, uint32_t seed)
+{
+    Xoshiro128 rng(seed);
+    for (int cellIndex = 0; cellIndex < board.getNumCells(); cellIndex++)
+    {
+        board[cellIndex] = rng.nextBelow(numBlockTypes);
+    }
+}
+
+// Count the groups of the position, then play it greedily to the end. numBlocks are the blocks of the position.
+template <typename Position>
+static BoardQuality measurePosition(Position &position, int numBlocks)
+{
+    BoardQuality quality;
+    for (;;)
+    {
+        int bestCell = -1;
+        int bestSize = 0;
+        int numGroups = 0;
+        position.forEachMove([&](int cellIndex, int blockType, int size)
+                             {
+                                 numGroups++;
+                                 if (size > bestSize)
+                                 {
+                                     bestSize = size;
+                                     bestCell = cellIndex;
+                                 } });
+        if (quality.greedyMoves == 0)
+        {
+            quality.numGroups = numGroups;
+            quality.largestGroup = bestSize;
+        }
+        if (bestCell < 0)
+        {
+            break;
+        }
+        numBlocks -= position.play(bestCell);
+        quality.greedyMoves++;
+    }
+    quality.greedyRemaining = numBlocks;
+    return quality;
+}
+
+// Count the groups of the board, then play it greedily to the end, on a Board of fixed size for the shipped sizes.
+BoardQuality measureBoard(const PackedBoard &board, MoveGenerator &moves)
+{
+    int numBlocks = 0;
+    for (int cellIndex = 0; cellIndex < board.getNumCells(); cellIndex++)
+    {
+        numBlocks += board[cellIndex] != EMPTY_CELL;
+    }
+
+    BoardQuality quality;
+    if (withFixedBoard(board.getWidth(), board.getHeight(), [&](auto &position)
+                       {
+                           position.load(board);
+                           quality = measurePosition(position, numBlocks); }))
+    {
+        return quality;
+    }
+    PackedBoard copy = board;
+    GeneratorBoard position = {moves, copy};
+    return measurePosition(position, numBlocks);
+}
+
+// Check the quality against the filter.
+bool isGoodBoard(const BoardQuality &quality, int numCells)
+{
+    return quality.numGroups * GOOD_BOARD_CELLS_PER_GROUP >= numCells &&
+           quality.greedyRemaining * GOOD_BOARD_CELLS_PER_LEFT <= numCells;
+}
+
+// Look for good seeds from firstSeed on.
+int findGoodSeeds(int width, int height, int numBlockTypes, uint32_t firstSeed, uint32_t *seeds, int count,
+                  uint32_t maxTries)
+{
+    PackedBoard board(width, height);
+    MoveGenerator moves;
+    moves.setDimensions(width, height);
+    int numFound = 0;
+    for (uint32_t i = 0; i < maxTries && numFound < count; i++)
+    {
+        uint32_t seed = firstSeed + i;
+        generateBoard(board, numBlockTypes, seed);
+        if (isGoodBoard(measureBoard(board, moves), board.getNumCells()))
+        {
+            seeds[numFound++] = seed;
+        }
+    }
+    return numFound;
+}
+
+// Seed of a good level from the bank.
+uint32_t bankSeed(int numBlockTypes, uint32_t index)
+{
+    int row = numBlockTypes - SEED_BANK_MIN_COLORS;
+    row = row < 0 ? 0 : (row >= SEED_BANK_COLORS ? SEED_BANK_COLORS - 1 : row);
+    return seedBank[row][index % SEED_BANK_SIZE];
+}
+
+// Seed of a new level, filtered on the spot.
+uint32_t levelSeed(int width, int height, int numBlockTypes, uint32_t randomSeed)
+{
+    uint32_t seed = randomSeed;
+    if (width * height > GOOD_SEED_MAX_CELLS ||
+        findGoodSeeds(width, height, numBlockTypes, randomSeed, &seed, 1, GOOD_SEED_TRIES) == 1)
+    {
+        return seed;
+    }
+    if (width == SEED_BANK_WIDTH && height == SEED_BANK_HEIGHT)
+    {
+        return bankSeed(numBlockTypes, randomSeed);
+    }
+    return randomSeed;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdint.h>
+#include "board.h"
+#include "moves.h"
+
+// The bank of good level seeds (src/seed_bank.cpp, written by bench/seed_bank.cpp): boards of these dimensions,
+// SEED_BANK_SIZE seeds for every number of block types from SEED_BANK_MIN_COLORS on.
+#define SEED_BANK_WIDTH 16
+#define SEED_BANK_HEIGHT 6
+#define SEED_BANK_MIN_COLORS 3
+#define SEED_BANK_COLORS 3
+#define SEED_BANK_SIZE 256
+
+// Quality filter: a good board has at least one group of two or more blocks per GOOD_BOARD_CELLS_PER_GROUP cells,
+// and the greedy player (always the biggest group) leaves at most one block in GOOD_BOARD_CELLS_PER_LEFT.
+#define GOOD_BOARD_CELLS_PER_GROUP 6
+#define GOOD_BOARD_CELLS_PER_LEFT 4
+
+// New levels: seeds tried from a random one on before giving up, and the biggest board that is filtered at all. The
+// greedy player makes the filter grow with the square of the cells, and bigger boards pass it nearly always.
+#define GOOD_SEED_TRIES 16
+#define GOOD_SEED_MAX_CELLS 2048
+
+/** xoshiro128**: small, fast generator with a 128-bit state and only 32-bit operations, so it runs as fast on the
+ * ESP32 as on the host and gives the same numbers on both. The state is expanded from a 32-bit seed with splitmix32. */
+class Xoshiro128
+{
+private:
+    uint32_t state[4];
+
+public:
+    explicit Xoshiro128(uint32_t seed);
+
+    uint32_t next();
+
+    // Number in [0, bound), by multiply and shift (no modulo bias worth noting for small bounds).
+    uint32_t nextBelow(uint32_t bound) { return ((uint64_t)next() * bound) >> 32; }
+};
+
+/** Fill every cell of the board with a block type below numBlockTypes, drawn from the seed with Xoshiro128,
+ * column after column. The same seed gives the same board on the device, on the host and on any thread. */
+void generateBoard(PackedBoard &board, int numBlockTypes, uint32_t seed);
+
+// Quick measures of how playable a new board is.
+struct BoardQuality
+{
+    int numGroups = 0;       // Groups of two or more blocks: the moves of the first turn.
+    int largestGroup = 0;    // Blocks in the biggest of them.
+    int greedyMoves = 0;     // Moves of a player that always takes the biggest group.
+    int greedyRemaining = 0; // Blocks that player leaves on the board, 0 if it clears it.
+};
+
+// Measure the board. Boards of other sizes than the fixed ones (fixed_board.h) use the given generator, set up for
+// the dimensions of the board.
+BoardQuality measureBoard(const PackedBoard &board, MoveGenerator &moves);
+
+// Check the quality against the filter above.
+bool isGoodBoard(const BoardQuality &quality, int numCells);
+
+/** Put in seeds the first count seeds from firstSeed on whose boards pass the filter. Returns the number found,
+ * less than count if maxTries seeds were tried first. */
+int findGoodSeeds(int width, int height, int numBlockTypes, uint32_t firstSeed, uint32_t *seeds, int count,
+                  uint32_t maxTries);
+
+// Seed of a good level with the given number of block types, from the bank. index is taken modulo SEED_BANK_SIZE.
+uint32_t bankSeed(int numBlockTypes, uint32_t index);
+
+/** Seed of a new level: the first seed from randomSeed on whose board passes the filter. If none of GOOD_SEED_TRIES
+ * seeds does, a seed from the bank when the board has its dimensions, else randomSeed itself. Boards of more than
+ * GOOD_SEED_MAX_CELLS cells are not filtered. */
+uint32_t levelSeed(int width, int height, int numBlockTypes, uint32_t randomSeed);
+
+extern const uint32_t seedBank[SEED_BANK_COLORS][SEED_BANK_SIZE];
@@ -1,68 +1,80 @@
-#include <M5StickC.h>
 #include <stdint.h>
-#include <ctime>
-#include "EEPROM.h"
+#include <stdio.h>
+#include <algorithm>
 #include "classes.h"
+#include "save_format.h"
+#include "trace.h"
 
-uint32_t black_color = M5.Lcd.color565(0, 0, 0);
-uint32_t white_color = M5.Lcd.color565(255, 255, 255);
+// Draw the seed of a new board from the random number generator of the hal.
+static uint32_t drawSeed()
+{
+    return ((uint32_t)hal.rng->nextInt(0x10000) << 16) | (uint32_t)hal.rng->nextInt(0x10000);
+}
 
 // Constructor of the Grid class
 Grid::Grid()
 {
     // Change the seed each time you generate a new random grid.
-    std::srand(std::time(0));
+    hal.rng->randomize();
 
     /** Because of the small screen too many blocks, becomes unplayable because you dont see them.
      * (you need to make the blocks smaller so that they all fit inside the screen).
      * A small amount is also not fun to play, so I made the randomness be restricted within a range.
      * the range for the width is [10, 16]
      * the range for the height is [4, 6]
-     * the range for the number of different colors is [3, 5] */
-    width = 16; // 10 + (rand() % 7);
-    height = 6; // 4 + (rand() % 3);
-    numDifferentBlocks = 3 + (rand() % 3);
+     * the range for the number of different colors is [3, 5]
+     * Bigger boards (BOARD_WIDTH, BOARD_HEIGHT) do not fit on the screen: the view scrolls with the cursor. */
+    width = BOARD_WIDTH;   // 10 + (rand() % 7);
+    height = BOARD_HEIGHT; // 4 + (rand() % 3);
+    numDifferentBlocks = 3 + hal.rng->nextInt(3);
+    // The level is a random seed whose board passes the quality filter (src/generator.h).
+    seed = levelSeed(width, height, numDifferentBlocks, drawSeed());
     numBlocks = width * height;
-    topSpace = SCREEN_HEIGHT - (height * BLOCK_HEIGHT);
 
     Cursor newCursor;
     cursor = newCursor;
     initializeGrid();
 }
 
+// Constructor of a Grid with the given dimensions and number of block types (used by host tools).
+Grid::Grid(int newWidth, int newHeight, int newNumDifferentBlocks)
+    : Grid(newWidth, newHeight, newNumDifferentBlocks, drawSeed())
+{
+}
+
+// Constructor of the Grid that the given seed generates, used to replay a logged game.
+Grid::Grid(int newWidth, int newHeight, int newNumDifferentBlocks, uint32_t newSeed)
+{
+    width = newWidth;
+    height = newHeight;
+    numDifferentBlocks = newNumDifferentBlocks;
+    seed = newSeed;
+    numBlocks = width * height;
+    initializeGrid();
+}
+
 /** Method that gets called at construction of a grid.
  * It initializes the matrix and the cursor. */
 void Grid::initializeGrid()
 {
     // Resize the matrix to match the grid dimensions
-    matrix.resize(width); // Resize the outer vector to match the number of cols
-    for (int col = 0; col < width; col++)
-    {
-        matrix[col].resize(height); // Resize each col to match the number of rows.
-    }
+    matrix.resize(width, height);
+    prepareBoardBuffers();
 
-    // Initialize the matrix containing the rectangles.
-    for (int col = 0; col < width; col++)
-    {
-        for (int row = 0; row < height; row++)
-        {
-            // Make the new block at the specified (x, y).
-            Block newBlock;
-            newBlock.setBlockType(rand() % numDifferentBlocks);
-            matrix[col][row] = std::make_optional(newBlock);
-        }
-    }
+    // Initialize the matrix containing the block types from the seed, so that a logged game can be replayed.
+    generateBoard(matrix, numDifferentBlocks, seed);
+    hash = matrix.hash();
+    components.label(matrix);
 
     // Initialize the total number of blocks.
     numBlocks = width * height;
-    // Initialize the cursor position to be in the left bottom corner of the grid.
+    // Initialize the cursor position to be in the left bottom corner of the grid, and the view around it.
     colCursor = 0;
     rowCursor = height - 1;
+    setupView();
 
-    loadScore(); // Load the best score stored (if any).
-
-    // Draw the initial grid on the screen with the cursor.
-    drawGrid();
+    // The first frame draws the whole grid with the cursor.
+    markDirty({0, width - 1});
 }
 
 // Accessors for the private variables.
@@ -91,6 +103,21 @@ int Grid::getTopSpace()
     return topSpace;
 }
 
+int Grid::getScore()
+{
+    return score;
+}
+
+uint32_t Grid::getSeed()
+{
+    return seed;
+}
+
+uint64_t Grid::getHash()
+{
+    return hash;
+}
+
 int Grid::getBlockColor(int blockType)
 {
     return blockColors[blockType];
@@ -117,510 +144,523 @@ void Grid::setGameEnded(int value)
     gameEnded = value;
 }
 
-// Method to draw the grid
-void Grid::drawGrid()
+// Put a board in the grid, with a score of 0 and no moves to undo (used by host tools).
+void Grid::setMatrix(const PackedBoard &newMatrix)
 {
-    // Reset everything by drawing the background again.
-    M5.Lcd.fillScreen(black_color);
-
-    // Draw the score and best score.
-    M5.Lcd.setCursor(5, 2);
-    M5.Lcd.printf("Score: %d", score);
+    SavedGame saved;
+    saved.board = newMatrix;
+    saved.numColors = numDifferentBlocks;
+    setBoard(saved);
+}
 
-    M5.Lcd.setCursor(100, 2);
-    M5.Lcd.printf("Best: %d", bestScore);
+/** Method to draw the grid right away, from the thread that owns it (used by host tools).
+ * Only the parts that changed since the last frame are pushed to the screen. */
+void Grid::drawGrid()
+{
+    scrollToCursor();
+    copyView(viewCells);
+    renderer.drawGame(viewCells, blockColors, getTopSpace(), BLOCK_WIDTH, BLOCK_HEIGHT, score, getBestScore(),
+                      getCursorGroupSize(), colCursor - viewCol, rowCursor - viewRow, {0, viewCols - 1});
+}
 
-    // Draw the matrix
-    for (int col = 0; col < width; col++)
+// Remember that the columns in the given range have to be drawn again.
+void Grid::markDirty(ColumnRange columns)
+{
+    if (columns.isEmpty())
     {
-        for (int row = 0; row < height; row++)
-        {
-            std::optional<Block> cell = matrix[col][row];
-            if (cell.has_value()) // Check if the block pointer is not the same as the empty block.
-            {
-                // Get the current block.
-                Block curBlock = cell.value();
-
-                // Get the color of the block.
-                int curBlockType = curBlock.getBlockType();
-                int curBlockColor = blockColors[curBlockType];
-
-                // Draw the block.
-                curBlock.drawBlock(col, row, curBlockColor, getTopSpace());
-            }
-            else // No more block at this location.
-            {
-                int x = col * BLOCK_WIDTH;
-                int y = (row * BLOCK_HEIGHT) + getTopSpace();
-                M5.Lcd.fillRect(x, y, BLOCK_WIDTH, BLOCK_HEIGHT, black_color);
-            }
-        }
+        return;
+    }
+    if (dirtyColumns.isEmpty())
+    {
+        dirtyColumns = columns;
+    }
+    else
+    {
+        dirtyColumns.first = std::min(dirtyColumns.first, columns.first);
+        dirtyColumns.last = std::max(dirtyColumns.last, columns.last);
     }
+}
 
-    // Draw the cursor on top of everything at the end.
-    cursor.drawCursor();
+// Remember that the given columns of the view (numbered from its first column) have to be drawn again.
+void Grid::markViewDirty(ColumnRange columns)
+{
+    markDirty({columns.first + viewCol, columns.last + viewCol});
 }
 
-// Main method that moves the cursor only when needed.
-void Grid::moveCursor()
+// Fit the view to the board dimensions and the screen, and put it around the cursor.
+void Grid::setupView()
 {
-    // Get the current col and row of the cursor.
-    int oldCursorRow = rowCursor;
-    int oldCursorCol = colCursor;
+    viewCols = std::min(width, VIEW_COLS);
+    viewRows = std::min(height, VIEW_ROWS);
+    // A board that fits is drawn at the bottom of the screen, a bigger one right under the score line.
+    topSpace = SCREEN_HEIGHT - viewRows * BLOCK_HEIGHT;
+    viewCells.resize(viewCols, viewRows);
+    scrollToCursor();
+}
 
-    // Update the cursor position.
-    if (updateCursorPosition() == 1) // It means the cursor has changed of position.
+/** Scroll the view to keep the cursor VIEW_MARGIN cells away from its edges, as far as the board goes,
+ * and set the cursor position on the screen. After a scroll the whole view is drawn again: every cell on the
+ * screen shows another cell of the board, and the renderer only pushes the ones whose color changed. */
+void Grid::scrollToCursor()
+{
+    int newViewCol = std::max(std::min(viewCol, colCursor - VIEW_MARGIN), colCursor + VIEW_MARGIN - viewCols + 1);
+    int newViewRow = std::max(std::min(viewRow, rowCursor - VIEW_MARGIN), rowCursor + VIEW_MARGIN - viewRows + 1);
+    newViewCol = std::max(0, std::min(newViewCol, width - viewCols));
+    newViewRow = std::max(0, std::min(newViewRow, height - viewRows));
+    if (newViewCol != viewCol || newViewRow != viewRow)
     {
-        eraseCursor(oldCursorCol, oldCursorRow);
-        cursor.drawCursor(); // Redraw the cursor at the new location.
+        viewCol = newViewCol;
+        viewRow = newViewRow;
+        markDirty({viewCol, viewCol + viewCols - 1});
     }
+    cursor.setX((colCursor - viewCol) * BLOCK_WIDTH);
+    cursor.setY(topSpace + (rowCursor - viewRow) * BLOCK_HEIGHT);
 }
 
-// Help method for moveCursor. Erases cursor (graphically) from old position.
-void Grid::eraseCursor(int col, int row)
+// Copy the cells of the view into window. Only the visible cells are copied, whatever the size of the board.
+void Grid::copyView(PackedBoard &window)
 {
-    // Check if there is a block at the cursor location and get the block color.
-    std::optional<Block> cell = matrix[col][row];
-    if (cell.has_value())
+    if (window.getWidth() != viewCols || window.getHeight() != viewRows)
     {
-        Block cell = matrix[col][row].value();
-        int blockType = cell.getBlockType();
-        uint32_t blockColor = blockColors[blockType];
-        // Draw the block at old cursor location again (to remove the cursor)
-        cell.drawBlock(col, row, blockColor, getTopSpace());
+        window.resize(viewCols, viewRows);
     }
-    else // No more block at this location. Draw a black square.
+    for (int col = 0; col < viewCols; col++)
     {
-        int x = col * BLOCK_WIDTH;
-        int y = row * BLOCK_HEIGHT + getTopSpace();
-        M5.Lcd.fillRect(x, y, BLOCK_WIDTH, BLOCK_HEIGHT, BLACK);
+        const uint8_t *columnCells = matrix.column(viewCol + col) + viewRow;
+        std::copy(columnCells, columnCells + viewRows, window.column(col));
     }
 }
 
-/** Help method for moveCursor. Changes the cursor position based on IMU.
- * Returns 1 if an update was made, 0 otherwise.*/
-int Grid::updateCursorPosition()
+// The columns of the view in the given board columns, numbered from the first column of the view.
+ColumnRange Grid::viewColumns(ColumnRange columns)
 {
-    // Get the accelerator data.
-    float acc_x = 0, acc_y = 0, acc_z = 0;
-    M5.IMU.getAccelData(&acc_y, &acc_x, &acc_z);
+    return {std::max(columns.first, viewCol) - viewCol, std::min(columns.last, viewCol + viewCols - 1) - viewCol};
+}
 
-    // Get the current grid width, and top space.
-    int gridWidth = getWidth() * BLOCK_WIDTH;
-    int gridTopSpace = getTopSpace();
+/** Copy what the screen has to show into the frame: the cells of the view, or the message once the game has ended.
+ * The columns of the view changed since the last call are included, and all changes are forgotten. */
+void Grid::fillSnapshot(FrameSnapshot &frame)
+{
+    if (gameEnded == 1 && endMessage[0] != '\0')
+    {
+        frame.screen = SCREEN_MESSAGE;
+        frame.message = endMessage;
+        return;
+    }
+
+    frame.screen = SCREEN_GAME;
+    scrollToCursor(); // The cursor may have been put on a cell directly.
+    copyView(frame.board); // Reuses the memory of the frame, no allocation once the sizes match.
+    std::copy(blockColors, blockColors + MAX_BLOCK_TYPES, frame.colors);
+    frame.topSpace = getTopSpace();
+    frame.cellWidth = BLOCK_WIDTH;
+    frame.cellHeight = BLOCK_HEIGHT;
+    frame.score = score;
+    frame.bestScore = getBestScore();
+    frame.cursorGroup = getCursorGroupSize();
+    frame.cursorCol = colCursor - viewCol;
+    frame.cursorRow = rowCursor - viewRow;
+    frame.changed = viewColumns(dirtyColumns);
+    dirtyColumns = {0, -1};
+}
+
+// Main method that moves the cursor one step in the direction of the tilt.
+void Grid::moveCursor(int stepCol, int stepRow)
+{
+    // Update the cursor position. The next frame shows it at the new location.
+    updateCursorPosition(stepCol, stepRow);
+}
 
-    // The move logic.
-    int cur_x = cursor.getX();
-    int cur_y = cursor.getY();
+// Method to put the cursor on a cell of the grid.
+void Grid::placeCursor(int col, int row)
+{
+    colCursor = col;
+    rowCursor = row;
+    scrollToCursor();
+}
 
+/** Help method for moveCursor. Moves the cursor by the given steps (-1, 0 or 1 column to the right
+ * and row down), staying on the grid. The view scrolls along on boards bigger than the screen.
+ * Returns 1 if an update was made, 0 otherwise.*/
+int Grid::updateCursorPosition(int stepCol, int stepRow)
+{
     // Value that gets returned at the end. If 0, no updates were made to the current cursor position.
     int changed = 0;
 
-    if (acc_x > MIN_TILT)
+    if (stepCol > 0)
     {
-        if ((cur_x + BLOCK_WIDTH) <= (gridWidth - BLOCK_WIDTH))
+        if (colCursor + 1 < width)
         {
-            cur_x += BLOCK_WIDTH;
-            cursor.setX(cur_x);
             colCursor += 1;
             changed = 1;
         }
     }
-    else if (acc_x < -MIN_TILT)
+    else if (stepCol < 0)
     {
-        if ((cur_x - BLOCK_WIDTH) >= 0)
+        if (colCursor > 0)
         {
-            cur_x -= BLOCK_WIDTH;
-            cursor.setX(cur_x);
             colCursor -= 1;
             changed = 1;
         }
     }
 
-    if (acc_y > MIN_TILT)
+    if (stepRow > 0)
     {
-        if ((cur_y + BLOCK_HEIGHT) < SCREEN_HEIGHT)
+        if (rowCursor + 1 < height)
         {
-            cur_y += BLOCK_HEIGHT;
-            cursor.setY(cur_y);
             rowCursor += 1;
             changed = 1;
         }
     }
-    else if (acc_y < -MIN_TILT)
+    else if (stepRow < 0)
     {
-        if ((cur_y - BLOCK_HEIGHT) >= (0 + gridTopSpace))
+        if (rowCursor > 0)
         {
-            cur_y -= BLOCK_HEIGHT;
-            cursor.setY(cur_y);
             rowCursor -= 1;
             changed = 1;
         }
     }
+
+    scrollToCursor();
     return changed; // 0 if cursor position didn't change, 1 if it changed.
 }
 
+// Set up the bitboard, the region buffer and the save buffer, so that no move or save needs to allocate memory.
+void Grid::prepareBoardBuffers()
+{
+    if (BitBoardEngine::fits(width, height))
+    {
+        bitboard.setDimensions(width, height);
+    }
+    regionCells.reserve(width * height);
+    saveBuffer.reserve(maxSaveSize(width, height));
+}
+
 /** Get the same color neighbors of the block at the current position of the cursor.
  * It deletes the block and the neighbors if 2 or more exist.
- * Function gets called when A button is pressed.
- * A BFS algorithm that returns a list of positions of the neighbors with the same color.*/
-void Grid::deleteSameColorNeighbors()
+ * Function gets called when A button is pressed. */
+bool Grid::deleteSameColorNeighbors()
 {
+    TRACE_SCOPE("move");
     // Start with current position of the cursor.
     int startCol = colCursor;
     int startRow = rowCursor;
-    // Get the color of the start position.
-    std::optional<Block> start = matrix[startCol][startRow];
 
-    // Check if there is a block at current position.
-    if (!start.has_value())
+    // Check if there is a group of two or more blocks at current position.
+    if (components.sizeAt(matrix.index(startCol, startRow)) < 2)
     {
-        return;
+        return false;
     }
 
-    int startType = start.value().getBlockType(); // Used for comparison later on.
+    // Collect the positions of the neighbors with the same color.
+    uint8_t blockType = matrix.get(startCol, startRow);
+    collectRegion(startCol, startRow);
 
-    // Make a matrix to keep track of visited elements so far.
-    std::vector<std::vector<bool>> visited;
-    visited.resize(width); // Resize the outer vector to match the number of cols
-    for (int col = 0; col < width; col++)
+    int mostLeftCol = width - 1;
+    int mostRightCol = 0;
+    if (regionCells.size() >= 2)
     {
-        visited[col].resize(height, false); // Resize each col to match the number of rows.
+        // Delete the elements from the positions in the region.
+        for (int cellIndex : regionCells)
+        {
+            int col = cellIndex / height;
+            int row = cellIndex % height;
+            matrix.erase(col, row);          // Remove the block.
+            hash ^= zobristKey(cellIndex, blockType);
+            numBlocks -= 1;                  // Update the number of blocks left.
+            score += 1;                      // Add one to the current game score.
+
+            // Update the mostLeftCol and mostRightCol.
+            if (mostLeftCol > col)
+            {
+                mostLeftCol = col;
+            }
+            if (mostRightCol < col)
+            {
+                mostRightCol = col;
+            }
+        }
+        // The diff of the move is taken before the blocks fall, while the vanished columns are still in place.
+        history.record(matrix, regionCells, mostLeftCol, mostRightCol, blockType, startCol, startRow);
+        updateBlocksPositions(mostLeftCol, mostRightCol);
+        return true;
     }
+    return false;
+}
 
-    // The queue where we push the blocks positions to visit.
-    std::queue<std::pair<int, int>> blocksQueue;
-    blocksQueue.push(std::make_pair(startCol, startRow)); // Push the start position.
-    visited[startCol][startRow] = true;                   // Mark it as visited
+/** Help method for deleteSameColorNeighbors.
+ * Puts the packed indices of all blocks connected to (col, row) with the same type in regionCells.
+ * Boards that fit in a bitboard use the shift-and-mask flood fill.
+ * Bigger boards use a scalar fill that marks visited cells in the matrix itself. */
+void Grid::collectRegion(int col, int row)
+{
+    TRACE_SCOPE("flood fill");
+    regionCells.clear();
 
-    // Vector where we build our result.
-    std::vector<std::pair<int, int>> result;
-    result.push_back(std::make_pair(startCol, startRow)); // Push the start position.
+    if (BitBoardEngine::fits(width, height))
+    {
+        bitboard.load(matrix);
+        BitBoard region = bitboard.floodFill(matrix.index(col, row));
+        region.forEach([this](int cellIndex)
+                       { regionCells.push_back(cellIndex); });
+        return;
+    }
 
-    // Offsets used to compute the neighbors.
-    int dCol[] = {1, -1, 0, 0};
-    int dRow[] = {0, 0, 1, -1};
+    // Value that marks a visited cell during the scalar fill.
+    const uint8_t visitedCell = EMPTY_CELL - 1;
+    uint8_t startType = matrix.get(col, row);
 
-    // The actual BFS
-    while (!blocksQueue.empty())
+    // regionCells is used as the queue: cells before next are done, the others still need a visit.
+    regionCells.push_back(matrix.index(col, row));
+    matrix[matrix.index(col, row)] = visitedCell;
+    for (size_t next = 0; next < regionCells.size(); next++)
     {
-        // Pop the first element from the queue.
-        std::pair<int, int> curElement = blocksQueue.front();
-        blocksQueue.pop();
-
-        int curCol = curElement.first;
-        int curRow = curElement.second;
+        int curCol = regionCells[next] / height;
+        int curRow = regionCells[next] % height;
 
-        // Compute the neighbors of curElement.
+        // Offsets used to compute the neighbors.
+        int dCol[] = {1, -1, 0, 0};
+        int dRow[] = {0, 0, 1, -1};
         for (int i = 0; i < 4; i++)
         {
             int neighborCol = curCol + dCol[i];
             int neighborRow = curRow + dRow[i];
 
-            // Check if the neighbor is within boundaries.
+            // Check if the neighbor is within boundaries and has the start type.
             if (neighborRow >= 0 && neighborRow < height &&
-                neighborCol >= 0 && neighborCol < width)
+                neighborCol >= 0 && neighborCol < width &&
+                matrix.get(neighborCol, neighborRow) == startType)
             {
-                // Check if the neighbor is already visited.
-                if (!visited[neighborCol][neighborRow])
-                {
-                    // Mark the neighbor as visited.
-                    visited[neighborCol][neighborRow] = true;
-
-                    // Check if the neighbor block exists in our grid.
-                    if (matrix[neighborCol][neighborRow].has_value())
-                    {
-                        // Check if it matches the startColor.
-                        Block curBlock = matrix[neighborCol][neighborRow].value();
-                        int curBlockType = curBlock.getBlockType();
-
-                        // If the types match, then only we add the block position to the queue.
-                        if (startType == curBlockType)
-                        {
-                            // Add the neighbor to the queue.
-                            blocksQueue.push(std::make_pair(neighborCol, neighborRow));
-                            // Add current neighbor to the result.
-                            result.push_back(std::make_pair(neighborCol, neighborRow));
-                        }
-                    }
-                }
+                regionCells.push_back(matrix.index(neighborCol, neighborRow));
+                matrix.set(neighborCol, neighborRow, visitedCell);
             }
         }
     }
 
-    int mostLeftCol = width - 1;
-    int mostDownRow = 0;
-    if (result.size() >= 2)
+    // Put the block types back.
+    for (int cellIndex : regionCells)
     {
-        // Delete the elements from the positions in result.
-        for (int i = 0; i < result.size(); i++)
-        {
-            int col = result[i].first;
-            int row = result[i].second;
-            matrix[col][row] = std::nullopt; // Remove the block.
-            numBlocks -= 1;                  // Update the number of blocks left.
-            score += 1;                      // Add one to the current game score.
-
-            // Update the mostLeftCol and mostDownRow.
-            if (mostLeftCol > col)
-            {
-                mostLeftCol = col;
-            }
-            if (mostDownRow < row)
-            {
-                mostDownRow = row;
-            }
-        }
-        updateBlocksPositions(mostLeftCol, mostDownRow);
+        matrix[cellIndex] = startType;
     }
 }
 
-// Method that updates the blocks positions in the given rectangle range.
-void Grid::updateBlocksPositions(int mostLeftCol, int mostDownRow)
+/** Method that updates the blocks positions after the blocks in the columns
+ * [mostLeftCol, mostRightCol] were deleted. */
+void Grid::updateBlocksPositions(int mostLeftCol, int mostRightCol)
 {
-    // Make the blocks from each column "fall" down.
-    updateRows(mostLeftCol, mostDownRow);
-    // Put the empty columns to the back.
-    updateColumns(mostLeftCol, mostDownRow);
+    // Make the blocks fall down and put the empty columns to the back in one pass, the hash follows every moved block.
+    ColumnRange changed = matrix.collapse(mostLeftCol, mostRightCol, &hash);
+    components.update(matrix, changed);
 
     // Check for the end conditions.
     checkEndCondition();
 
-    // Redraw the matrix at the end.
-    drawGrid();
+    // The next frame redraws the changed part of the matrix.
+    markDirty(changed);
 }
 
-// Help method for updateBlocksPositions.
-void Grid::updateRows(int mostLeftCol, int mostDownRow)
+// Method to save the game in the compact save format, with a single commit.
+void Grid::saveGame()
 {
-    // Make the blocks from each column "fall" down.
-    if (mostDownRow > 0) // Do only if mostDownRow is not 0.
+    if (!encodeSave(matrix, numDifferentBlocks, score, saveBuffer) ||
+        SAVE_ADDRESS + (int)saveBuffer.size() > LOG_ADDRESS ||
+        SAVE_ADDRESS + saveBuffer.size() > hal.storage->size())
     {
-        for (int col = mostLeftCol; col < width; col++)
-        {
-            // Pointer that holds the new position of the next block in the column.
-            int newRow = mostDownRow;
-            // Pointer that goes through all elements from the column (starting at mostDownRow)
-            // If there is a block at the position in the column changes his place to newPosition pointer.
-            int curRow = mostDownRow;
+        return; // This board can not be saved, or its save would run into the move log.
+    }
 
-            while (curRow >= 0) // While curElement pointer has not reached the top of the column.
-            {
-                if (matrix[col][curRow].has_value()) // If there is a block at curElement.
-                {
-                    // Swap curRow with newRow if the pointers are not on the same element.
-                    if (newRow != curRow)
-                    {
-                        Block curBlock = matrix[col][curRow].value(); // Change the block's coordinates.
-                        std::swap(matrix[col][newRow], matrix[col][curRow]);
-                    }
-
-                    // Go to next row.
-                    newRow -= 1;
-                    curRow -= 1;
-                }
-                else // There is no block at current position.
-                {
-                    // Skip the empty position by updating only curRow pointer.
-                    curRow -= 1;
-                }
-            }
-        }
+    for (size_t i = 0; i < saveBuffer.size(); i++)
+    {
+        hal.storage->writeByte(SAVE_ADDRESS + i, saveBuffer[i]);
     }
+    hal.storage->requestCommit(); // Written to flash by the persistence task.
 }
 
-// Help method for updateBlockPositions
-void Grid::updateColumns(int mostLeftCol, int mostDownRow)
+// Method to load a saved game only if a valid one exists.
+void Grid::loadGame()
 {
-    /** Move the empty columns at the right side of the matrix.
-     * Only do this if the mostDownRow is the deepest row.
-     * If the passed mostDownRow is not the deepest,
-     * then we didn't get an empty column this time, so we skip this step.
-     * */
-    if (mostDownRow == (height - 1))
+    SavedGame saved;
+    if (!decodeSave(*hal.storage, SAVE_ADDRESS, saved))
     {
-        // Almost same algorithm as before just going through one row instead of a column.
-        int newColumn = mostLeftCol;
-        int curColumn = mostLeftCol;
+        return; // There is no save yet, or it is damaged.
+    }
+    setBoard(saved);
+}
 
-        while (curColumn <= width - 1) // While curColumn has not reached the last column in the row.
+// Method to continue a logged game: rebuild its board from the newest checkpoint or the seed, then replay the moves.
+bool Grid::replay(const LoggedGame &logged)
+{
+    if (logged.hasCheckpoint)
+    {
+        setBoard(logged.checkpoint);
+    }
+    else
+    {
+        *this = Grid(logged.width, logged.height, logged.numColors, logged.seed);
+    }
+    seed = logged.seed;
+
+    for (int cellIndex : logged.moves)
+    {
+        colCursor = cellIndex / height;
+        rowCursor = cellIndex % height;
+        if (!deleteSameColorNeighbors())
         {
-            // If current column is not empty.
-            if (matrix[curColumn][mostDownRow].has_value())
-            {
-                if (curColumn != newColumn)
-                {
-                    std::swap(matrix[curColumn], matrix[newColumn]);
-                }
-                // Go to next column.
-                curColumn += 1;
-                newColumn += 1;
-            }
-            else // Case where column is empty.
-            {
-                // Skip the column.
-                curColumn += 1;
-            }
+            return false; // Not a move of this board.
         }
     }
+    checkEndCondition(); // A checkpoint can be a finished game.
+    placeCursor(colCursor, rowCursor);
+    return true;
 }
 
-// Method to save a game.
-void Grid::saveGame()
+// Method to take back the last move. Only the columns it changed are redrawn.
+bool Grid::undo()
 {
-    int address = 0;
-
-    // Make the first byte 1 to indicate there is a save.
-    EEPROM.writeByte(address, (u_int8_t)1);
-    address++;
-
-    // First save current score.
-    EEPROM.writeInt(address, score);
-    address += sizeof(int);
-
-    // Then skip the best score variables in memory.
-    address++;              // Skip hasBestScore.
-    address += sizeof(int); // Skip best Score.
-
-    // Save the grid dimensions.
-    EEPROM.writeInt(address, width);
-    address += sizeof(int);
-    EEPROM.writeInt(address, height);
-    address += sizeof(int);
-
-    // Save the game matrix. Save the block types. 5 is equal to no-block.
-    for (int col = 0; col < width; col++)
+    if (!history.canUndo())
     {
-        for (int row = 0; row < height; row++)
+        return false;
+    }
+    MoveDiff diff = history.undo();
+    // Only the touched columns change, and the ones after them if the move had emptied a column: they are hashed again.
+    int lastChanged = diff.firstCol + diff.numCols - 1;
+    for (int col = diff.firstCol; col < diff.firstCol + diff.numCols; col++)
+    {
+        if (diff.isVanished(col))
         {
-            std::optional<Block> cell = matrix[col][row];
-            if (cell.has_value()) // If there is a block.
-            {
-                Block curBlock = cell.value();
-                int typeBlock = curBlock.getBlockType();
-                EEPROM.writeInt(address, typeBlock);
-                address += sizeof(int);
-            }
-            else // If there is no block.
-            {
-                int empty = 5;
-                EEPROM.writeInt(address, empty);
-                address += sizeof(int);
-            }
+            lastChanged = width - 1;
         }
     }
+    hash ^= matrix.hashColumns(diff.firstCol, lastChanged);
+    ColumnRange changed = undoMove(matrix, diff);
+    hash ^= matrix.hashColumns(diff.firstCol, lastChanged);
+    components.update(matrix, changed);
+    numBlocks += diff.numRemoved;
+    score -= diff.numRemoved;
+    gameEnded = 0; // There was a move before this one.
 
-    // Save the numBlocks left in the current game.
-    EEPROM.writeInt(address, numBlocks);
-    address += sizeof(int);
-
-    // Save the number of different blocks.
-    EEPROM.writeInt(address, numDifferentBlocks);
-    address += sizeof(int);
-
-    EEPROM.commit();
+    // Put the cursor back on the cell that was clicked.
+    placeCursor(diff.cursorCol, diff.cursorRow);
+    markDirty(changed);
+    return true;
 }
 
-// Method to load a saved game only if one exists.
-void Grid::loadGame()
+// Method to make the last move that was taken back again.
+bool Grid::redo()
 {
-    int address = 0;
-    // Check if there is any save.
-    if (EEPROM.readByte(address) == (uint8_t)0)
+    if (!history.canRedo())
     {
-        return; // There is no save yet.
+        return false;
+    }
+    MoveDiff diff = history.redo();
+    ColumnRange changed = redoMove(matrix, diff, &hash);
+    components.update(matrix, changed);
+    numBlocks -= diff.numRemoved;
+    score += diff.numRemoved;
+    placeCursor(diff.cursorCol, diff.cursorRow);
+    checkEndCondition();
+    markDirty(changed);
+    return true;
+}
+
+// Help method for loadGame and replay. Puts a saved board in the grid.
+void Grid::setBoard(const SavedGame &saved)
+{
+    history.clear(); // The moves before do not lead to this board.
+    width = saved.board.getWidth();
+    height = saved.board.getHeight();
+    numDifferentBlocks = saved.numColors;
+    score = saved.score;
+    matrix = saved.board;
+    hash = matrix.hash();
+    components.label(matrix);
+    prepareBoardBuffers();
+
+    // Count the blocks remaining.
+    numBlocks = 0;
+    for (int cellIndex = 0; cellIndex < matrix.getNumCells(); cellIndex++)
+    {
+        if (matrix[cellIndex] != EMPTY_CELL)
+        {
+            numBlocks++;
+        }
     }
 
-    // Load the score first and print it.
-    address++;
-    // Load the score in score of the grid class.
-    score = EEPROM.readInt(address);
-    address += sizeof(int);
+    // Keep the cursor on the loaded grid, and fit the view to it.
+    colCursor = std::min(colCursor, width - 1);
+    rowCursor = std::min(rowCursor, height - 1);
+    setupView();
 
-    // Load best score and print it.
-    address++;
-    bestScore = EEPROM.readInt(address);
-    address += sizeof(int);
-    M5.Lcd.setCursor(100, 2);
-    M5.Lcd.printf("Best: %d", bestScore);
+    gameEnded = 0;
 
-    // Load the grid dimensions.
-    width = EEPROM.readInt(address);
-    address += sizeof(int);
-    height = EEPROM.readInt(address);
-    address += sizeof(int);
+    // Redraw the game.
+    markDirty({0, width - 1});
+}
 
-    // Change the top space according to new loaded height.
-    topSpace = SCREEN_HEIGHT - (height * BLOCK_HEIGHT);
+int Grid::bestScore = 0;
+bool Grid::bestScoreLoaded = false;
 
-    // Load the game matrix. Load the block types. 5 is equal to no-block.
-    for (int col = 0; col < width; col++)
+// Check the header of the persistent storage and format it only if the header is missing or of an other version.
+bool prepareStorage(Storage &storage)
+{
+    if (storage.readInt(HEADER_ADDRESS) == (int32_t)STORAGE_MAGIC &&
+        storage.readByte(HEADER_ADDRESS + 4) == STORAGE_VERSION)
     {
-        for (int row = 0; row < height; row++)
-        {
-            std::uint8_t blockType = EEPROM.readByte(address);
-            address++;
-
-            if (blockType != 5) // If there is a block.
-            {
-                Block curBlock = matrix[col][row].value();
-                int typeBlockInt = static_cast<int>(blockType);
-                curBlock.setBlockType(typeBlockInt);
-            }
-            else // If there is no block.
-            {
-                matrix[col][row] = std::nullopt;
-            }
-        }
+        return false;
     }
 
-    // Change the top space according to new loaded height.
-    topSpace = SCREEN_HEIGHT - (height * BLOCK_HEIGHT);
-
-    // Load the number of blocks remaining.
-    numBlocks = EEPROM.readInt(address);
-    address += sizeof(int);
-
-    // Load the number of different blocks.
-    numDifferentBlocks = EEPROM.readInt(address);
-    address += sizeof(int);
+    // Only the bytes that mark the best score and the save as present have to be cleared.
+    storage.writeInt(HEADER_ADDRESS, STORAGE_MAGIC);
+    storage.writeByte(HEADER_ADDRESS + 4, STORAGE_VERSION);
+    storage.writeByte(SCORE_ADDRESS, 0);
+    storage.writeByte(SAVE_ADDRESS, 0);
+    storage.requestCommit();
+    Grid::bestScoreLoaded = false;
+    return true;
+}
 
-    // Redraw the game.
-    drawGrid();
+// The best score, loaded from storage the first time it is needed.
+int Grid::getBestScore()
+{
+    if (!bestScoreLoaded)
+    {
+        loadScore();
+    }
+    return bestScore;
 }
 
-// Method to load the best score that is stored in memory at the beginning of the game.
+// Method to load the best score that is stored in memory.
 void Grid::loadScore()
 {
-    int address = 0;
-
-    address++;              // Skip byte that tells if there is a save.
-    address += sizeof(int); // Skip int that holds score.
+    int address = SCORE_ADDRESS;
 
     // Check if there is a best score saved yet.
-    if (EEPROM.readByte(address) == (uint8_t)0) // There is no best score.
+    if (hal.storage->readByte(address) == (uint8_t)0) // There is no best score.
     {
         bestScore = 0;
     }
     else // There is a best score.
     {
         address++;
-        bestScore = EEPROM.readInt(address); // Load the best score so far.
+        bestScore = hal.storage->readInt(address); // Load the best score so far.
     }
+    bestScoreLoaded = true;
 }
 
 // Method to save the current score as the best score.
 void Grid::saveScore()
 {
-    int address = 0;
-    address += sizeof(int); // address of score.
+    int address = SCORE_ADDRESS;
 
     // Make the byte hasBestScore 1 to indicate there is a best score saved.
-    std::uint8_t hasBestScore = 1;
-    EEPROM.writeByte(address, hasBestScore);
+    uint8_t hasBestScore = 1;
+    hal.storage->writeByte(address, hasBestScore);
     address++;
     // Write the new best score.
-    EEPROM.writeInt(address, score);
+    hal.storage->writeInt(address, score);
+    hal.storage->requestCommit();
+    bestScore = score;
+    bestScoreLoaded = true;
 }
 
 // Method to check if any of the end conditions has been met.
@@ -629,63 +669,26 @@ void Grid::checkEndCondition()
     if (anyPossibilityLeft() == 0)
     {
         gameEnded = 1; // End the game if no possibility left.
-        M5.Lcd.fillScreen(black_color);
-        M5.Lcd.setCursor(30, 35, 4);
-        M5.Lcd.printf("You Lost");
-        M5.Lcd.setCursor(5, 2, 1); // Set the cursor back to normal size.
-        delay(5000);               // Wait 5 seconds before continuing execution.
+        endMessage = "You Lost";
     }
     if (numBlocks == 0)
     {
         gameEnded = 1;
-        M5.Lcd.fillScreen(black_color);
-        M5.Lcd.setCursor(30, 35, 4);
-        M5.Lcd.printf("You Won");
-        M5.Lcd.setCursor(5, 2, 1); // Set the cursor back to normal size.
-        delay(5000);               // Wait 5 seconds before continuing execution.
+        endMessage = "You Won";
     }
 }
 
-// Method to check for a pair of the same block type next to each other.
+// Method to check for a group of two or more blocks: a lookup in the labels of the groups.
 int Grid::anyPossibilityLeft()
 {
-    for (int col = 0; col < width; col++)
-    {
-        for (int row = 0; row < height; row++)
-        {
-            if (matrix[col][row].has_value())
-            {
-                Block curBlock = matrix[col][row].value();
-                int typeCurBlock = curBlock.getBlockType();
-
-                // Check if there is any neighbor of the type of curBlock.
-                // Offsets used to compute the neighbors.
-                int dCol[] = {1, -1, 0, 0};
-                int dRow[] = {0, 0, 1, -1};
-
-                for (int i = 0; i < 4; i++)
-                {
-                    int newCol = col + dCol[i];
-                    int newRow = row + dRow[i];
-
-                    // Check if neighbor is valid (within bounds).
-                    if (newRow >= 0 && newRow < height &&
-                        newCol >= 0 && newCol < width)
-                    {
-                        if (matrix[newCol][newRow].has_value())
-                        {
-                            Block neighborBlock = matrix[newCol][newRow].value();
-                            if (neighborBlock.getBlockType() == typeCurBlock)
-                            {
-                                return 1; // We found a pair no need to compute further.
-                            }
-                        }
-                    }
-                }
-            }
-        }
-    }
-    return 0; // If we arrive here we didn't find any pair left.
+    return components.hasMove() ? 1 : 0;
+}
+
+// Blocks the click at the cursor would remove, 0 if it is not a move.
+int Grid::getCursorGroupSize()
+{
+    int size = components.sizeAt(matrix.index(colCursor, rowCursor));
+    return size >= 2 ? size : 0;
 }
 
 // Method that checks if the current game has ended.
@@ -694,7 +697,7 @@ bool Grid::hasEnded()
     if (gameEnded == 1) // The game has ended.
     {
         // Check if the current score is the new best score and save it.
-        if (score > bestScore)
+        if (score > getBestScore())
         {
             saveScore();
         }
@@ -735,44 +738,14 @@ void Cursor::setY(int newY)
     y_coord = newY;
 }
 
-// Method to draw the cursor at current cursor location.
-void Cursor::drawCursor()
-{
-    M5.Lcd.drawRect(getX(), getY(), BLOCK_WIDTH, BLOCK_HEIGHT, white_color);
-}
-
-// Constructor of the Block class
-Block::Block()
-{
-    ;
-}
-
-// Accessors
-int Block::getBlockType()
-{
-    return blockType;
-}
-
-// Mutators
-
-void Block::setBlockType(int newBlockType)
-{
-    blockType = newBlockType;
-}
-
-// Method to draw a block
-void Block::drawBlock(int col, int row, int color, int topSpace)
-{
-    int x = col * BLOCK_WIDTH;
-    int y = (row * BLOCK_HEIGHT) + topSpace;
-    M5.Lcd.fillRect(x, y, width, height, color);
-}
+// Names of the menu options.
+static const char *const optionNames[] = {"return", "hint", "undo", "redo", "save", "load", "next level"};
 
 // Class menu constructor.
-Menu::Menu(int selectedOpt, int numOpts)
+Menu::Menu(int selectedOpt)
 {
     selectedOption = selectedOpt;
-    numOptions = numOpts;
+    numOptions = sizeof(optionNames) / sizeof(optionNames[0]);
 }
 
 // Method that selects the next option.
@@ -781,55 +754,17 @@ void Menu::goDownMenu()
     selectedOption = (selectedOption + 1) % numOptions;
 }
 
+// Method to draw the menu right away. Only the lines that changed are pushed to the screen.
 void Menu::drawMenu()
 {
-    // Fill the background screen in black.
-    M5.Lcd.fillScreen(black_color);
-
-    int firstOption = 15;
-    int secondOption = 30;
-    int thirdOption = 45;
-    int fourthOption = 60;
-
-    // Draw the arrow that shows which option is selected.
-    int arrowPosition = 0;
-    switch (selectedOption)
-    {
-    case 0:
-
-        arrowPosition = firstOption;
-        break;
-
-    case 1:
-
-        arrowPosition = secondOption;
-        break;
-
-    case 2:
-
-        arrowPosition = thirdOption;
-        break;
-
-    case 3:
-
-        arrowPosition = fourthOption;
-        break;
-    }
-
-    // Draw the selection arrow.
-    M5.Lcd.setCursor(40, arrowPosition);
-    M5.Lcd.printf(">");
-
-    // Draw all options.
-    M5.Lcd.setCursor(50, firstOption);
-    M5.Lcd.printf("return");
-
-    M5.Lcd.setCursor(50, secondOption);
-    M5.Lcd.printf("save");
-
-    M5.Lcd.setCursor(50, thirdOption);
-    M5.Lcd.printf("load");
+    renderer.drawMenu(optionNames, numOptions, selectedOption);
+}
 
-    M5.Lcd.setCursor(50, fourthOption);
-    M5.Lcd.printf("next level");
-}
\ No newline at end of file
+// Copy the menu into the frame.
+void Menu::fillSnapshot(FrameSnapshot &frame)
+{
+    frame.screen = SCREEN_MENU;
+    frame.optionNames = optionNames;
+    frame.numOptions = numOptions;
+    frame.selectedOption = selectedOption;
+}
@@ -0,0 +1,64 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "hal.h"
+
+Hal hal;
+
+// Format the text and print it at the text cursor.
+void Display::printf(const char *format, ...)
+{
+    char text[64];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    print(text);
+}
+
+// Read one sample right away.
+int Input::readAccelSamples(AccelSample *samples, int maxSamples)
+{
+    if (maxSamples < 1)
+    {
+        return 0;
+    }
+    samples[0].time = hal.clock->millis();
+    getAccelData(&samples[0].x, &samples[0].y, &samples[0].z);
+    return 1;
+}
+
+// Read a 4-byte little-endian int, like the ESP32 EEPROM library.
+int32_t Storage::readInt(int address)
+{
+    uint8_t bytes[4];
+    for (int i = 0; i < 4; i++)
+    {
+        bytes[i] = readByte(address + i);
+    }
+    int32_t value;
+    memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+// Write a 4-byte little-endian int, like the ESP32 EEPROM library.
+void Storage::writeInt(int address, int32_t value)
+{
+    uint8_t bytes[4];
+    memcpy(bytes, &value, sizeof(value));
+    for (int i = 0; i < 4; i++)
+    {
+        writeByte(address + i, bytes[i]);
+    }
+}
+
+// Commit if a commit was requested.
+bool Storage::commitIfPending()
+{
+    if (!commitPending)
+    {
+        return false;
+    }
+    commitPending = false;
+    return commit();
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** Hardware abstraction layer.
+ * The game only talks to the hardware through these interfaces, so the same core runs on
+ * the M5StickC (hal_m5stick.cpp) and headless on a workstation (hal_native.cpp). */
+
+// RGB565 colors used by the game (same values as the M5StickC ones).
+#define COLOR_BLACK 0x0000
+#define COLOR_WHITE 0xFFFF
+#define COLOR_RED 0xF800
+#define COLOR_GREEN 0x07E0
+#define COLOR_BLUE 0x001F
+#define COLOR_YELLOW 0xFFE0
+#define COLOR_PURPLE 0x780F
+
+// Display interface
+class Display
+{
+public:
+    virtual ~Display() {}
+
+    virtual void fillScreen(uint16_t color) = 0;
+    virtual void fillRect(int x, int y, int w, int h, uint16_t color) = 0;
+    virtual void drawRect(int x, int y, int w, int h, uint16_t color) = 0;
+
+    // Text is drawn in white at the text cursor. font 1 is the small font, 4 the big one.
+    virtual void setCursor(int x, int y, int font = 1) = 0;
+    virtual void print(const char *text) = 0;
+
+    // Format the text and print it at the text cursor.
+    void printf(const char *format, ...);
+
+    // End of a frame. Displays that draw off-screen push the frame to the panel here.
+    virtual void present() {}
+};
+
+// One reading of the accelerometer (in g) and the time it was taken (Clock::millis).
+struct AccelSample
+{
+    uint32_t time;
+    float x;
+    float y;
+    float z;
+};
+
+// Input interface: the two buttons and the accelerometer.
+class Input
+{
+public:
+    virtual ~Input() {}
+
+    // Read the current state of the buttons. Call once per poll.
+    virtual void update() = 0;
+    virtual bool wasPressedA() = 0;
+    virtual bool wasPressedB() = 0;
+    virtual void getAccelData(float *accX, float *accY, float *accZ) = 0;
+
+    /** Take the accelerometer samples gathered since the last call, oldest first.
+     * Returns the number of samples written, at most maxSamples. Call again while it returns maxSamples.
+     * By default this reads one sample right away. */
+    virtual int readAccelSamples(AccelSample *samples, int maxSamples);
+
+    // Check if there is still input coming. Always true on the device.
+    virtual bool isActive() { return true; }
+};
+
+// Persistent storage interface with the EEPROM layout (little-endian ints).
+class Storage
+{
+public:
+    virtual ~Storage() {}
+
+    virtual bool begin(size_t size) = 0;
+    virtual size_t size() = 0;
+    virtual uint8_t readByte(int address) = 0;
+    virtual void writeByte(int address, uint8_t value) = 0;
+    virtual bool commit() = 0;
+
+    int32_t readInt(int address);
+    void writeInt(int address, int32_t value);
+
+    // Ask for a commit later, so that the slow flash write does not block the caller.
+    void requestCommit() { commitPending = true; }
+    // Commit if a commit was requested. Returns true if it committed.
+    bool commitIfPending();
+
+private:
+    bool commitPending = false;
+};
+
+/** Raw NOR flash interface, used under the journaled storage.
+ * Erasing a sector sets all its bytes to 0xFF, and writing can only clear bits.
+ * Addresses are relative to the start of the flash area. */
+class Flash
+{
+public:
+    virtual ~Flash() {}
+
+    virtual uint32_t sectorSize() = 0;
+    virtual int numSectors() = 0;
+    virtual bool read(uint32_t address, uint8_t *data, uint32_t length) = 0;
+    virtual bool write(uint32_t address, const uint8_t *data, uint32_t length) = 0;
+    virtual bool eraseSector(int sector) = 0;
+};
+
+// Clock interface
+class Clock
+{
+public:
+    virtual ~Clock() {}
+
+    virtual uint32_t millis() = 0;
+    virtual uint32_t micros() = 0;
+    virtual void delay(uint32_t ms) = 0;
+};
+
+// Random number generator interface
+class Rng
+{
+public:
+    virtual ~Rng() {}
+
+    // Change the seed, so that the next grid is different.
+    virtual void randomize() = 0;
+    // Random number in [0, bound).
+    virtual int nextInt(int bound) = 0;
+};
+
+// The implementations used by the game. Filled in by setup() (or main() on the host).
+struct Hal
+{
+    Display *display = nullptr;
+    Input *input = nullptr;
+    Storage *storage = nullptr;
+    Clock *clock = nullptr;
+    Rng *rng = nullptr;
+};
+
+extern Hal hal;
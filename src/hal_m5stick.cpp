@@ -0,0 +1,207 @@
+#include <M5StickC.h>
+#include <cstdlib>
+#include <ctime>
+#include "classes.h"
+#include "hal_m5stick.h"
+
+// Display
+void M5Display::fillScreen(uint16_t color)
+{
+    M5.Lcd.fillScreen(color);
+}
+
+void M5Display::fillRect(int x, int y, int w, int h, uint16_t color)
+{
+    M5.Lcd.fillRect(x, y, w, h, color);
+}
+
+void M5Display::drawRect(int x, int y, int w, int h, uint16_t color)
+{
+    M5.Lcd.drawRect(x, y, w, h, color);
+}
+
+void M5Display::setCursor(int x, int y, int font)
+{
+    M5.Lcd.setCursor(x, y, font);
+}
+
+void M5Display::print(const char *text)
+{
+    M5.Lcd.print(text);
+}
+
+// Sprite display
+M5SpriteDisplay::M5SpriteDisplay(bool pushDirtyOnly)
+    : SpriteDisplay(SCREEN_WIDTH, SCREEN_HEIGHT, pushDirtyOnly), sprite(&M5.Lcd)
+{
+}
+
+void M5SpriteDisplay::begin()
+{
+    sprite.setColorDepth(16);
+    sprite.createSprite(getWidth(), getHeight());
+}
+
+void M5SpriteDisplay::composeFill(uint16_t color)
+{
+    sprite.fillSprite(color);
+}
+
+void M5SpriteDisplay::composeFillRect(int x, int y, int w, int h, uint16_t color)
+{
+    sprite.fillRect(x, y, w, h, color);
+}
+
+void M5SpriteDisplay::composeDrawRect(int x, int y, int w, int h, uint16_t color)
+{
+    sprite.drawRect(x, y, w, h, color);
+}
+
+void M5SpriteDisplay::composeText(int x, int y, int font, const char *text)
+{
+    sprite.setCursor(x, y, font);
+    sprite.print(text);
+}
+
+void M5SpriteDisplay::pushRegion(int x, int y, int w, int h)
+{
+    if (w == getWidth() && h == getHeight())
+    {
+        sprite.pushSprite(0, 0);
+        return;
+    }
+
+    // The sprite keeps its pixels in panel byte order, so they are streamed without swapping.
+    uint16_t *pixels = (uint16_t *)sprite.getPointer();
+    M5.Lcd.startWrite();
+    M5.Lcd.setWindow(x, y, x + w - 1, y + h - 1);
+    for (int row = y; row < y + h; row++)
+    {
+        M5.Lcd.pushColors(pixels + row * getWidth() + x, w, false);
+    }
+    M5.Lcd.endWrite();
+}
+
+// Input
+// Start sampling the IMU in the background.
+void M5Input::begin()
+{
+    esp_timer_create_args_t timerArgs = {};
+    timerArgs.callback = sampleTimer;
+    timerArgs.arg = this;
+    timerArgs.name = "imu";
+    esp_timer_create(&timerArgs, &timer);
+    esp_timer_start_periodic(timer, 1000000 / IMU_SAMPLE_HZ);
+}
+
+// Timer callback (esp_timer task): read one sample into the queue.
+void M5Input::sampleTimer(void *parameter)
+{
+    M5Input *input = (M5Input *)parameter;
+    AccelSample sample;
+    sample.time = millis();
+    M5.IMU.getAccelData(&sample.x, &sample.y, &sample.z);
+    if (!input->samples.tryPush(sample))
+    {
+        input->numLostSamples++;
+    }
+}
+
+void M5Input::update()
+{
+    M5.update();
+}
+
+bool M5Input::wasPressedA()
+{
+    return M5.BtnA.wasPressed();
+}
+
+bool M5Input::wasPressedB()
+{
+    return M5.BtnB.wasPressed();
+}
+
+void M5Input::getAccelData(float *accX, float *accY, float *accZ)
+{
+    M5.IMU.getAccelData(accX, accY, accZ);
+}
+
+// Take the samples the timer gathered since the last call.
+int M5Input::readAccelSamples(AccelSample *batch, int maxSamples)
+{
+    if (timer == nullptr)
+    {
+        return Input::readAccelSamples(batch, maxSamples);
+    }
+    int numSamples = 0;
+    while (numSamples < maxSamples && samples.tryPop(batch[numSamples]))
+    {
+#ifdef IMU_RECORD
+        const AccelSample &sample = batch[numSamples];
+        Serial.printf("imu %u %.3f %.3f %.3f\n", sample.time, sample.x, sample.y, sample.z);
+#endif
+        numSamples++;
+    }
+    return numSamples;
+}
+
+// Flash
+bool PartitionFlash::begin()
+{
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_SPIFFS, nullptr);
+    return partition != nullptr && partition->size >= JOURNAL_SECTORS * SPI_FLASH_SEC_SIZE;
+}
+
+uint32_t PartitionFlash::sectorSize()
+{
+    return SPI_FLASH_SEC_SIZE;
+}
+
+int PartitionFlash::numSectors()
+{
+    return partition != nullptr ? JOURNAL_SECTORS : 0;
+}
+
+bool PartitionFlash::read(uint32_t address, uint8_t *data, uint32_t length)
+{
+    return partition != nullptr && esp_partition_read(partition, address, data, length) == ESP_OK;
+}
+
+bool PartitionFlash::write(uint32_t address, const uint8_t *data, uint32_t length)
+{
+    return partition != nullptr && esp_partition_write(partition, address, data, length) == ESP_OK;
+}
+
+bool PartitionFlash::eraseSector(int sector)
+{
+    return partition != nullptr &&
+           esp_partition_erase_range(partition, sector * SPI_FLASH_SEC_SIZE, SPI_FLASH_SEC_SIZE) == ESP_OK;
+}
+
+// Clock
+uint32_t ArduinoClock::millis()
+{
+    return ::millis();
+}
+
+uint32_t ArduinoClock::micros()
+{
+    return ::micros();
+}
+
+void ArduinoClock::delay(uint32_t ms)
+{
+    ::delay(ms);
+}
+
+// Random number generator
+void ArduinoRng::randomize()
+{
+    std::srand(std::time(0));
+}
+
+int ArduinoRng::nextInt(int bound)
+{
+    return std::rand() % bound;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <M5StickC.h>
+#include <esp_timer.h>
+#include <esp_partition.h>
+#include "hal.h"
+#include "spsc_queue.h"
+#include "sprite_display.h"
+
+// Rate at which the IMU is sampled in the background, and how many samples can wait for the game.
+#define IMU_SAMPLE_HZ 100
+#define IMU_QUEUE_SIZE 32
+
+// Sectors of the data partition used by the journaled storage.
+#define JOURNAL_SECTORS 4
+
+// M5StickC implementations of the hardware interfaces. They wrap M5, the flash partition and the Arduino core.
+
+class M5Display : public Display
+{
+public:
+    void fillScreen(uint16_t color) override;
+    void fillRect(int x, int y, int w, int h, uint16_t color) override;
+    void drawRect(int x, int y, int w, int h, uint16_t color) override;
+    void setCursor(int x, int y, int font = 1) override;
+    void print(const char *text) override;
+};
+
+/** Off-screen frame in a TFT_eSprite, pushed to the LCD once per frame.
+ * The whole sprite goes out in one pushSprite, the dirty variant streams
+ * only the changed rows of the bounding box in one SPI transaction. */
+class M5SpriteDisplay : public SpriteDisplay
+{
+private:
+    TFT_eSprite sprite;
+
+protected:
+    void composeFill(uint16_t color) override;
+    void composeFillRect(int x, int y, int w, int h, uint16_t color) override;
+    void composeDrawRect(int x, int y, int w, int h, uint16_t color) override;
+    void composeText(int x, int y, int font, const char *text) override;
+    void pushRegion(int x, int y, int w, int h) override;
+
+public:
+    M5SpriteDisplay(bool pushDirtyOnly);
+
+    // Allocate the frame buffer. Call after M5.begin().
+    void begin();
+};
+
+/** Buttons and IMU of the M5StickC.
+ * After begin() a periodic timer reads the IMU at IMU_SAMPLE_HZ into a queue,
+ * and the game takes the samples in one batch per tick instead of doing a blocking read.
+ * With IMU_RECORD defined every sample is also printed on Serial as "imu <ms> <x> <y> <z>",
+ * a log the native build can replay (--imu). */
+class M5Input : public Input
+{
+private:
+    SpscQueue<AccelSample, IMU_QUEUE_SIZE> samples;
+    esp_timer_handle_t timer = nullptr;
+    std::atomic<uint32_t> numLostSamples{0}; // Samples dropped because the game did not take them in time.
+
+    static void sampleTimer(void *parameter);
+
+public:
+    // Start sampling the IMU in the background. Call after M5.IMU.Init().
+    void begin();
+
+    void update() override;
+    bool wasPressedA() override;
+    bool wasPressedB() override;
+    void getAccelData(float *accX, float *accY, float *accZ) override;
+    int readAccelSamples(AccelSample *samples, int maxSamples) override;
+
+    uint32_t getNumLostSamples() const { return numLostSamples.load(); }
+};
+
+// The first JOURNAL_SECTORS sectors of the spiffs data partition, written raw.
+class PartitionFlash : public Flash
+{
+private:
+    const esp_partition_t *partition = nullptr;
+
+public:
+    bool begin();
+    uint32_t sectorSize() override;
+    int numSectors() override;
+    bool read(uint32_t address, uint8_t *data, uint32_t length) override;
+    bool write(uint32_t address, const uint8_t *data, uint32_t length) override;
+    bool eraseSector(int sector) override;
+};
+
+class ArduinoClock : public Clock
+{
+public:
+    uint32_t millis() override;
+    uint32_t micros() override;
+    void delay(uint32_t ms) override;
+};
+
+class ArduinoRng : public Rng
+{
+public:
+    void randomize() override;
+    int nextInt(int bound) override;
+};
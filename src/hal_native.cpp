@@ -0,0 +1,451 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <thread>
+#include "hal_native.h"
+
+// Constructor of the FrameBufferDisplay class
+FrameBufferDisplay::FrameBufferDisplay(int w, int h)
+{
+    width = w;
+    height = h;
+    pixels.assign(width * height, COLOR_BLACK);
+}
+
+void FrameBufferDisplay::fillScreen(uint16_t color)
+{
+    std::fill(pixels.begin(), pixels.end(), color);
+    texts.clear();
+    numDrawCalls++;
+}
+
+void FrameBufferDisplay::fillRect(int x, int y, int w, int h, uint16_t color)
+{
+    // Clip the rectangle to the screen.
+    int x0 = std::max(x, 0);
+    int y0 = std::max(y, 0);
+    int x1 = std::min(x + w, width);
+    int y1 = std::min(y + h, height);
+    for (int py = y0; py < y1; py++)
+    {
+        std::fill(&pixels[py * width + x0], &pixels[py * width + x0] + std::max(x1 - x0, 0), color);
+    }
+
+    // Texts that start inside the rectangle are painted over.
+    texts.erase(std::remove_if(texts.begin(), texts.end(), [&](const TextDraw &text)
+                               { return text.x >= x && text.x < x + w && text.y >= y && text.y < y + h; }),
+                texts.end());
+    numDrawCalls++;
+}
+
+void FrameBufferDisplay::drawRect(int x, int y, int w, int h, uint16_t color)
+{
+    // Draw the four sides, counted as one call.
+    fillRect(x, y, w, 1, color);
+    fillRect(x, y + h - 1, w, 1, color);
+    fillRect(x, y, 1, h, color);
+    fillRect(x + w - 1, y, 1, h, color);
+    numDrawCalls -= 3;
+}
+
+void FrameBufferDisplay::setCursor(int x, int y, int font)
+{
+    cursorX = x;
+    cursorY = y;
+    cursorFont = font;
+}
+
+void FrameBufferDisplay::print(const char *text)
+{
+    texts.push_back({cursorX, cursorY, cursorFont, text});
+    numDrawCalls++;
+}
+
+// Copy the pixels and texts of a region of source in one transaction.
+void FrameBufferDisplay::copyRegion(const FrameBufferDisplay &source, int x, int y, int w, int h)
+{
+    for (int py = y; py < y + h; py++)
+    {
+        std::copy(&source.pixels[py * width + x], &source.pixels[py * width + x] + w, &pixels[py * width + x]);
+    }
+
+    // The texts of the region are replaced by the ones of the source.
+    auto inRegion = [&](const TextDraw &text)
+    { return text.x >= x && text.x < x + w && text.y >= y && text.y < y + h; };
+    texts.erase(std::remove_if(texts.begin(), texts.end(), inRegion), texts.end());
+    for (const TextDraw &text : source.texts)
+    {
+        if (inRegion(text))
+        {
+            texts.push_back(text);
+        }
+    }
+    numDrawCalls++;
+}
+
+// Write the framebuffer as a binary PPM image.
+bool FrameBufferDisplay::writePpm(const char *path) const
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+    file << "P6\n"
+         << width << " " << height << "\n255\n";
+    for (uint16_t pixel : pixels)
+    {
+        // Expand RGB565 to 8 bits per channel.
+        char rgb[3] = {(char)(((pixel >> 11) & 0x1F) << 3),
+                       (char)(((pixel >> 5) & 0x3F) << 2),
+                       (char)((pixel & 0x1F) << 3)};
+        file.write(rgb, 3);
+    }
+    return (bool)file;
+}
+
+// Constructor of the HostSpriteDisplay class
+HostSpriteDisplay::HostSpriteDisplay(FrameBufferDisplay &targetPanel, bool pushDirtyOnly)
+    : SpriteDisplay(targetPanel.getWidth(), targetPanel.getHeight(), pushDirtyOnly),
+      frame(targetPanel.getWidth(), targetPanel.getHeight()), panel(targetPanel)
+{
+}
+
+void HostSpriteDisplay::composeFill(uint16_t color)
+{
+    frame.fillScreen(color);
+}
+
+void HostSpriteDisplay::composeFillRect(int x, int y, int w, int h, uint16_t color)
+{
+    frame.fillRect(x, y, w, h, color);
+}
+
+void HostSpriteDisplay::composeDrawRect(int x, int y, int w, int h, uint16_t color)
+{
+    frame.drawRect(x, y, w, h, color);
+}
+
+void HostSpriteDisplay::composeText(int x, int y, int font, const char *text)
+{
+    frame.setCursor(x, y, font);
+    frame.print(text);
+}
+
+void HostSpriteDisplay::pushRegion(int x, int y, int w, int h)
+{
+    panel.copyRegion(frame, x, y, w, h);
+}
+
+// Constructor of the ScriptedInput class
+ScriptedInput::ScriptedInput(const std::string &newScript, uint32_t newStepMs)
+{
+    stepMs = newStepMs;
+    setScript(newScript);
+}
+
+void ScriptedInput::setScript(const std::string &newScript)
+{
+    script = newScript;
+    started = false;
+    position = 0;
+    lastPress = 0;
+    current = '.';
+    pressed = false;
+    replayed = 0;
+}
+
+void ScriptedInput::setRecording(const std::vector<AccelSample> &samples)
+{
+    recording = samples;
+    replayed = 0;
+}
+
+// Find the character of the script at the current time. The script starts at the first poll.
+void ScriptedInput::update()
+{
+    uint32_t now = hal.clock->millis();
+    if (!started)
+    {
+        started = true;
+        startTime = now;
+    }
+    position = (now - startTime) / stepMs;
+    current = position < script.size() ? script[position] : '.';
+
+    // A press is reported at one poll only, however many polls the step lasts.
+    pressed = false;
+    if ((current == 'A' || current == 'B') && position + 1 > lastPress)
+    {
+        pressed = true;
+        lastPress = position + 1;
+    }
+}
+
+bool ScriptedInput::wasPressedA()
+{
+    return pressed && current == 'A';
+}
+
+bool ScriptedInput::wasPressedB()
+{
+    return pressed && current == 'B';
+}
+
+/** The IMU is mounted rotated on the device,
+ * so x is the tilt down and y the tilt to the right. */
+void ScriptedInput::getAccelData(float *accX, float *accY, float *accZ)
+{
+    *accX = 0;
+    *accY = 0;
+    *accZ = 1;
+    switch (current)
+    {
+    case 'D':
+        *accX = SCRIPT_TILT;
+        break;
+    case 'U':
+        *accX = -SCRIPT_TILT;
+        break;
+    case 'R':
+        *accY = SCRIPT_TILT;
+        break;
+    case 'L':
+        *accY = -SCRIPT_TILT;
+        break;
+    }
+}
+
+// Hand out the recorded samples that are due, on the clock of the game. Without a recording, read the script.
+int ScriptedInput::readAccelSamples(AccelSample *samples, int maxSamples)
+{
+    if (recording.empty())
+    {
+        return Input::readAccelSamples(samples, maxSamples);
+    }
+    uint32_t elapsed = hal.clock->millis() - startTime;
+    int numSamples = 0;
+    while (numSamples < maxSamples && replayed < recording.size() &&
+           recording[replayed].time - recording[0].time <= elapsed)
+    {
+        samples[numSamples] = recording[replayed];
+        samples[numSamples].time = startTime + (recording[replayed].time - recording[0].time);
+        numSamples++;
+        replayed++;
+    }
+    return numSamples;
+}
+
+bool ScriptedInput::isActive()
+{
+    return position < script.size() || replayed < recording.size();
+}
+
+// Read an accelerometer recording.
+bool loadAccelRecording(const std::string &path, std::vector<AccelSample> &samples)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        return false;
+    }
+    samples.clear();
+    std::string line;
+    while (std::getline(file, line))
+    {
+        AccelSample sample;
+        unsigned time;
+        if (sscanf(line.c_str(), " imu %u %f %f %f", &time, &sample.x, &sample.y, &sample.z) == 4)
+        {
+            sample.time = time;
+            samples.push_back(sample);
+        }
+    }
+    return true;
+}
+
+// Constructor of the FileFlash class. An existing file is loaded, otherwise the flash starts erased.
+FileFlash::FileFlash(const std::string &filePath, int numSectors, uint32_t sectorSize)
+{
+    path = filePath;
+    bytesPerSector = sectorSize;
+    bytes.assign(numSectors * sectorSize, 0xFF);
+    eraseCounts.assign(numSectors, 0);
+    std::ifstream file(path, std::ios::binary);
+    if (!path.empty() && file)
+    {
+        file.read(reinterpret_cast<char *>(bytes.data()), bytes.size());
+    }
+}
+
+// Write the whole flash to the file.
+bool FileFlash::save()
+{
+    if (path.empty())
+    {
+        return true;
+    }
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+    return (bool)file;
+}
+
+uint32_t FileFlash::sectorSize()
+{
+    return bytesPerSector;
+}
+
+int FileFlash::numSectors()
+{
+    return eraseCounts.size();
+}
+
+bool FileFlash::read(uint32_t address, uint8_t *data, uint32_t length)
+{
+    if (powerOff || address + length > bytes.size())
+    {
+        return false;
+    }
+    std::copy(bytes.begin() + address, bytes.begin() + address + length, data);
+    return true;
+}
+
+// Write by clearing bits. A power cut during the write leaves only its first bytes written.
+bool FileFlash::write(uint32_t address, const uint8_t *data, uint32_t length)
+{
+    if (powerOff || address + length > bytes.size())
+    {
+        return false;
+    }
+    uint32_t written = length;
+    if (powerBudget >= 0 && (long)length > powerBudget)
+    {
+        written = powerBudget;
+        powerOff = true;
+    }
+    for (uint32_t i = 0; i < written; i++)
+    {
+        bytes[address + i] &= data[i];
+    }
+    if (powerBudget >= 0)
+    {
+        powerBudget -= written;
+    }
+    save();
+    return !powerOff;
+}
+
+// Erase a sector. A power cut during the erase leaves only its first half erased.
+bool FileFlash::eraseSector(int sector)
+{
+    if (powerOff || sector < 0 || sector >= numSectors())
+    {
+        return false;
+    }
+    uint32_t erased = bytesPerSector;
+    if (powerBudget == 0)
+    {
+        erased = bytesPerSector / 2;
+        powerOff = true;
+    }
+    else if (powerBudget > 0)
+    {
+        powerBudget--;
+    }
+    std::fill(bytes.begin() + sector * bytesPerSector, bytes.begin() + sector * bytesPerSector + erased, 0xFF);
+    eraseCounts[sector]++;
+    save();
+    return !powerOff;
+}
+
+void FileFlash::cutPowerAfter(long numBytes)
+{
+    powerBudget = numBytes;
+}
+
+void FileFlash::restorePower()
+{
+    powerBudget = -1;
+    powerOff = false;
+}
+
+// Memory storage
+bool MemoryStorage::begin(size_t size)
+{
+    memory.assign(size, 0);
+    return true;
+}
+
+size_t MemoryStorage::size()
+{
+    return memory.size();
+}
+
+uint8_t MemoryStorage::readByte(int address)
+{
+    return memory[address];
+}
+
+void MemoryStorage::writeByte(int address, uint8_t value)
+{
+    memory[address] = value;
+}
+
+bool MemoryStorage::commit()
+{
+    numCommits++;
+    return true;
+}
+
+// Clock
+uint32_t VirtualClock::millis()
+{
+    return (uint32_t)(nowMicros / 1000);
+}
+
+uint32_t VirtualClock::micros()
+{
+    return (uint32_t)nowMicros;
+}
+
+void VirtualClock::delay(uint32_t ms)
+{
+    nowMicros += (uint64_t)ms * 1000;
+}
+
+uint32_t SystemClock::millis()
+{
+    return micros() / 1000;
+}
+
+uint32_t SystemClock::micros()
+{
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void SystemClock::delay(uint32_t ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+// Constructor of the SeededRng class
+SeededRng::SeededRng(uint32_t startSeed)
+{
+    seed = startSeed;
+}
+
+// Every new grid takes the next seed.
+void SeededRng::randomize()
+{
+    std::srand(seed);
+    seed++;
+}
+
+int SeededRng::nextInt(int bound)
+{
+    return std::rand() % bound;
+}
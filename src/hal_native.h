@@ -0,0 +1,205 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "hal.h"
+#include "sprite_display.h"
+
+// Headless implementations of the hardware interfaces, used by the native build.
+
+// Display that draws in an in-memory RGB565 framebuffer of the size of the LCD.
+class FrameBufferDisplay : public Display
+{
+public:
+    // A piece of text printed on the screen.
+    struct TextDraw
+    {
+        int x;
+        int y;
+        int font;
+        std::string text;
+    };
+
+private:
+    int width;
+    int height;
+    std::vector<uint16_t> pixels;
+    std::vector<TextDraw> texts; // Texts currently on the screen.
+    int cursorX = 0;
+    int cursorY = 0;
+    int cursorFont = 1;
+    uint32_t numDrawCalls = 0; // Number of calls that would be a panel transaction.
+
+public:
+    FrameBufferDisplay(int w = 160, int h = 80);
+
+    void fillScreen(uint16_t color) override;
+    void fillRect(int x, int y, int w, int h, uint16_t color) override;
+    void drawRect(int x, int y, int w, int h, uint16_t color) override;
+    void setCursor(int x, int y, int font = 1) override;
+    void print(const char *text) override;
+
+    // Accessors
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    uint16_t getPixel(int x, int y) const { return pixels[y * width + x]; }
+    const std::vector<uint16_t> &getPixels() const { return pixels; }
+    const std::vector<TextDraw> &getTexts() const { return texts; }
+    uint32_t getNumDrawCalls() const { return numDrawCalls; }
+
+    // Copy the pixels and texts of a region of source in one transaction.
+    void copyRegion(const FrameBufferDisplay &source, int x, int y, int w, int h);
+
+    // Write the framebuffer as a binary PPM image (texts are not rendered).
+    bool writePpm(const char *path) const;
+};
+
+// Sprite display that composes in a FrameBufferDisplay and pushes the frame to another one (the panel).
+class HostSpriteDisplay : public SpriteDisplay
+{
+private:
+    FrameBufferDisplay frame;
+    FrameBufferDisplay &panel;
+
+protected:
+    void composeFill(uint16_t color) override;
+    void composeFillRect(int x, int y, int w, int h, uint16_t color) override;
+    void composeDrawRect(int x, int y, int w, int h, uint16_t color) override;
+    void composeText(int x, int y, int font, const char *text) override;
+    void pushRegion(int x, int y, int w, int h) override;
+
+public:
+    HostSpriteDisplay(FrameBufferDisplay &targetPanel, bool pushDirtyOnly);
+};
+
+// Time one character of a script lasts (in ms of hal.clock).
+#define SCRIPT_STEP_MS 250
+// Tilt (in g) of the tilt characters of a script: a gentle tilt, one cursor step per character.
+#define SCRIPT_TILT 0.35
+
+/** Input that plays a script, one character per step of stepMs on hal.clock:
+ * 'L', 'R', 'U', 'D' tilt the device during the step, 'A' and 'B' press a button once,
+ * any other character is an idle step.
+ * Instead of the tilt characters a recorded accelerometer stream can be replayed (see loadAccelRecording),
+ * with the timing it was recorded with. The input stops being active at the end of the script and the stream. */
+class ScriptedInput : public Input
+{
+private:
+    std::string script;
+    std::vector<AccelSample> recording;
+    size_t replayed = 0; // Number of recorded samples handed out.
+    uint32_t stepMs;
+    uint32_t startTime = 0;
+    bool started = false;
+    size_t position = 0;  // Index of the current character.
+    size_t lastPress = 0; // One past the index of the last character that reported a press.
+    char current = '.';
+    bool pressed = false; // The current character is a press that was not reported yet.
+
+public:
+    ScriptedInput(const std::string &newScript = "", uint32_t newStepMs = SCRIPT_STEP_MS);
+
+    void setScript(const std::string &newScript);
+    // Replay the samples (times relative to the first one) from the start of the script on.
+    void setRecording(const std::vector<AccelSample> &samples);
+
+    void update() override;
+    bool wasPressedA() override;
+    bool wasPressedB() override;
+    void getAccelData(float *accX, float *accY, float *accZ) override;
+    int readAccelSamples(AccelSample *samples, int maxSamples) override;
+    bool isActive() override;
+};
+
+/** Read an accelerometer recording: the lines "imu <ms> <x> <y> <z>" that M5Input prints with IMU_RECORD.
+ * Other lines are skipped, so a whole serial log can be used. Returns false if the file can not be read. */
+bool loadAccelRecording(const std::string &path, std::vector<AccelSample> &samples);
+
+// Size of the simulated flash.
+#define FLASH_SECTOR_SIZE 4096
+#define FLASH_SECTORS 4
+
+/** NOR flash simulator backed by a file, for the journaled storage.
+ * Erasing sets a sector to 0xFF and writing can only clear bits, like the real flash.
+ * The power can be cut after a number of written bytes to test crash recovery:
+ * the write in progress is torn (an erase in progress leaves half the sector erased),
+ * and every operation fails until the power is restored. With an empty path the flash only lives in RAM. */
+class FileFlash : public Flash
+{
+private:
+    std::string path;
+    uint32_t bytesPerSector;
+    std::vector<uint8_t> bytes;
+    std::vector<int> eraseCounts;
+    long powerBudget = -1; // Bytes that can still be written before the power goes off, -1 for no cut.
+    bool powerOff = false;
+
+    bool save();
+
+public:
+    FileFlash(const std::string &filePath, int numSectors = FLASH_SECTORS, uint32_t sectorSize = FLASH_SECTOR_SIZE);
+
+    uint32_t sectorSize() override;
+    int numSectors() override;
+    bool read(uint32_t address, uint8_t *data, uint32_t length) override;
+    bool write(uint32_t address, const uint8_t *data, uint32_t length) override;
+    bool eraseSector(int sector) override;
+
+    // Cut the power after numBytes more bytes were written (an erase counts as one byte).
+    void cutPowerAfter(long numBytes);
+    void restorePower();
+    bool isPowerOff() const { return powerOff; }
+
+    int getEraseCount(int sector) const { return eraseCounts[sector]; }
+};
+
+// EEPROM emulation in RAM only. Counts the commits.
+class MemoryStorage : public Storage
+{
+private:
+    std::vector<uint8_t> memory;
+    int numCommits = 0;
+
+public:
+    bool begin(size_t size) override;
+    size_t size() override;
+    uint8_t readByte(int address) override;
+    void writeByte(int address, uint8_t value) override;
+    bool commit() override;
+
+    int getNumCommits() const { return numCommits; }
+};
+
+// Clock that only moves forward when delay() is called, so headless runs take no real time.
+class VirtualClock : public Clock
+{
+private:
+    uint64_t nowMicros = 0;
+
+public:
+    uint32_t millis() override;
+    uint32_t micros() override;
+    void delay(uint32_t ms) override;
+};
+
+// Clock with the real time of the host, for tools that measure time budgets.
+class SystemClock : public Clock
+{
+public:
+    uint32_t millis() override;
+    uint32_t micros() override;
+    void delay(uint32_t ms) override;
+};
+
+// Random number generator with a fixed start seed, so headless runs are reproducible.
+class SeededRng : public Rng
+{
+private:
+    uint32_t seed;
+
+public:
+    SeededRng(uint32_t startSeed = 1);
+
+    void randomize() override;
+    int nextInt(int bound) override;
+};
@@ -0,0 +1,275 @@
+#include <string.h>
+#include <algorithm>
+#include "journal.h"
+#include "save_format.h"
+
+// Little-endian helpers for the headers on flash.
+static void putWord(uint8_t *bytes, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        bytes[i] = (value >> (8 * i)) & 0xFF;
+    }
+}
+
+static uint32_t getWord(const uint8_t *bytes)
+{
+    return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+// Size of a record with length bytes of data.
+static uint32_t recordSize(uint32_t length)
+{
+    return 16 + ((length + 3) & ~3u) + 4;
+}
+
+// Constructor of the JournalStorage class
+JournalStorage::JournalStorage(Flash &targetFlash) : flash(targetFlash)
+{
+}
+
+// Find the newest record and load it, or start an empty journal.
+bool JournalStorage::begin(size_t size)
+{
+    memory.assign(size, 0);
+    recordBuffer.reserve(recordSize(size));
+    dirtyFirst = 0;
+    dirtyLast = -1;
+    if (size > MAX_SIZE || flash.numSectors() < 2 || recordSize(size) + SECTOR_HEADER_SIZE > flash.sectorSize())
+    {
+        return false;
+    }
+
+    // Only the sector headers are read to find the newest and the one before it.
+    int newest = -1;
+    int previous = -1;
+    uint32_t newestSequence = 0;
+    uint32_t previousSequence = 0;
+    for (int sector = 0; sector < flash.numSectors(); sector++)
+    {
+        uint8_t header[SECTOR_HEADER_SIZE];
+        if (!flash.read(sector * flash.sectorSize(), header, SECTOR_HEADER_SIZE) ||
+            getWord(header) != JOURNAL_SECTOR_MAGIC)
+        {
+            continue;
+        }
+        uint32_t sequence = getWord(header + 4);
+        if (newest < 0 || sequence > newestSequence)
+        {
+            previous = newest;
+            previousSequence = newestSequence;
+            newest = sector;
+            newestSequence = sequence;
+        }
+        else if (previous < 0 || sequence > previousSequence)
+        {
+            previous = sector;
+            previousSequence = sequence;
+        }
+    }
+
+    if (newest < 0)
+    {
+        return startSector(0, 1); // Blank flash.
+    }
+
+    currentSector = newest;
+    sectorSequence = newestSequence;
+    uint32_t endOffset;
+    if (scanSector(newest, endOffset))
+    {
+        appendOffset = endOffset;
+        needFullRecord = false;
+        return true;
+    }
+
+    /** The power went off right after the newest sector was started, before its first record was complete.
+     * The newest good record is in the sector before it, and the newest sector is started over. */
+    if (previous >= 0)
+    {
+        uint32_t previousEnd;
+        scanSector(previous, previousEnd);
+    }
+    return startSector(newest, newestSequence);
+}
+
+/** Walk the records of a sector and apply the good ones to memory, oldest first.
+ * endOffset is where the next record can go. Returns true if the sector holds a good record.
+ * A record torn by a power cut is skipped: the records after it were made from the bytes without it. */
+bool JournalStorage::scanSector(int sector, uint32_t &endOffset)
+{
+    uint32_t base = sector * flash.sectorSize();
+    uint32_t offset = SECTOR_HEADER_SIZE;
+    bool found = false;
+
+    while (offset + RECORD_HEADER_SIZE <= flash.sectorSize())
+    {
+        uint8_t header[RECORD_HEADER_SIZE];
+        if (!flash.read(base + offset, header, RECORD_HEADER_SIZE))
+        {
+            break;
+        }
+        uint32_t magic = getWord(header);
+        if (magic == 0xFFFFFFFF)
+        {
+            endOffset = offset; // Erased: the end of the records.
+            return found;
+        }
+        uint32_t sequence = getWord(header + 4);
+        uint32_t extent = getWord(header + 8);
+        uint32_t length = extent & 0xFFFF;
+        uint32_t dataOffset = (extent >> 16) & 0x7FFF;
+        if (magic != JOURNAL_RECORD_MAGIC || dataOffset + length > memory.size() ||
+            offset + recordSize(length) > flash.sectorSize())
+        {
+            break; // A torn header. Nothing after it can be trusted.
+        }
+
+        // Check the data and the commit mark.
+        uint32_t padded = (length + 3) & ~3u;
+        recordBuffer.resize(8 + padded + 4);
+        putWord(&recordBuffer[0], sequence);
+        putWord(&recordBuffer[4], extent);
+        if (flash.read(base + offset + RECORD_HEADER_SIZE, &recordBuffer[8], padded + 4) &&
+            getWord(&recordBuffer[8 + padded]) == JOURNAL_COMMIT_MARK &&
+            crc32(recordBuffer.data(), 8 + length) == getWord(header + 12))
+        {
+            found = true;
+            recordSequence = sequence;
+            if ((extent & EXTENT_CHANGE) == 0)
+            {
+                memset(memory.data(), 0, memory.size()); // All the bytes, without the trailing zeros.
+            }
+            memcpy(memory.data() + dataOffset, &recordBuffer[8], length);
+        }
+        offset += recordSize(length);
+    }
+
+    endOffset = flash.sectorSize(); // Nothing more fits in this sector.
+    return found;
+}
+
+// Erase a sector and make it the current one.
+bool JournalStorage::startSector(int sector, uint32_t sequence)
+{
+    currentSector = sector;
+    sectorSequence = sequence;
+    appendOffset = SECTOR_HEADER_SIZE;
+    needFullRecord = true;
+
+    numErases++;
+    if (!flash.eraseSector(sector))
+    {
+        return false;
+    }
+    // The sequence number before the magic, so a sector with a magic always has its whole header.
+    uint8_t header[SECTOR_HEADER_SIZE];
+    putWord(header, JOURNAL_SECTOR_MAGIC);
+    putWord(header + 4, sequence);
+    uint32_t address = sector * flash.sectorSize();
+    return flash.write(address + 4, header + 4, 4) && flash.write(address, header, 4);
+}
+
+size_t JournalStorage::size()
+{
+    return memory.size();
+}
+
+uint8_t JournalStorage::readByte(int address)
+{
+    return memory[address];
+}
+
+void JournalStorage::writeByte(int address, uint8_t value)
+{
+    if (memory[address] == value)
+    {
+        return;
+    }
+    memory[address] = value;
+    if (dirtyFirst > dirtyLast)
+    {
+        dirtyFirst = address;
+        dirtyLast = address;
+    }
+    else
+    {
+        dirtyFirst = std::min(dirtyFirst, address);
+        dirtyLast = std::max(dirtyLast, address);
+    }
+}
+
+// Write one record with the given extent of memory.
+bool JournalStorage::appendRecord(uint32_t offset, uint32_t length, bool change)
+{
+    uint32_t extent = length | (offset << 16) | (change ? EXTENT_CHANGE : 0);
+    uint32_t sequence = recordSequence + 1;
+    uint32_t padded = (length + 3) & ~3u;
+    recordBuffer.assign(RECORD_HEADER_SIZE + padded, 0);
+    putWord(&recordBuffer[0], JOURNAL_RECORD_MAGIC);
+    putWord(&recordBuffer[4], sequence);
+    putWord(&recordBuffer[8], extent);
+    memcpy(&recordBuffer[RECORD_HEADER_SIZE], memory.data() + offset, length);
+    putWord(&recordBuffer[12], crc32(memory.data() + offset, length, crc32(&recordBuffer[4], 8)));
+
+    // The data first, the commit mark last.
+    uint32_t address = currentSector * flash.sectorSize() + appendOffset;
+    appendOffset += recordSize(length); // Taken even if the write fails: those bytes can not be written again before an erase.
+    uint8_t mark[4];
+    putWord(mark, JOURNAL_COMMIT_MARK);
+    if (!flash.write(address, recordBuffer.data(), RECORD_HEADER_SIZE + padded) ||
+        !flash.write(address + RECORD_HEADER_SIZE + padded, mark, 4))
+    {
+        return false;
+    }
+    recordSequence = sequence;
+    return true;
+}
+
+// Append a record with the bytes changed since the last commit.
+bool JournalStorage::commit()
+{
+    if (currentSector < 0)
+    {
+        return false;
+    }
+    if (!needFullRecord && dirtyFirst > dirtyLast)
+    {
+        return true; // Nothing changed.
+    }
+
+    // A change record when it fits in the current sector.
+    if (!needFullRecord && appendOffset + recordSize(dirtyLast - dirtyFirst + 1) <= flash.sectorSize())
+    {
+        if (!appendRecord(dirtyFirst, dirtyLast - dirtyFirst + 1, true))
+        {
+            return false; // The changes stay pending for the next commit.
+        }
+        dirtyFirst = 0;
+        dirtyLast = -1;
+        return true;
+    }
+
+    // Otherwise all the bytes, trailing zeros left out, they are restored on load.
+    uint32_t length = memory.size();
+    while (length > 0 && memory[length - 1] == 0)
+    {
+        length--;
+    }
+
+    // Move on to the next sector of the ring when the record does not fit anymore.
+    // The current sector holds the newest good record, so the one after it can be erased.
+    if (appendOffset + recordSize(length) > flash.sectorSize() &&
+        !startSector((currentSector + 1) % flash.numSectors(), sectorSequence + 1))
+    {
+        return false;
+    }
+    if (!appendRecord(0, length, false))
+    {
+        return false;
+    }
+    needFullRecord = false;
+    dirtyFirst = 0;
+    dirtyLast = -1;
+    return true;
+}
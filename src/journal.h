@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "hal.h"
+
+// Markers of the journal on flash.
+#define JOURNAL_SECTOR_MAGIC 0x4A534753 // "SGSJ": start of a journal sector.
+#define JOURNAL_RECORD_MAGIC 0x4A524543 // "CERJ": start of a record.
+#define JOURNAL_COMMIT_MARK 0x54494D43  // "CMIT": written after a record is complete.
+
+/** Wear-leveled, power-fail-safe storage on raw flash.
+ * The bytes live in RAM. Every commit appends a record to a ring of sectors,
+ * instead of erasing and rewriting the same sector every time.
+ * The first record of a sector holds all the bytes (trailing zeros left out), the next ones only
+ * the range of bytes that changed since the previous commit, so a small change is a small append.
+ *
+ *   sector   magic, sequence number of the sector (grows by one for every sector started), records
+ *   record   magic, sequence number, extent, CRC-32 of sequence/extent/data, data (padded to 4 bytes), commit mark
+ *   extent   bits 0-15 length, bits 16-30 offset of the data, bit 31 set for a change (clear for all the bytes)
+ *
+ * The commit mark is written last, so a record torn by a power cut is never taken for a good one.
+ * A sector is only erased when the ring moves on to it, and never while it holds the newest good record,
+ * so the previous save survives a power cut at any moment.
+ * On boot only the sector headers are read to find the newest sector, then only that sector
+ * (or the one before it, if the newest has no good record yet) is scanned. */
+class JournalStorage : public Storage
+{
+private:
+    Flash &flash;
+    std::vector<uint8_t> memory;
+    std::vector<uint8_t> recordBuffer; // Record being written (reserved for the whole memory).
+
+    int currentSector = -1;       // Sector records are appended to.
+    uint32_t sectorSequence = 0;  // Sequence number of the current sector.
+    uint32_t appendOffset = 0;    // Offset of the next record in the current sector.
+    uint32_t recordSequence = 0;  // Sequence number of the last record.
+    bool needFullRecord = true;   // The current sector has no record with all the bytes yet.
+    int dirtyFirst = 0;           // Range of bytes changed since the last commit, empty when first > last.
+    int dirtyLast = -1;
+    int numErases = 0;
+
+    static const uint32_t SECTOR_HEADER_SIZE = 8;
+    static const uint32_t RECORD_HEADER_SIZE = 16;
+    static const uint32_t EXTENT_CHANGE = 0x80000000;
+    static const size_t MAX_SIZE = 0x7FFF; // Largest offset an extent can hold.
+
+    bool startSector(int sector, uint32_t sequence);
+    bool scanSector(int sector, uint32_t &endOffset);
+    bool appendRecord(uint32_t offset, uint32_t length, bool change);
+
+public:
+    JournalStorage(Flash &targetFlash);
+
+    // Find the newest record and load it, or start an empty journal. size is the number of bytes stored.
+    bool begin(size_t size) override;
+    size_t size() override;
+    uint8_t readByte(int address) override;
+    void writeByte(int address, uint8_t value) override;
+    // Append a record with the bytes changed since the last commit. Nothing is written if none changed.
+    bool commit() override;
+
+    int getNumErases() const { return numErases; }
+    uint32_t getRecordSequence() const { return recordSequence; }
+};
@@ -1,108 +1,212 @@
 #include <M5StickC.h>
 #undef min
 #include <stdlib.h>
+#include <string.h>
 #include <stdint.h>
-#include "EEPROM.h"
 #include "classes.h"
+#include "hal_m5stick.h"
+#include "journal.h"
+#include "pipeline.h"
+#include "rollout.h"
+#include "scheduler.h"
 
-#define MEM_SIZE 1024
+#ifndef RENDER_CORE
+#define RENDER_CORE -1
+#endif
+
+// Speed of the Serial link (monitor_speed in platformio.ini must match).
+#define SERIAL_BAUD 921600
+
+#ifdef TRACE
+// Size of the Serial transmit buffer (in bytes): 128 trace lines, more than 40 ms of the link.
+#define TRACE_TX_BUFFER 4096
+#endif
 
 // Function declarations.
-void newGame();
-void clearMemory();
+void inputTask(uint32_t now);
+void updateTask(uint32_t now);
+void publishTask(uint32_t now);
+void persistTask(uint32_t now);
+void renderTask(uint32_t now);
+#if RENDER_CORE >= 0
+void renderLoop(void *parameter);
+void analysisLoop(void *parameter);
+#endif
+
+// The M5StickC implementations of the hardware interfaces.
+#if RENDER_MODE == RENDER_DIRECT
+M5Display m5Display;
+#else
+M5SpriteDisplay m5Display(RENDER_MODE == RENDER_SPRITE_DIRTY);
+#endif
+M5Input m5Input;
+PartitionFlash partitionFlash;
+JournalStorage journalStorage(partitionFlash);
+MirrorStorage mirrorStorage(journalStorage, pipeline); // The game only touches the flash through the pipeline.
+ArduinoClock arduinoClock;
+ArduinoRng arduinoRng;
+
+Game *game = nullptr;
+Scheduler scheduler;
+uint32_t setupMicros = 0;   // Time spent in setup().
+bool bootReported = false; // The time to the first frame was printed (only touched by the render side).
+#if RENDER_CORE >= 0
+RolloutEngine levelAnalysis(1); // Rollouts of the new levels, on the render core when it has nothing to draw.
+#endif
 
 void setup()
 {
-  M5.begin();
+  uint32_t setupStart = micros();
+  // Serial is started here rather than by M5.begin(), so its buffer and speed can be set first.
+#ifdef TRACE
+  Serial.setTxBufferSize(TRACE_TX_BUFFER);
+#endif
+  Serial.begin(SERIAL_BAUD);
+  M5.begin(true, true, false);
   M5.IMU.Init();
-  EEPROM.begin(MEM_SIZE);
-  clearMemory();
-  Serial.begin(155200);
-  Serial.flush();
+#if RENDER_MODE != RENDER_DIRECT
+  m5Display.begin();
+#endif
+  hal.display = &m5Display;
+  hal.input = &m5Input;
+  hal.storage = &mirrorStorage;
+  hal.clock = &arduinoClock;
+  hal.rng = &arduinoRng;
+  m5Input.begin(); // Sample the IMU in the background from now on.
+  partitionFlash.begin();
+  // The saved game and best score are kept. Only a storage without a valid header is formatted.
+  hal.storage->begin(MEM_SIZE);
+  if (prepareStorage(*hal.storage))
+  {
+    Serial.println("storage: formatted");
+  }
   M5.Lcd.fillScreen(BLACK); // set the default background color
   // Change the screen orientation to horizontal.
   M5.Lcd.setRotation(1);
+
+  // The game draws its first grid, so it is made once the screen is set up.
+  game = new Game();
+  scheduler.addTask("input", FRAME_MS, inputTask);
+  scheduler.addTask("update", FRAME_MS, updateTask);
+  scheduler.addTask("publish", FRAME_MS, publishTask);
+  scheduler.addTask("persist", PERSIST_MS, persistTask);
+
+  // Draw the frames and write the saves on the other core, or in this loop if RENDER_CORE is -1.
+#if RENDER_CORE >= 0
+  xTaskCreatePinnedToCore(renderLoop, "render", 8192, nullptr, 1, nullptr, RENDER_CORE);
+  // Below the render task, so the analysis only gets the time the render core would spend idle.
+  xTaskCreatePinnedToCore(analysisLoop, "analysis", 4096, nullptr, 0, nullptr, RENDER_CORE);
+#else
+  scheduler.addTask("render", FRAME_MS, renderTask);
+#endif
+  setupMicros = micros() - setupStart;
 }
 
 void loop()
 {
-  newGame();
-  M5.update();
-  delay(100);
+  // Run the tasks that are due and sleep until the next tick.
+  scheduler.loopOnce();
+}
+
+// The scheduler tasks.
+void inputTask(uint32_t now)
+{
+  game->sampleInput(now);
+}
+
+void updateTask(uint32_t now)
+{
+  game->update(now);
+}
+
+void publishTask(uint32_t now)
+{
+  game->publish(now);
 }
 
-// Function that contains the loop for an entire game.
-void newGame()
+void persistTask(uint32_t now)
 {
-  // Begin with clean black screen.
-  M5.Lcd.fillScreen(BLACK);
+  game->persist(now);
+}
 
-  // Make a new grid object
-  Grid newGrid;
+// The render/persistence side of the pipeline. Only this side touches the LCD and the flash.
+void renderTask(uint32_t now)
+{
+  (void)now;
+  pipeline.consume(journalStorage);
 
-  while (!newGrid.hasEnded())
+  // Report how long the cold boot took, once the first frame is on the LCD.
+  if (!bootReported && pipeline.getNumDrawnFrames() > 0)
   {
-    delay(250); // slow the cursor down.
-    M5.update();
-    newGrid.moveCursor(); // Check for cursor move and update it accordingly.
+    bootReported = true;
+    Serial.printf("boot: first frame %lu ms after power-on, setup took %lu ms\n",
+                  (unsigned long)millis(), (unsigned long)(setupMicros / 1000));
+  }
 
-    // Enter the menu screen.
-    if (M5.BtnB.wasPressed())
-    {
-      // Make a new menu.
-      Menu newMenu;
-      newMenu.drawMenu();
+#ifdef TRACE
+  // Dump the trace events every tick, as far as the Serial buffer has room: the render side never waits for the UART.
+  tracer.drain([](const char *line)
+               {
+                 if (Serial.availableForWrite() <= (int)strlen(line) + 2)
+                 {
+                   return false;
+                 }
+                 Serial.println(line);
+                 return true; });
+#endif
+}
 
-      int loop = true;
-      while (loop) // Infinite loop that displays the menu. Break out of it by selecting an option.
-      {
-        delay(100);
-        M5.update();
-        newMenu.drawMenu();
-        if (M5.BtnB.wasPressed()) // Scroll down the menu.
-        {
-          newMenu.goDownMenu();
-        }
-        else if (M5.BtnA.wasPressed()) // Select an option.
-        {
-          int option = newMenu.selectedOption;
-          switch (option)
-          {
-          case 0:         // option 1: return (do nothing)
-            loop = false; // Break out of the loop.
-            break;
-          case 1: // option 2: we save the game.
-            loop = false;
-            newGrid.saveGame();
-            break;
-          case 2: // option 3: we load a previously saved game.
-            loop = false;
-            newGrid.loadGame();
-            break;
-          case 3: // option 4: begin a new game.
-            loop = false;
-            newGrid.setGameEnded(1); // Trigger end condition of the current game.
-            break;
-          }
-        }
-      }
-      newGrid.drawGrid(); // Draw the grid when exiting the menu.
-    }
-    // Update the game.
-    else if (M5.BtnA.wasPressed())
-    {
-      newGrid.deleteSameColorNeighbors();
-    }
+#if RENDER_CORE >= 0
+// Task pinned to RENDER_CORE. Polls the pipeline every tick, so a frame is drawn as soon as it is published.
+void renderLoop(void *parameter)
+{
+  (void)parameter;
+  for (;;)
+  {
+    renderTask(millis());
+    vTaskDelay(1);
   }
 }
 
-void clearMemory()
+/** Low priority task next to the render task. Runs a small rollout budget on every new level
+ * and prints what the random games scored on Serial, to judge the level seeds. */
+void analysisLoop(void *parameter)
 {
-  int address = 0;
-  for (int i = 0; i < MEM_SIZE; i++)
+  (void)parameter;
+  for (;;)
   {
-    u_int8_t emptyValue = 0;
-    EEPROM.writeByte(address, emptyValue);
-    address++;
+    LevelInfo level;
+    if (!pipeline.popLevel(level))
+    {
+      vTaskDelay(10);
+      continue;
+    }
+    PackedBoard board(level.width, level.height);
+    generateBoard(board, level.numBlockTypes, level.seed);
+    uint32_t startTime = millis();
+    if (!levelAnalysis.start(board, ROLLOUT_DEVICE_BUDGET, 0, level.seed))
+    {
+      continue;
+    }
+    levelAnalysis.work(0);
+    RolloutResult result = levelAnalysis.getResult();
+
+    const RolloutMoveStats *bestMove = &result.moves[0];
+    int64_t totalScore = 0;
+    uint32_t numCleared = 0;
+    for (const RolloutMoveStats &move : result.moves)
+    {
+      totalScore += move.totalScore;
+      numCleared += move.numCleared;
+      if (move.meanScore() > bestMove->meanScore())
+      {
+        bestMove = &move;
+      }
+    }
+    Serial.printf("level %08lx: %lu rollouts in %lu ms, mean %.1f, best %ld, cleared %lu, best first move (%d, %d)\n",
+                  (unsigned long)level.seed, (unsigned long)result.numRollouts, (unsigned long)(millis() - startTime),
+                  (double)totalScore / result.numRollouts, (long)result.bestScore, (unsigned long)numCleared,
+                  bestMove->cellIndex / level.height, bestMove->cellIndex % level.height);
   }
-}
\ No newline at end of file
+}
+#endif
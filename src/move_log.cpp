@@ -0,0 +1,193 @@
+#include <algorithm>
+#include "move_log.h"
+
+// Append a varint (7 bits per byte, low bits first).
+static void putVarint(std::vector<uint8_t> &bytes, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        bytes.push_back((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    bytes.push_back(value);
+}
+
+// Read a varint of at most 3 bytes before end. Returns false if it runs past end or is longer.
+static bool readVarint(Storage &storage, int &address, int end, uint32_t &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 21; shift += 7)
+    {
+        if (address >= end)
+        {
+            return false;
+        }
+        uint8_t byte = storage.readByte(address);
+        address++;
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Constructor of the MoveLog class. The log uses the storage from newStartAddress up to newEndAddress.
+MoveLog::MoveLog(int newStartAddress, int newEndAddress)
+{
+    startAddress = newStartAddress;
+    endAddress = newEndAddress;
+    usedEnd = newEndAddress; // Unknown until a log is read: everything is cleared on the first start.
+}
+
+// Start the log of a new game, replacing the previous one.
+bool MoveLog::start(Storage &storage, int width, int height, int numColors, uint32_t seed)
+{
+    writeAddress = -1;
+    numMovesSinceCheckpoint = 0;
+    if (width < 1 || width > 255 || height < 1 || height > 255 ||
+        endAddress > (int)storage.size() || startAddress + MOVE_LOG_HEADER_SIZE >= endAddress)
+    {
+        return false;
+    }
+
+    storage.writeByte(startAddress, MOVE_LOG_VERSION);
+    storage.writeByte(startAddress + 1, width);
+    storage.writeByte(startAddress + 2, height);
+    storage.writeByte(startAddress + 3, numColors);
+    storage.writeInt(startAddress + 4, seed);
+    writeAddress = startAddress + MOVE_LOG_HEADER_SIZE;
+    storage.writeByte(writeAddress, MOVE_LOG_END);
+
+    // Clear what is left of the previous log, so the storage stays mostly zeros.
+    for (int address = writeAddress + 1; address < usedEnd; address++)
+    {
+        storage.writeByte(address, MOVE_LOG_END);
+    }
+    usedEnd = writeAddress + 1;
+    return true;
+}
+
+// Mark the log as invalid, so nothing is resumed from it.
+void MoveLog::clear(Storage &storage)
+{
+    if (startAddress < (int)storage.size())
+    {
+        storage.writeByte(startAddress, 0);
+    }
+    writeAddress = -1;
+}
+
+// Write the entry in entryBuffer and a new end code after it.
+bool MoveLog::appendEntry(Storage &storage)
+{
+    if (writeAddress < 0 || writeAddress + (int)entryBuffer.size() + 1 > endAddress)
+    {
+        return false;
+    }
+    for (uint8_t byte : entryBuffer)
+    {
+        storage.writeByte(writeAddress, byte);
+        writeAddress++;
+    }
+    storage.writeByte(writeAddress, MOVE_LOG_END);
+    usedEnd = std::max(usedEnd, writeAddress + 1);
+    return true;
+}
+
+// Append an accepted move: one byte for the first 126 cells, two bytes up to 16382 cells.
+bool MoveLog::appendMove(Storage &storage, int cellIndex)
+{
+    entryBuffer.clear();
+    putVarint(entryBuffer, MOVE_LOG_FIRST_MOVE + cellIndex);
+    if (!appendEntry(storage))
+    {
+        return false;
+    }
+    numMovesSinceCheckpoint++;
+    return true;
+}
+
+// Append a checkpoint of the board.
+bool MoveLog::appendCheckpoint(Storage &storage, const PackedBoard &board, int numColors, int32_t score)
+{
+    if (!encodeSave(board, numColors, score, saveBuffer))
+    {
+        return false;
+    }
+    entryBuffer.clear();
+    putVarint(entryBuffer, MOVE_LOG_CHECKPOINT);
+    putVarint(entryBuffer, saveBuffer.size());
+    entryBuffer.insert(entryBuffer.end(), saveBuffer.begin(), saveBuffer.end());
+    if (!appendEntry(storage))
+    {
+        return false;
+    }
+    numMovesSinceCheckpoint = 0;
+    return true;
+}
+
+// Read the log back. Only the moves after the newest checkpoint are kept.
+bool MoveLog::read(Storage &storage, LoggedGame &game)
+{
+    writeAddress = -1;
+    if (endAddress > (int)storage.size() || startAddress + MOVE_LOG_HEADER_SIZE >= endAddress ||
+        storage.readByte(startAddress) != MOVE_LOG_VERSION)
+    {
+        return false;
+    }
+    game.width = storage.readByte(startAddress + 1);
+    game.height = storage.readByte(startAddress + 2);
+    game.numColors = storage.readByte(startAddress + 3);
+    game.seed = storage.readInt(startAddress + 4);
+    game.hasCheckpoint = false;
+    game.moves.clear();
+    if (game.width < 1 || game.height < 1 || game.numColors < 1 || game.numColors > SAVE_MAX_COLORS)
+    {
+        return false;
+    }
+
+    int address = startAddress + MOVE_LOG_HEADER_SIZE;
+    int numMoves = 0;
+    for (;;)
+    {
+        int entryAddress = address;
+        uint32_t code;
+        if (!readVarint(storage, address, endAddress, code))
+        {
+            return false;
+        }
+        if (code == MOVE_LOG_END)
+        {
+            writeAddress = entryAddress;
+            break;
+        }
+        if (code == MOVE_LOG_CHECKPOINT)
+        {
+            uint32_t length;
+            if (!readVarint(storage, address, endAddress, length) || address + (int)length > endAddress ||
+                !decodeSave(storage, address, game.checkpoint) ||
+                game.checkpoint.board.getWidth() != game.width || game.checkpoint.board.getHeight() != game.height)
+            {
+                return false;
+            }
+            address += length;
+            game.hasCheckpoint = true;
+            game.moves.clear();
+            numMoves = 0;
+            continue;
+        }
+        int cellIndex = code - MOVE_LOG_FIRST_MOVE;
+        if (cellIndex >= game.width * game.height)
+        {
+            return false;
+        }
+        game.moves.push_back(cellIndex);
+        numMoves++;
+    }
+
+    numMovesSinceCheckpoint = numMoves;
+    usedEnd = writeAddress + 1;
+    return true;
+}
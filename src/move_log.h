@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "hal.h"
+#include "board.h"
+#include "save_format.h"
+
+/** Autosave of the game being played, as the seed of its board followed by the moves.
+ * A board is fully determined by its seed and the cells that were clicked, so every accepted move
+ * only appends one or two bytes. A checkpoint (a save, see save_format.h) every MOVE_LOG_CHECKPOINT_MOVES
+ * moves caps the number of moves that have to be replayed on load.
+ *
+ *   version      1 byte   MOVE_LOG_VERSION
+ *   width        1 byte
+ *   height       1 byte
+ *   numColors    1 byte
+ *   seed         4 bytes  little-endian
+ *   entries      varints  MOVE_LOG_END, MOVE_LOG_CHECKPOINT followed by the length and the bytes of a save,
+ *                         or MOVE_LOG_FIRST_MOVE + the packed index of the clicked cell */
+
+#define MOVE_LOG_VERSION 2 // 2: boards come from Xoshiro128 (generator.h), the logs of version 1 no longer replay.
+#define MOVE_LOG_CHECKPOINT_MOVES 16
+#define MOVE_LOG_HEADER_SIZE 8
+
+// Entry codes.
+#define MOVE_LOG_END 0
+#define MOVE_LOG_CHECKPOINT 1
+#define MOVE_LOG_FIRST_MOVE 2
+
+// A logged game as it is read back.
+struct LoggedGame
+{
+    int width = 0;
+    int height = 0;
+    int numColors = 0;
+    uint32_t seed = 0;
+    bool hasCheckpoint = false;
+    SavedGame checkpoint;   // Newest checkpoint, if any.
+    std::vector<int> moves; // Packed cell indices of the moves after the newest checkpoint (or after the start).
+};
+
+class MoveLog
+{
+private:
+    int startAddress;
+    int endAddress;               // First address after the log.
+    int writeAddress = -1;        // Address of the end code, -1 when no log is open.
+    int usedEnd;                  // First address after everything written so far, cleared when a log starts.
+    int numMovesSinceCheckpoint = 0;
+    std::vector<uint8_t> entryBuffer; // Entry being appended.
+    std::vector<uint8_t> saveBuffer;  // Encoded checkpoint.
+
+    // Write the entry in entryBuffer and a new end code after it. Returns false if it does not fit.
+    bool appendEntry(Storage &storage);
+
+public:
+    MoveLog(int newStartAddress, int newEndAddress);
+
+    // Start the log of a new game, replacing the previous one.
+    bool start(Storage &storage, int width, int height, int numColors, uint32_t seed);
+    // Mark the log as invalid, so nothing is resumed from it.
+    void clear(Storage &storage);
+
+    // Append an accepted move. Returns false if the log is full or not open.
+    bool appendMove(Storage &storage, int cellIndex);
+    // Append a checkpoint of the board. Returns false if it does not fit or the board can not be saved.
+    bool appendCheckpoint(Storage &storage, const PackedBoard &board, int numColors, int32_t score);
+    bool needsCheckpoint() const { return numMovesSinceCheckpoint >= MOVE_LOG_CHECKPOINT_MOVES; }
+
+    /** Read the log back. Returns false if there is no valid log.
+     * A valid log stays open, so the moves that follow are appended to it. */
+    bool read(Storage &storage, LoggedGame &game);
+};
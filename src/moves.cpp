@@ -0,0 +1,73 @@
+#include <algorithm>
+#include "moves.h"
+
+// Set up the buffers for boards of the given dimensions.
+void MoveGenerator::setDimensions(int width, int height)
+{
+    useBitboard = BitBoardEngine::fits(width, height);
+    if (useBitboard)
+    {
+        bitboard.setDimensions(width, height);
+    }
+    visited.reserve(width * height);
+    queue.reserve(width * height);
+}
+
+// Remove the region at cellIndex and let the board collapse.
+int MoveGenerator::play(PackedBoard &board, int cellIndex, uint64_t *hash)
+{
+    int height = board.getHeight();
+    int firstCol = cellIndex / height;
+    int lastCol = firstCol;
+
+    if (useBitboard)
+    {
+        bitboard.load(board);
+        BitBoard region = bitboard.floodFill(cellIndex);
+        uint8_t blockType = board[cellIndex];
+        region.forEach([&](int cell)
+                       { board[cell] = EMPTY_CELL; });
+        if (hash)
+        {
+            region.forEach([&](int cell)
+                           { *hash ^= zobristKey(cell, blockType); });
+        }
+        firstCol = region.lowest() / height;
+        lastCol = region.highest() / height;
+        board.collapse(firstCol, lastCol, hash);
+        return region.count();
+    }
+
+    uint8_t blockType = board[cellIndex];
+    int numCells = board.getNumCells();
+    queue.clear();
+    queue.push_back(cellIndex);
+    board[cellIndex] = EMPTY_CELL;
+    for (size_t next = 0; next < queue.size(); next++)
+    {
+        int cell = queue[next];
+        int col = cell / height;
+        int row = cell % height;
+        firstCol = std::min(firstCol, col);
+        lastCol = std::max(lastCol, col);
+        int neighbors[4] = {row > 0 ? cell - 1 : -1, row < height - 1 ? cell + 1 : -1,
+                            col > 0 ? cell - height : -1, cell + height < numCells ? cell + height : -1};
+        for (int neighbor : neighbors)
+        {
+            if (neighbor >= 0 && board[neighbor] == blockType)
+            {
+                board[neighbor] = EMPTY_CELL;
+                queue.push_back(neighbor);
+            }
+        }
+    }
+    if (hash)
+    {
+        for (int cell : queue)
+        {
+            *hash ^= zobristKey(cell, blockType);
+        }
+    }
+    board.collapse(firstCol, lastCol, hash);
+    return (int)queue.size();
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "board.h"
+#include "bitboard.h"
+
+// Bonus of the standard SameGame scoring for a cleared board.
+#define CLEAR_BONUS 1000
+
+/** Move generation and play on a PackedBoard, for the searches that run without a Grid.
+ * A move removes a region the same way deleteSameColorNeighbors and updateBlocksPositions do:
+ * the bitboard flood fill when the board fits in one, a scalar fill otherwise, then collapse.
+ * The buffers are reused, so no move allocates once the board size stays the same.
+ * One generator must only be used by one thread. */
+class MoveGenerator
+{
+private:
+    BitBoardEngine bitboard;
+    bool useBitboard = false;
+    std::vector<uint8_t> visited;
+    std::vector<int> queue;
+
+public:
+    // Set up the buffers for boards of the given dimensions.
+    void setDimensions(int width, int height);
+
+    // Call callback(cellIndex, blockType, size) for every region of at least two blocks, cellIndex is its lowest cell.
+    template <typename Callback>
+    void forEachMove(const PackedBoard &board, Callback callback);
+
+    /** Remove the region at cellIndex and let the board collapse. Returns the number of removed blocks.
+     * If hash is given, the Zobrist hash of the board is updated for the removed and the moved blocks. */
+    int play(PackedBoard &board, int cellIndex, uint64_t *hash = nullptr);
+};
+
+template <typename Callback>
+void MoveGenerator::forEachMove(const PackedBoard &board, Callback callback)
+{
+    if (useBitboard)
+    {
+        bitboard.load(board);
+        bitboard.forEachRegion([&](const BitBoard &region, int blockType)
+                               { callback(region.lowest(), blockType, region.count()); },
+                               2);
+        return;
+    }
+
+    // Bigger boards: label the regions with a breadth-first fill.
+    int height = board.getHeight();
+    int numCells = board.getNumCells();
+    visited.assign(numCells, 0);
+    for (int start = 0; start < numCells; start++)
+    {
+        uint8_t blockType = board[start];
+        if (blockType == EMPTY_CELL || visited[start])
+        {
+            continue;
+        }
+        queue.clear();
+        queue.push_back(start);
+        visited[start] = 1;
+        for (size_t next = 0; next < queue.size(); next++)
+        {
+            int cellIndex = queue[next];
+            int col = cellIndex / height;
+            int row = cellIndex % height;
+            int neighbors[4] = {row > 0 ? cellIndex - 1 : -1, row < height - 1 ? cellIndex + 1 : -1,
+                                col > 0 ? cellIndex - height : -1, cellIndex + height < numCells ? cellIndex + height : -1};
+            for (int neighbor : neighbors)
+            {
+                if (neighbor >= 0 && !visited[neighbor] && board[neighbor] == blockType)
+                {
+                    visited[neighbor] = 1;
+                    queue.push_back(neighbor);
+                }
+            }
+        }
+        if (queue.size() >= 2)
+        {
+            callback(start, blockType, (int)queue.size());
+        }
+    }
+}
+
+/** A PackedBoard and the generator that plays on it, with the interface of the fixed-size Board of fixed_board.h,
+ * for the searches written for both. */
+struct GeneratorBoard
+{
+    MoveGenerator &moves;
+    PackedBoard &board;
+
+    template <typename Callback>
+    void forEachMove(Callback callback) { moves.forEachMove(board, callback); }
+    int play(int cellIndex) { return moves.play(board, cellIndex); }
+    // A settled board is empty when its first column is.
+    bool isCleared() const { return board.isColumnEmpty(0); }
+};
+
+// Score of a move of size blocks in the standard SameGame scoring.
+inline int32_t moveScore(int size)
+{
+    return (int32_t)(size - 2) * (size - 2);
+}
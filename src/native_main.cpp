@@ -0,0 +1,166 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include "classes.h"
+#include "hal_native.h"
+#include "journal.h"
+#include "pipeline.h"
+#include "scheduler.h"
+#include "trace.h"
+
+static Game *game = nullptr;
+static Storage *flashStorage = nullptr;
+
+/** Headless entry point of the native build.
+ * Plays a scripted game on an in-memory screen, with the journaled storage on a flash simulated in a file.
+ * Usage: program [--seed N] [--flash FILE] [--script KEYS | --script-file FILE] [--imu FILE] [--ppm FILE]
+ *                [--trace FILE] (only built with -DTRACE: the trace dump, as the device writes it to Serial) */
+int main(int argc, char **argv)
+{
+    uint32_t seed = 1;
+    std::string flashPath = "flash.bin";
+    std::string script;
+    const char *ppmPath = nullptr;
+    FILE *traceFile = nullptr;
+    std::vector<AccelSample> recording;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--seed") == 0)
+        {
+            seed = strtoul(argv[i + 1], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "--flash") == 0)
+        {
+            flashPath = argv[i + 1];
+        }
+        else if (strcmp(argv[i], "--script") == 0)
+        {
+            script = argv[i + 1];
+        }
+        else if (strcmp(argv[i], "--script-file") == 0)
+        {
+            std::ifstream file(argv[i + 1]);
+            std::stringstream contents;
+            contents << file.rdbuf();
+            script = contents.str();
+        }
+        else if (strcmp(argv[i], "--imu") == 0)
+        {
+            if (!loadAccelRecording(argv[i + 1], recording))
+            {
+                fprintf(stderr, "could not read %s\n", argv[i + 1]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--ppm") == 0)
+        {
+            ppmPath = argv[i + 1];
+        }
+#ifdef TRACE
+        else if (strcmp(argv[i], "--trace") == 0)
+        {
+            traceFile = fopen(argv[i + 1], "w");
+            if (traceFile == nullptr)
+            {
+                fprintf(stderr, "could not write %s\n", argv[i + 1]);
+                return 1;
+            }
+        }
+#endif
+        else
+        {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    // The panel. With a sprite render mode the game draws off-screen and presents to it.
+    FrameBufferDisplay display(SCREEN_WIDTH, SCREEN_HEIGHT);
+#if RENDER_MODE == RENDER_DIRECT
+    Display &gameDisplay = display;
+#else
+    HostSpriteDisplay gameDisplay(display, RENDER_MODE == RENDER_SPRITE_DIRTY);
+#endif
+    ScriptedInput input(script);
+    input.setRecording(recording);
+    FileFlash fileFlash(flashPath);
+    JournalStorage flash(fileFlash);
+    MirrorStorage storage(flash, pipeline);
+    VirtualClock clock;
+    SeededRng rng(seed);
+
+    hal.display = &gameDisplay;
+    hal.input = &input;
+    hal.storage = &storage;
+    flashStorage = &flash;
+    hal.clock = &clock;
+    hal.rng = &rng;
+    hal.storage->begin(MEM_SIZE);
+    if (prepareStorage(*hal.storage))
+    {
+        printf("storage: formatted\n");
+    }
+
+    // The same tasks as on the device.
+    game = new Game();
+    Scheduler scheduler;
+    scheduler.addTask("input", FRAME_MS, [](uint32_t now)
+                      { game->sampleInput(now); });
+    scheduler.addTask("update", FRAME_MS, [](uint32_t now)
+                      { game->update(now); });
+    scheduler.addTask("publish", FRAME_MS, [](uint32_t now)
+                      { game->publish(now); });
+    scheduler.addTask("persist", PERSIST_MS, [](uint32_t now)
+                      { game->persist(now); });
+    // The render/persistence side runs in the same loop here, so runs are reproducible.
+    scheduler.addTask("render", FRAME_MS, [](uint32_t now)
+                      { (void)now; pipeline.consume(*flashStorage); });
+
+    // Write the new trace events to the trace file, if there is one.
+    auto dumpTrace = [traceFile]
+    {
+#ifdef TRACE
+        if (traceFile != nullptr)
+        {
+            tracer.drain([traceFile](const char *line)
+                         { return fprintf(traceFile, "%s\n", line) > 0; });
+        }
+#endif
+    };
+
+    // Play games until the script runs out.
+    do
+    {
+        scheduler.loopOnce();
+        dumpTrace();
+    } while (input.isActive());
+    // Push the last frame and save.
+    game->publish(clock.millis());
+    game->persist(clock.millis());
+    pipeline.consume(flash);
+    dumpTrace();
+    if (traceFile != nullptr)
+    {
+        fclose(traceFile);
+    }
+
+    // Report what is on the screen at the end.
+    for (const FrameBufferDisplay::TextDraw &text : display.getTexts())
+    {
+        printf("text (%d, %d): %s\n", text.x, text.y, text.text.c_str());
+    }
+    printf("virtual time: %u ms\n", clock.millis());
+    printf("panel draw calls: %u\n", display.getNumDrawCalls());
+    printf("frames drawn: %u, dropped: %u\n", pipeline.getNumDrawnFrames(), pipeline.getNumDroppedFrames());
+    printf("journal records: %u, sector erases: %d\n", flash.getRecordSequence(), flash.getNumErases());
+
+    if (ppmPath != nullptr && !display.writePpm(ppmPath))
+    {
+        fprintf(stderr, "could not write %s\n", ppmPath);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include <algorithm>
+#include "pipeline.h"
+#include "trace.h"
+
+Pipeline pipeline;
+
+// Publish a frame. Dropped if the render side is behind.
+bool Pipeline::publishFrame(const FrameSnapshot &frame)
+{
+    if (!frames.tryPush(frame))
+    {
+        numDroppedFrames++;
+        return false;
+    }
+    return true;
+}
+
+// Publish the whole saved memory.
+bool Pipeline::publishSave(const std::vector<uint8_t> &memory)
+{
+    return saves.tryPush(memory);
+}
+
+// Write the published saves to flash, then draw and present the newest frame.
+bool Pipeline::consume(Storage &flash)
+{
+    while (saves.tryPop(image))
+    {
+        TRACE_SCOPE("flash commit");
+        // Only touch the bytes that changed, the flash write is the slow part.
+        size_t size = std::min(image.size(), flash.size());
+        for (size_t address = 0; address < size; address++)
+        {
+            if (flash.readByte(address) != image[address])
+            {
+                flash.writeByte(address, image[address]);
+            }
+        }
+        flash.commit();
+        numSaves++;
+    }
+
+    if (!frames.tryPop(latest))
+    {
+        return false;
+    }
+    // Skip to the newest frame. Its board is drawn for the columns any of the skipped frames changed.
+    while (frames.tryPop(popped))
+    {
+        if (popped.changed.isEmpty())
+        {
+            popped.changed = latest.changed;
+        }
+        else if (!latest.changed.isEmpty())
+        {
+            popped.changed.first = std::min(popped.changed.first, latest.changed.first);
+            popped.changed.last = std::max(popped.changed.last, latest.changed.last);
+        }
+        std::swap(latest, popped);
+    }
+
+    {
+        TRACE_SCOPE("draw");
+        renderer.drawFrame(latest);
+    }
+    {
+        TRACE_SCOPE("present");
+        hal.display->present();
+    }
+    numDrawnFrames++;
+    // Totals since the start.
+    TRACE_COUNTER("draw calls", renderer.getNumPushes());
+    TRACE_COUNTER("dropped frames", numDroppedFrames.load());
+    return true;
+}
+
+// Constructor of the MirrorStorage class
+MirrorStorage::MirrorStorage(Storage &flashStorage, Pipeline &targetPipeline)
+    : flash(flashStorage), pipeline(targetPipeline)
+{
+}
+
+// Read the flash into the copy.
+bool MirrorStorage::begin(size_t size)
+{
+    if (!flash.begin(size))
+    {
+        return false;
+    }
+    memory.resize(size);
+    for (size_t address = 0; address < size; address++)
+    {
+        memory[address] = flash.readByte(address);
+    }
+    return true;
+}
+
+size_t MirrorStorage::size()
+{
+    return memory.size();
+}
+
+uint8_t MirrorStorage::readByte(int address)
+{
+    return memory[address];
+}
+
+void MirrorStorage::writeByte(int address, uint8_t value)
+{
+    memory[address] = value;
+}
+
+// Publish the copy. If the persistence side is behind, try again at the next persistence tick.
+bool MirrorStorage::commit()
+{
+    if (!pipeline.publishSave(memory))
+    {
+        requestCommit();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+#include "hal.h"
+#include "renderer.h"
+#include "spsc_queue.h"
+
+// Number of frames and save images that can wait for the render/persistence side.
+#define FRAME_QUEUE_SIZE 4
+#define SAVE_QUEUE_SIZE 2
+#define LEVEL_QUEUE_SIZE 2
+
+// A new level, described by what generates its board.
+struct LevelInfo
+{
+    int width = 0;
+    int height = 0;
+    int numBlockTypes = 0;
+    uint32_t seed = 0;
+};
+
+/** Pipeline between the game logic and the render/persistence side.
+ * The logic publishes immutable snapshots of the frame and of the saved memory,
+ * the other side draws the newest frame and writes the saves to flash.
+ * The two sides only share the queues, so they can run on different cores:
+ * a slow SPI push or flash commit never stalls the input handling. */
+class Pipeline
+{
+private:
+    SpscQueue<FrameSnapshot, FRAME_QUEUE_SIZE> frames;
+    SpscQueue<std::vector<uint8_t>, SAVE_QUEUE_SIZE> saves;
+    SpscQueue<LevelInfo, LEVEL_QUEUE_SIZE> levels;
+
+    // Consumer side buffers, reused for every pop.
+    FrameSnapshot popped;
+    FrameSnapshot latest;
+    std::vector<uint8_t> image;
+
+    // Statistics, read from any thread.
+    std::atomic<uint32_t> numDroppedFrames{0};
+    std::atomic<uint32_t> numDrawnFrames{0};
+    std::atomic<uint32_t> numSaves{0};
+
+public:
+    // Logic side: publish a frame. Returns false (and drops it) if the render side is behind.
+    bool publishFrame(const FrameSnapshot &frame);
+
+    // Logic side: publish the whole saved memory. Returns false if the persistence side is behind.
+    bool publishSave(const std::vector<uint8_t> &memory);
+
+    // Logic side: publish a new level for the background analysis. Returns false if the analysis is behind.
+    bool publishLevel(const LevelInfo &level) { return levels.tryPush(level); }
+
+    // Analysis side: take the oldest published level. Returns false if there is none.
+    bool popLevel(LevelInfo &level) { return levels.tryPop(level); }
+
+    /** Render/persistence side: write the published saves to flash, then draw the newest frame
+     * and present it. The changed columns of skipped frames are merged into it.
+     * Returns true if a frame was drawn. */
+    bool consume(Storage &flash);
+
+    uint32_t getNumDroppedFrames() const { return numDroppedFrames.load(); }
+    uint32_t getNumDrawnFrames() const { return numDrawnFrames.load(); }
+    uint32_t getNumSaves() const { return numSaves.load(); }
+};
+
+/** Storage used by the game logic when it runs behind a Pipeline.
+ * Reads and writes go to a copy of the flash in RAM. A commit publishes the copy
+ * to the persistence side instead of writing the flash itself. */
+class MirrorStorage : public Storage
+{
+private:
+    Storage &flash;
+    Pipeline &pipeline;
+    std::vector<uint8_t> memory;
+
+public:
+    MirrorStorage(Storage &flashStorage, Pipeline &targetPipeline);
+
+    // Read the flash into the copy. Call before the render/persistence side starts.
+    bool begin(size_t size) override;
+    size_t size() override;
+    uint8_t readByte(int address) override;
+    void writeByte(int address, uint8_t value) override;
+    bool commit() override;
+};
+
+// The pipeline used by the game.
+extern Pipeline pipeline;
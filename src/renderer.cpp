@@ -0,0 +1,320 @@
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include "renderer.h"
+
+Renderer renderer;
+
+// Show the given screen. The display is cleared if it was showing another one.
+void Renderer::useScreen(Screen newScreen)
+{
+    if (newScreen == screen)
+    {
+        return;
+    }
+    screen = newScreen;
+    clearDisplay();
+}
+
+// Clear the display and remember that everything on it is black.
+void Renderer::clearDisplay()
+{
+    hal.display->fillScreen(COLOR_BLACK);
+    numPushes++;
+
+    std::fill(shownColors.begin(), shownColors.end(), (uint16_t)COLOR_BLACK);
+    cursorCol = -1;
+    cursorRow = -1;
+    numTexts = 0;
+}
+
+// Forget what is on the display, so that the next frame is drawn completely.
+void Renderer::invalidate()
+{
+    screen = SCREEN_NONE;
+}
+
+// Draw the board cells that changed since the last frame.
+void Renderer::drawBoard(const PackedBoard &board, const uint16_t *colors, int newTopSpace,
+                         int newCellWidth, int newCellHeight, int firstCol, int lastCol)
+{
+    // A different board layout means nothing on the display can be reused.
+    if (board.getWidth() != boardWidth || board.getHeight() != boardHeight ||
+        newCellWidth != cellWidth || newCellHeight != cellHeight || newTopSpace != topSpace)
+    {
+        boardWidth = board.getWidth();
+        boardHeight = board.getHeight();
+        cellWidth = newCellWidth;
+        cellHeight = newCellHeight;
+        topSpace = newTopSpace;
+        shownColors.assign(board.getNumCells(), COLOR_BLACK);
+        openRects.reserve(boardHeight);
+        columnRuns.reserve(boardHeight);
+        clearDisplay();
+    }
+
+    firstCol = std::max(firstCol, 0);
+    lastCol = std::min(lastCol, boardWidth - 1);
+    bool cursorPainted = false;
+    openRects.clear();
+
+    for (int col = firstCol; col <= lastCol; col++)
+    {
+        // Find the runs of changed cells with the same color in this column.
+        columnRuns.clear();
+        for (int row = 0; row < boardHeight; row++)
+        {
+            int cellIndex = board.index(col, row);
+            uint8_t blockType = board[cellIndex];
+            uint16_t color = blockType == EMPTY_CELL ? COLOR_BLACK : colors[blockType];
+            if (color == shownColors[cellIndex])
+            {
+                continue;
+            }
+            shownColors[cellIndex] = color;
+            if (col == cursorCol && row == cursorRow)
+            {
+                cursorPainted = true;
+            }
+
+            if (!columnRuns.empty() && columnRuns.back().lastRow == row - 1 && columnRuns.back().color == color)
+            {
+                columnRuns.back().lastRow = row;
+            }
+            else
+            {
+                columnRuns.push_back({col, col, row, row, color});
+            }
+        }
+
+        /** Both lists are sorted by row. An open rectangle that ended in the previous column
+         * and has the same rows and color as a run of this column grows by one column.
+         * The other open rectangles can not grow anymore and are pushed. */
+        size_t kept = 0;
+        size_t run = 0;
+        for (size_t i = 0; i < openRects.size(); i++)
+        {
+            CellRect rect = openRects[i];
+            while (run < columnRuns.size() && columnRuns[run].firstRow < rect.firstRow)
+            {
+                run++;
+            }
+            if (run < columnRuns.size() && columnRuns[run].firstRow == rect.firstRow &&
+                columnRuns[run].lastRow == rect.lastRow && columnRuns[run].color == rect.color)
+            {
+                rect.lastCol = col;
+                columnRuns[run].firstCol = -1; // Merged into rect.
+                openRects[kept++] = rect;
+            }
+            else
+            {
+                pushRect(rect);
+            }
+        }
+        openRects.resize(kept);
+        for (const CellRect &columnRun : columnRuns)
+        {
+            if (columnRun.firstCol != -1)
+            {
+                openRects.push_back(columnRun);
+            }
+        }
+        // Keep the open rectangles sorted by row for the next column.
+        std::sort(openRects.begin(), openRects.end(), [](const CellRect &a, const CellRect &b)
+                  { return a.firstRow < b.firstRow; });
+    }
+
+    for (const CellRect &rect : openRects)
+    {
+        pushRect(rect);
+    }
+
+    // The cursor outline was painted over.
+    if (cursorPainted)
+    {
+        pushCursor();
+    }
+}
+
+// Draw the cursor outline around the cell (col, row), restoring the cell it was on before.
+void Renderer::drawCursor(int col, int row)
+{
+    if (col == cursorCol && row == cursorRow)
+    {
+        return;
+    }
+
+    // Paint the old cell again to remove the outline.
+    if (cursorCol >= 0 && cursorCol < boardWidth && cursorRow >= 0 && cursorRow < boardHeight)
+    {
+        int cellIndex = cursorCol * boardHeight + cursorRow;
+        pushRect({cursorCol, cursorCol, cursorRow, cursorRow, shownColors[cellIndex]});
+    }
+
+    cursorCol = col;
+    cursorRow = row;
+    pushCursor();
+}
+
+// Draw a text line at (x, y). Only pushed when the text at that position changed.
+void Renderer::drawText(int x, int y, int font, const char *text)
+{
+    TextSlot *slot = nullptr;
+    for (int i = 0; i < numTexts; i++)
+    {
+        if (texts[i].x == x && texts[i].y == y)
+        {
+            slot = &texts[i];
+        }
+    }
+
+    if (slot != nullptr)
+    {
+        if (slot->font == font && strcmp(slot->text, text) == 0)
+        {
+            return; // Nothing changed.
+        }
+        // Clear the old text.
+        int length = strlen(slot->text);
+        if (length > 0)
+        {
+            hal.display->fillRect(x, y, textWidth(slot->font, length), textHeight(slot->font), COLOR_BLACK);
+            numPushes++;
+        }
+    }
+    else if (numTexts < MAX_TEXT_SLOTS)
+    {
+        slot = &texts[numTexts];
+        numTexts++;
+        slot->x = x;
+        slot->y = y;
+    }
+
+    if (text[0] != '\0')
+    {
+        hal.display->setCursor(x, y, font);
+        hal.display->print(text);
+        numPushes++;
+    }
+
+    if (slot != nullptr)
+    {
+        slot->font = font;
+        strncpy(slot->text, text, MAX_TEXT_LENGTH - 1);
+        slot->text[MAX_TEXT_LENGTH - 1] = '\0';
+    }
+}
+
+// Draw the game screen: the board columns in the given range, the scores and the cursor.
+void Renderer::drawGame(const PackedBoard &board, const uint16_t *colors, int newTopSpace, int newCellWidth, int newCellHeight,
+                        int score, int bestScore, int cursorGroup, int newCursorCol, int newCursorRow, ColumnRange columns)
+{
+    // Coming back from another screen, the whole board has to be drawn again.
+    if (screen != SCREEN_GAME)
+    {
+        columns = {0, board.getWidth() - 1};
+    }
+    useScreen(SCREEN_GAME);
+
+    // Draw the matrix
+    drawBoard(board, colors, newTopSpace, newCellWidth, newCellHeight, columns.first, columns.last);
+
+    /** Draw the score, followed by what the click at the cursor would score: one point per block of its group.
+     * Both are one text, so "+N" always starts after the last digit of the score and is cleared with it. */
+    char text[MAX_TEXT_LENGTH];
+    if (cursorGroup >= 2)
+    {
+        snprintf(text, sizeof(text), "Score: %d +%d", score, cursorGroup);
+    }
+    else
+    {
+        snprintf(text, sizeof(text), "Score: %d", score);
+    }
+    drawText(5, 2, 1, text);
+
+    snprintf(text, sizeof(text), "Best: %d", bestScore);
+    drawText(100, 2, 1, text);
+
+    // Draw the cursor on top of everything at the end.
+    drawCursor(newCursorCol, newCursorRow);
+}
+
+// Draw the menu screen. Only the lines that changed are pushed.
+void Renderer::drawMenu(const char *const *optionNames, int numOptions, int selectedOption)
+{
+    useScreen(SCREEN_MENU);
+
+    // Lines 15 pixels apart, closer when more options have to fit above the bottom of the 80-pixel screen.
+    int spacing = numOptions > 0 ? std::min(15, 72 / numOptions) : 15;
+    for (int option = 0; option < numOptions; option++)
+    {
+        int y = spacing * (option + 1);
+
+        // Draw the arrow that shows which option is selected.
+        drawText(40, y, 1, option == selectedOption ? ">" : "");
+
+        // Draw the option.
+        drawText(50, y, 1, optionNames[option]);
+    }
+}
+
+// Draw the message screen.
+void Renderer::drawMessage(const char *message)
+{
+    useScreen(SCREEN_MESSAGE);
+    drawText(30, 35, 4, message);
+}
+
+// Draw a whole frame.
+void Renderer::drawFrame(const FrameSnapshot &frame)
+{
+    switch (frame.screen)
+    {
+    case SCREEN_GAME:
+        drawGame(frame.board, frame.colors, frame.topSpace, frame.cellWidth, frame.cellHeight, frame.score, frame.bestScore,
+                 frame.cursorGroup, frame.cursorCol, frame.cursorRow, frame.changed);
+        break;
+    case SCREEN_MENU:
+        drawMenu(frame.optionNames, frame.numOptions, frame.selectedOption);
+        break;
+    case SCREEN_MESSAGE:
+        drawMessage(frame.message);
+        break;
+    case SCREEN_NONE:
+        break;
+    }
+}
+
+// Fill a rectangle of cells with its color.
+void Renderer::pushRect(const CellRect &rect)
+{
+    int x = rect.firstCol * cellWidth;
+    int y = topSpace + rect.firstRow * cellHeight;
+    int w = (rect.lastCol - rect.firstCol + 1) * cellWidth;
+    int h = (rect.lastRow - rect.firstRow + 1) * cellHeight;
+    hal.display->fillRect(x, y, w, h, rect.color);
+    numPushes++;
+}
+
+// Draw the cursor outline.
+void Renderer::pushCursor()
+{
+    if (cursorCol < 0)
+    {
+        return;
+    }
+    hal.display->drawRect(cursorCol * cellWidth, topSpace + cursorRow * cellHeight, cellWidth, cellHeight, COLOR_WHITE);
+    numPushes++;
+}
+
+// Width in pixels of a text of the given length (font 1 is 6 pixels per character, font 4 is 14).
+int Renderer::textWidth(int font, int length)
+{
+    return length * (font == 4 ? 14 : 6);
+}
+
+// Height in pixels of a text line.
+int Renderer::textHeight(int font)
+{
+    return font == 4 ? 26 : 8;
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "hal.h"
+#include "board.h"
+
+// Maximum number of text lines the renderer remembers per screen.
+#define MAX_TEXT_SLOTS 12
+// Maximum length of a remembered text line.
+#define MAX_TEXT_LENGTH 24
+
+// The screens the renderer can show. Switching screens clears the display.
+enum Screen
+{
+    SCREEN_NONE,
+    SCREEN_GAME,
+    SCREEN_MENU,
+    SCREEN_MESSAGE,
+};
+
+/** Everything a frame shows, copied out of the game state.
+ * The game publishes these to the render task, which may run on the other core,
+ * so a snapshot never points into state the game still changes (strings are literals). */
+struct FrameSnapshot
+{
+    Screen screen = SCREEN_NONE;
+    uint32_t sequence = 0; // Number of the frame, counted by the publisher.
+
+    // SCREEN_GAME
+    PackedBoard board;
+    uint16_t colors[MAX_BLOCK_TYPES] = {};
+    int topSpace = 0;
+    int cellWidth = 0;
+    int cellHeight = 0;
+    int score = 0;
+    int bestScore = 0;
+    int cursorGroup = 0; // Blocks the click at the cursor would remove, 0 if it is not a move.
+    int cursorCol = -1;
+    int cursorRow = -1;
+    ColumnRange changed = {0, -1}; // Columns that changed since the previous snapshot.
+
+    // SCREEN_MENU
+    const char *const *optionNames = nullptr;
+    int numOptions = 0;
+    int selectedOption = 0;
+
+    // SCREEN_MESSAGE
+    const char *message = "";
+};
+
+/** Incremental renderer on top of the Display.
+ * It remembers what the last frame showed (cell colors, cursor, text lines)
+ * and only pushes what changed. Changed cells are merged into vertical runs
+ * of the same color, and equal runs of neighboring columns into one rectangle,
+ * so every update is as few fillRect calls as possible. */
+class Renderer
+{
+private:
+    // A text line on the screen.
+    struct TextSlot
+    {
+        int x;
+        int y;
+        int font;
+        char text[MAX_TEXT_LENGTH];
+    };
+
+    // A rectangle of cells with the same color that still has to be pushed.
+    struct CellRect
+    {
+        int firstCol;
+        int lastCol;
+        int firstRow;
+        int lastRow;
+        uint16_t color;
+    };
+
+    Screen screen = SCREEN_NONE;
+
+    // Board geometry and the color of every cell on the screen.
+    int boardWidth = 0;
+    int boardHeight = 0;
+    int cellWidth = 0;
+    int cellHeight = 0;
+    int topSpace = 0;
+    std::vector<uint16_t> shownColors;
+
+    // Cursor outline on the screen (-1 if none).
+    int cursorCol = -1;
+    int cursorRow = -1;
+
+    TextSlot texts[MAX_TEXT_SLOTS];
+    int numTexts = 0;
+
+    // Rectangles being merged while pushing the cells (reserved for the board height).
+    std::vector<CellRect> openRects;
+    std::vector<CellRect> columnRuns;
+
+    int numPushes = 0; // Number of draw calls sent to the display.
+
+    void clearDisplay();
+    void pushRect(const CellRect &rect);
+    void pushCursor();
+    static int textWidth(int font, int length);
+    static int textHeight(int font);
+
+public:
+    // Show the given screen. The display is cleared if it was showing another one.
+    void useScreen(Screen newScreen);
+
+    // Forget what is on the display, so that the next frame is drawn completely.
+    void invalidate();
+
+    /** Draw the board cells of the columns [firstCol, lastCol] that changed since the last frame.
+     * colors maps a block type to its color, empty cells are black.
+     * A new board layout clears the display, so draw the board before the texts. */
+    void drawBoard(const PackedBoard &board, const uint16_t *colors, int newTopSpace,
+                   int newCellWidth, int newCellHeight, int firstCol, int lastCol);
+
+    // Draw the cursor outline around the cell (col, row), restoring the cell it was on before.
+    void drawCursor(int col, int row);
+
+    // Draw a text line at (x, y). Only pushed when the text at that position changed.
+    void drawText(int x, int y, int font, const char *text);
+
+    /** Draw the game screen: the board columns in the given range, the scores and the cursor.
+     * cursorGroup is what the click at the cursor would score, shown next to the score if it is a move. */
+    void drawGame(const PackedBoard &board, const uint16_t *colors, int newTopSpace, int newCellWidth, int newCellHeight,
+                  int score, int bestScore, int cursorGroup, int newCursorCol, int newCursorRow, ColumnRange columns);
+
+    // Draw the menu screen with an arrow in front of the selected option.
+    void drawMenu(const char *const *optionNames, int numOptions, int selectedOption);
+
+    // Draw the message screen.
+    void drawMessage(const char *message);
+
+    // Draw a whole frame.
+    void drawFrame(const FrameSnapshot &frame);
+
+    // Number of draw calls sent to the display so far.
+    int getNumPushes() const { return numPushes; }
+};
+
+// The renderer used by the game.
+extern Renderer renderer;
@@ -0,0 +1,279 @@
+#include "fixed_board.h"
+#include "rollout.h"
+
+// Constructor of the RolloutEngine class.
+RolloutEngine::RolloutEngine(int numWorkers) : queues(numWorkers), workers(numWorkers)
+{
+}
+
+// Random number in [0, bound) from the xorshift32 generator of the worker.
+uint32_t RolloutEngine::Worker::nextRandom(uint32_t bound)
+{
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return ((uint64_t)rngState * bound) >> 32;
+}
+
+// Put a cell of every move of the board in cells.
+void RolloutEngine::Worker::listMoves(const PackedBoard &board, std::vector<int> &cells)
+{
+    cells.clear();
+    moves.forEachMove(board, [&](int cellIndex, int blockType, int size)
+                      { cells.push_back(cellIndex); });
+}
+
+// Play uniformly random moves from the position to the end. Returns the final score.
+template <typename Position>
+int32_t RolloutEngine::Worker::playRandom(Position &position, int32_t startScore, std::vector<int> &played)
+{
+    std::vector<int> &cells = moveLists[0];
+    int32_t score = startScore;
+    played.clear();
+    for (;;)
+    {
+        cells.clear();
+        position.forEachMove([&](int cellIndex, int blockType, int size)
+                             { cells.push_back(cellIndex); });
+        if (cells.empty())
+        {
+            break;
+        }
+        int cellIndex = cells[nextRandom(cells.size())];
+        score += moveScore(position.play(cellIndex));
+        played.push_back(cellIndex);
+    }
+    cleared = position.isCleared();
+    return score + (cleared ? CLEAR_BONUS : 0);
+}
+
+/** Play uniformly random moves from the board to the end. Returns the final score.
+ * The shipped board sizes play on a Board of fixed size, the others on a copy of the board. */
+int32_t RolloutEngine::Worker::rollout(const PackedBoard &start, int32_t startScore, std::vector<int> &played)
+{
+    int32_t total = 0;
+    if (withFixedBoard(start.getWidth(), start.getHeight(), [&](auto &position)
+                       {
+                           position.load(start);
+                           total = playRandom(position, startScore, played); }))
+    {
+        return total;
+    }
+    positions[0] = start;
+    GeneratorBoard position = {moves, positions[0]};
+    return playRandom(position, startScore, played);
+}
+
+/** Nested Monte Carlo search of the given level from the board. Returns the final score of the game it played.
+ * Every level has its own buffers, so the search of the level below can run without copying them. */
+int32_t RolloutEngine::Worker::nested(int level, const PackedBoard &start, int32_t startScore, std::vector<int> &played)
+{
+    PackedBoard &position = positions[level];
+    position = start;
+    int32_t score = startScore;
+    std::vector<int> &best = bestLines[level]; // Best game found from start, it begins with the played moves.
+    int32_t bestTotal = -1;
+    best.clear();
+    played.clear();
+    for (;;)
+    {
+        std::vector<int> &cells = moveLists[level];
+        listMoves(position, cells);
+        if (cells.empty())
+        {
+            break;
+        }
+        for (int cellIndex : cells)
+        {
+            PackedBoard &child = children[level];
+            child = position;
+            int32_t childScore = score + moveScore(moves.play(child, cellIndex));
+            std::vector<int> &childLine = childLines[level];
+            int32_t total = level == 1 ? rollout(child, childScore, childLine)
+                                       : nested(level - 1, child, childScore, childLine);
+            if (total > bestTotal)
+            {
+                bestTotal = total;
+                best.assign(played.begin(), played.end());
+                best.push_back(cellIndex);
+                best.insert(best.end(), childLine.begin(), childLine.end());
+            }
+        }
+
+        // Follow the best game one move further.
+        int next = best[played.size()];
+        score += moveScore(moves.play(position, next));
+        played.push_back(next);
+    }
+    cleared = position.isColumnEmpty(0);
+    return score + (cleared ? CLEAR_BONUS : 0);
+}
+
+// Prepare the analysis of the board.
+bool RolloutEngine::start(const PackedBoard &board, int numRollouts, int nestingLevel, uint32_t newSeed)
+{
+    root = board;
+    level = nestingLevel < 0 ? 0 : (nestingLevel > ROLLOUT_MAX_LEVEL ? ROLLOUT_MAX_LEVEL : nestingLevel);
+    seed = newSeed;
+    cancelled = false;
+    numSteals = 0;
+
+    int numCells = board.getNumCells();
+    for (Worker &worker : workers)
+    {
+        worker.moves.setDimensions(board.getWidth(), board.getHeight());
+        for (int i = 0; i <= ROLLOUT_MAX_LEVEL; i++)
+        {
+            worker.positions[i].resize(board.getWidth(), board.getHeight());
+            worker.children[i].resize(board.getWidth(), board.getHeight());
+            worker.moveLists[i].reserve(numCells);
+            worker.bestLines[i].reserve(numCells);
+            worker.childLines[i].reserve(numCells);
+        }
+        worker.line.reserve(numCells);
+        worker.bestLine.reserve(numCells);
+        worker.bestLine.clear();
+        worker.bestScore = -1;
+        worker.bestTask = 0;
+    }
+    workers[0].listMoves(board, firstMoves);
+    if (firstMoves.empty())
+    {
+        return false;
+    }
+    for (Worker &worker : workers)
+    {
+        worker.stats.assign(firstMoves.size(), RolloutMoveStats());
+        for (size_t i = 0; i < firstMoves.size(); i++)
+        {
+            worker.stats[i].cellIndex = firstMoves[i];
+        }
+    }
+
+    // The batches of the first moves are interleaved, so every queue gets a mix of short and long games.
+    int taskSize = level == 0 ? ROLLOUT_BATCH : 1;
+    int numBatches = (numRollouts + taskSize - 1) / taskSize;
+    int numTasks = numBatches * firstMoves.size();
+    int numWorkers = workers.size();
+    for (TaskQueue &queue : queues)
+    {
+        queue.tasks.resize(numTasks / numWorkers + 1);
+        queue.head = 0;
+        queue.tail = 0;
+    }
+    uint32_t number = 0;
+    for (int batch = 0; batch < numBatches; batch++)
+    {
+        int count = batch == numBatches - 1 ? numRollouts - batch * taskSize : taskSize;
+        for (size_t firstMove = 0; firstMove < firstMoves.size(); firstMove++)
+        {
+            TaskQueue &queue = queues[number % numWorkers];
+            queue.tasks[queue.tail++] = {(int)firstMove, count, number};
+            number++;
+        }
+    }
+    return true;
+}
+
+// Take a task from the back of the own queue, or steal one from the front of another queue.
+bool RolloutEngine::popTask(int workerIndex, Task &task)
+{
+    {
+        TaskQueue &own = queues[workerIndex];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (own.tail > own.head)
+        {
+            task = own.tasks[--own.tail];
+            return true;
+        }
+    }
+    int numWorkers = queues.size();
+    for (int i = 1; i < numWorkers; i++)
+    {
+        TaskQueue &victim = queues[(workerIndex + i) % numWorkers];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (victim.tail > victim.head)
+        {
+            task = victim.tasks[victim.head++];
+            numSteals++;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Run the rollouts of a task and add them to the statistics of the worker.
+void RolloutEngine::runTask(Worker &worker, const Task &task)
+{
+    worker.rngState = (seed ^ (task.number * 0x9E3779B9)) | 1;
+    int firstCell = firstMoves[task.firstMove];
+    PackedBoard &start = worker.children[0];
+    start = root;
+    int32_t firstScore = moveScore(worker.moves.play(start, firstCell));
+
+    RolloutMoveStats &stats = worker.stats[task.firstMove];
+    for (int i = 0; i < task.count; i++)
+    {
+        int32_t total = level == 0 ? worker.rollout(start, firstScore, worker.line)
+                                   : worker.nested(level, start, firstScore, worker.line);
+        stats.numRollouts++;
+        stats.totalScore += total;
+        stats.numCleared += worker.cleared;
+        if (total > stats.bestScore)
+        {
+            stats.bestScore = total;
+        }
+        // Ties go to the lowest task, so the best line does not depend on the scheduling.
+        if (total > worker.bestScore || (total == worker.bestScore && task.number < worker.bestTask))
+        {
+            worker.bestScore = total;
+            worker.bestTask = task.number;
+            worker.bestLine.clear();
+            worker.bestLine.push_back(firstCell);
+            worker.bestLine.insert(worker.bestLine.end(), worker.line.begin(), worker.line.end());
+        }
+    }
+}
+
+// Run tasks until none is left or the analysis is cancelled.
+void RolloutEngine::work(int workerIndex)
+{
+    Worker &worker = workers[workerIndex];
+    Task task;
+    while (!cancelled && popTask(workerIndex, task))
+    {
+        runTask(worker, task);
+    }
+}
+
+// Merge the results of the workers.
+RolloutResult RolloutEngine::getResult() const
+{
+    RolloutResult result;
+    result.moves.assign(firstMoves.size(), RolloutMoveStats());
+    uint32_t bestTask = 0;
+    for (const Worker &worker : workers)
+    {
+        for (size_t i = 0; i < firstMoves.size() && i < worker.stats.size(); i++)
+        {
+            const RolloutMoveStats &stats = worker.stats[i];
+            RolloutMoveStats &merged = result.moves[i];
+            merged.cellIndex = firstMoves[i];
+            merged.numRollouts += stats.numRollouts;
+            merged.totalScore += stats.totalScore;
+            merged.numCleared += stats.numCleared;
+            if (stats.bestScore > merged.bestScore)
+            {
+                merged.bestScore = stats.bestScore;
+            }
+            result.numRollouts += stats.numRollouts;
+        }
+        if (worker.bestScore > result.bestScore || (worker.bestScore == result.bestScore && worker.bestScore >= 0 && worker.bestTask < bestTask))
+        {
+            result.bestScore = worker.bestScore;
+            result.bestLine = worker.bestLine;
+            bestTask = worker.bestTask;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include "board.h"
+#include "moves.h"
+
+// Random rollouts in one task. Tasks of nested searches hold one search.
+#define ROLLOUT_BATCH 32
+// Deepest nesting level of a nested Monte Carlo search.
+#define ROLLOUT_MAX_LEVEL 3
+// Random rollouts per first move when the device analyses a new level on its idle core.
+#define ROLLOUT_DEVICE_BUDGET 8
+
+// What the rollouts found for one first move of the position.
+struct RolloutMoveStats
+{
+    int cellIndex = -1;    // Packed index of a cell of the move.
+    uint32_t numRollouts = 0;
+    int64_t totalScore = 0; // Sum of the final scores, in the standard SameGame scoring.
+    int32_t bestScore = -1;
+    uint32_t numCleared = 0; // Rollouts that cleared the board.
+
+    double meanScore() const { return numRollouts ? (double)totalScore / numRollouts : 0; }
+};
+
+// Merged result of all workers.
+struct RolloutResult
+{
+    std::vector<RolloutMoveStats> moves; // One entry per first move, in the order of their lowest cell.
+    uint64_t numRollouts = 0;
+    int32_t bestScore = -1;
+    std::vector<int> bestLine; // Cells of the moves of the best game found, from the position.
+};
+
+/** Monte Carlo analysis of a position, spread over worker threads with work stealing.
+ * start() splits the rollouts of every first move into tasks and deals them round-robin to the queues of the workers.
+ * Each worker runs work() on a thread of its own: it takes tasks from the back of its own queue and,
+ * once that is empty, steals from the front of the others, so the workers with short games help the ones with long games.
+ * Level 0 plays uniformly random moves to the end. Level n is a nested Monte Carlo search: at every step it tries
+ * each move followed by a level n - 1 search, and follows the best game found so far.
+ * The random generator of a task is seeded from the seed and the task number, so the result does not depend
+ * on the number of workers or on which worker ran which task.
+ * Nothing is allocated by work(): start() sizes the buffers of the workers. */
+class RolloutEngine
+{
+private:
+    struct Task
+    {
+        int firstMove; // Index in the first moves of the position.
+        int count;     // Rollouts or nested searches to run.
+        uint32_t number;
+    };
+
+    // Deque of tasks of one worker. The owner pops at the back, thieves take from the front.
+    struct TaskQueue
+    {
+        std::mutex lock;
+        std::vector<Task> tasks;
+        int head = 0;
+        int tail = 0;
+    };
+
+    // State of one worker, only touched by its own thread while work() runs.
+    struct Worker
+    {
+        MoveGenerator moves;
+        uint32_t rngState = 1;
+        bool cleared = false; // The last game played cleared the board.
+        std::vector<RolloutMoveStats> stats;
+        int32_t bestScore = -1;
+        uint32_t bestTask = 0;
+        std::vector<int> bestLine;
+
+        // Buffers of every nesting level.
+        PackedBoard positions[ROLLOUT_MAX_LEVEL + 1];
+        PackedBoard children[ROLLOUT_MAX_LEVEL + 1];
+        std::vector<int> moveLists[ROLLOUT_MAX_LEVEL + 1];
+        std::vector<int> bestLines[ROLLOUT_MAX_LEVEL + 1];
+        std::vector<int> childLines[ROLLOUT_MAX_LEVEL + 1];
+        std::vector<int> line;
+
+        uint32_t nextRandom(uint32_t bound);
+        void listMoves(const PackedBoard &board, std::vector<int> &cells);
+        template <typename Position>
+        int32_t playRandom(Position &position, int32_t startScore, std::vector<int> &played);
+        int32_t rollout(const PackedBoard &start, int32_t startScore, std::vector<int> &played);
+        int32_t nested(int level, const PackedBoard &start, int32_t startScore, std::vector<int> &played);
+    };
+
+    std::vector<TaskQueue> queues;
+    std::vector<Worker> workers;
+    PackedBoard root;
+    std::vector<int> firstMoves;
+    int level = 0;
+    uint32_t seed = 0;
+    std::atomic<bool> cancelled{false};
+    std::atomic<uint32_t> numSteals{0};
+
+    bool popTask(int workerIndex, Task &task);
+    void runTask(Worker &worker, const Task &task);
+
+public:
+    explicit RolloutEngine(int numWorkers);
+
+    /** Prepare the analysis of the board: numRollouts rollouts (or nested searches when level > 0)
+     * for every first move. Call while no worker runs. Returns false if the board has no move. */
+    bool start(const PackedBoard &board, int numRollouts, int nestingLevel, uint32_t newSeed);
+
+    // Run tasks until none is left in any queue, or the analysis is cancelled. Call from one thread per worker.
+    void work(int workerIndex);
+
+    // Make the workers return after their current task.
+    void cancel() { cancelled = true; }
+
+    // Merge the results of the workers. Call once all of them returned from work().
+    RolloutResult getResult() const;
+
+    int getNumWorkers() const { return (int)workers.size(); }
+    uint32_t getNumSteals() const { return numSteals.load(); }
+};
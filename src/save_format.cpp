@@ -0,0 +1,266 @@
+#include "save_format.h"
+
+// CRC-32 of every 4-bit value, for a table of 64 bytes instead of 1 KB.
+static const uint32_t crcNibbleTable[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+};
+
+// Update a CRC-32 (the zlib one) with length bytes.
+uint32_t crc32(const uint8_t *data, size_t length, uint32_t crc)
+{
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++)
+    {
+        crc ^= data[i];
+        crc = crcNibbleTable[crc & 0x0F] ^ (crc >> 4);
+        crc = crcNibbleTable[crc & 0x0F] ^ (crc >> 4);
+    }
+    return ~crc;
+}
+
+// Bits written low bit first into a byte vector.
+class BitWriter
+{
+private:
+    std::vector<uint8_t> &bytes;
+    uint32_t buffer = 0;
+    int numBits = 0;
+
+public:
+    BitWriter(std::vector<uint8_t> &output) : bytes(output) {}
+
+    void write(uint32_t value, int count)
+    {
+        buffer |= value << numBits;
+        numBits += count;
+        while (numBits >= 8)
+        {
+            bytes.push_back(buffer & 0xFF);
+            buffer >>= 8;
+            numBits -= 8;
+        }
+    }
+
+    // Pad the last byte with zeros.
+    void flush()
+    {
+        if (numBits > 0)
+        {
+            bytes.push_back(buffer & 0xFF);
+        }
+        buffer = 0;
+        numBits = 0;
+    }
+};
+
+// Bits read low bit first from storage, keeping the CRC of every byte read.
+class BitReader
+{
+private:
+    Storage &storage;
+    int address;
+    int end;
+    uint32_t buffer = 0;
+    int numBits = 0;
+    uint32_t crc = 0;
+
+public:
+    bool overrun = false; // Tried to read past the end of the storage.
+
+    BitReader(Storage &source, int startAddress) : storage(source), address(startAddress), end(source.size()) {}
+
+    uint8_t readByte()
+    {
+        if (address >= end)
+        {
+            overrun = true;
+            return 0;
+        }
+        uint8_t value = storage.readByte(address);
+        address++;
+        crc = crc32(&value, 1, crc);
+        return value;
+    }
+
+    uint32_t read(int count)
+    {
+        while (numBits < count)
+        {
+            buffer |= (uint32_t)readByte() << numBits;
+            numBits += 8;
+        }
+        uint32_t value = buffer & ((1u << count) - 1);
+        buffer >>= count;
+        numBits -= count;
+        return value;
+    }
+
+    // Drop the padding bits of the last byte.
+    void align()
+    {
+        buffer = 0;
+        numBits = 0;
+    }
+
+    uint32_t getCrc() const { return crc; }
+};
+
+// Check that a column holds no block at all (a board that is not collapsed can have holes at the bottom).
+static bool isColumnClear(const PackedBoard &board, int col)
+{
+    const uint8_t *cells = board.column(col);
+    for (int row = 0; row < board.getHeight(); row++)
+    {
+        if (cells[row] != EMPTY_CELL)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Encode the game into bytes.
+bool encodeSave(const PackedBoard &board, int numColors, int32_t score, std::vector<uint8_t> &bytes)
+{
+    int width = board.getWidth();
+    int height = board.getHeight();
+    if (width < 1 || width > 255 || height < 1 || height > 255 || numColors < 1 || numColors > SAVE_MAX_COLORS)
+    {
+        return false;
+    }
+
+    bytes.clear();
+    bytes.push_back(SAVE_VERSION);
+    bytes.push_back(width);
+    bytes.push_back(height);
+    bytes.push_back(numColors);
+
+    uint32_t value = (uint32_t)score;
+    while (value >= 0x80)
+    {
+        bytes.push_back((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    bytes.push_back(value);
+
+    BitWriter bits(bytes);
+    int col = 0;
+    while (col < width)
+    {
+        // Empty columns are stored as runs.
+        int run = 0;
+        while (col + run < width && run < 256 && isColumnClear(board, col + run))
+        {
+            run++;
+        }
+        if (run > 0)
+        {
+            bits.write(0, 1);
+            bits.write(run - 1, 8);
+            col += run;
+            continue;
+        }
+
+        bits.write(1, 1);
+        const uint8_t *cells = board.column(col);
+        for (int row = height - 1; row >= 0; row--)
+        {
+            if (cells[row] == EMPTY_CELL)
+            {
+                bits.write(SAVE_EMPTY_CODE, 3);
+            }
+            else if (cells[row] < numColors)
+            {
+                bits.write(cells[row], 3);
+            }
+            else
+            {
+                return false;
+            }
+        }
+        col++;
+    }
+    bits.flush();
+
+    uint32_t crc = crc32(bytes.data(), bytes.size());
+    for (int i = 0; i < 4; i++)
+    {
+        bytes.push_back((crc >> (8 * i)) & 0xFF);
+    }
+    return true;
+}
+
+// Decode the game stored at address.
+bool decodeSave(Storage &storage, int address, SavedGame &game)
+{
+    BitReader reader(storage, address);
+    if (reader.readByte() != SAVE_VERSION)
+    {
+        return false;
+    }
+    int width = reader.readByte();
+    int height = reader.readByte();
+    int numColors = reader.readByte();
+    if (width < 1 || height < 1 || numColors < 1 || numColors > SAVE_MAX_COLORS)
+    {
+        return false;
+    }
+
+    uint32_t score = 0;
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        uint8_t byte = reader.readByte();
+        score |= (uint32_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            break;
+        }
+    }
+
+    PackedBoard board(width, height);
+    int col = 0;
+    while (col < width && !reader.overrun)
+    {
+        if (reader.read(1) == 0)
+        {
+            col += reader.read(8) + 1; // A run of empty columns, already empty in the new board.
+            continue;
+        }
+        for (int row = height - 1; row >= 0; row--)
+        {
+            uint32_t code = reader.read(3);
+            if (code == SAVE_EMPTY_CODE)
+            {
+                continue;
+            }
+            if ((int)code >= numColors)
+            {
+                return false;
+            }
+            board.set(col, row, code);
+        }
+        col++;
+    }
+    reader.align();
+    if (col != width)
+    {
+        return false;
+    }
+
+    uint32_t crc = reader.getCrc();
+    uint32_t storedCrc = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        storedCrc |= (uint32_t)reader.readByte() << (8 * i);
+    }
+    if (reader.overrun || storedCrc != crc)
+    {
+        return false;
+    }
+
+    game.board = board;
+    game.numColors = numColors;
+    game.score = (int32_t)score;
+    return true;
+}
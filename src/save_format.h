@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "hal.h"
+#include "board.h"
+
+/** Compact save format of a game.
+ *
+ *   version      1 byte   SAVE_VERSION
+ *   width        1 byte
+ *   height       1 byte
+ *   numColors    1 byte
+ *   score        varint   7 bits per byte, low bits first
+ *   columns      bits     per column a 1 followed by 3 bits per cell (bottom up, SAVE_EMPTY_CODE for no block),
+ *                         or a 0 followed by 8 bits: a run of 1..256 empty columns
+ *   crc32        4 bytes  of everything before it, little-endian
+ *
+ * Bits are packed low bit first and the last byte of the columns is padded with zeros.
+ * A full 16x6 board takes 47 to 49 bytes, depending on the score (the old layout took 4 bytes per cell). */
+
+#define SAVE_VERSION 1
+// Cell code of an empty cell, so boards with up to 7 block types can be saved.
+#define SAVE_EMPTY_CODE 7
+#define SAVE_MAX_COLORS 7
+
+// A game as it is stored.
+struct SavedGame
+{
+    PackedBoard board;
+    int numColors = 0;
+    int32_t score = 0;
+};
+
+// Update a CRC-32 (the zlib one) with length bytes.
+uint32_t crc32(const uint8_t *data, size_t length, uint32_t crc = 0);
+
+// Largest encoded size of a board of the given dimensions: the header, the score varint, the cells and the CRC.
+constexpr size_t maxSaveSize(int width, int height)
+{
+    return 4 + 5 + (width * (1 + 3 * height) + 7) / 8 + 4;
+}
+
+/** Encode the game into bytes (cleared first). Returns false if it does not fit the format
+ * (a dimension over 255 or more than SAVE_MAX_COLORS block types). */
+bool encodeSave(const PackedBoard &board, int numColors, int32_t score, std::vector<uint8_t> &bytes);
+
+/** Decode the game stored at address. Returns false if there is no valid save there:
+ * an other version, impossible dimensions, a cell code out of range, or a CRC mismatch.
+ * The game is only filled in when everything checks out. */
+bool decodeSave(Storage &storage, int address, SavedGame &game);
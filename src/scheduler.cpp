@@ -0,0 +1,81 @@
+#include <string.h>
+#include "hal.h"
+#include "scheduler.h"
+
+// Add a task that runs every periodMs.
+bool Scheduler::addTask(const char *name, uint32_t periodMs, void (*run)(uint32_t now))
+{
+    if (numTasks == MAX_TASKS)
+    {
+        return false;
+    }
+    tasks[numTasks] = {name, periodMs, 0, false, run, 0};
+#ifdef TRACE
+    tasks[numTasks].traceId = tracer.registerName(name);
+#endif
+    numTasks++;
+    return true;
+}
+
+// Run the tasks whose deadline has passed. Returns the time until the next deadline.
+uint32_t Scheduler::runDue(uint32_t now)
+{
+    uint32_t untilNext = UINT32_MAX;
+    for (int i = 0; i < numTasks; i++)
+    {
+        Task &task = tasks[i];
+        if (!task.started)
+        {
+            task.started = true;
+            task.nextRun = now;
+        }
+
+        // Signed difference, so that the millis() wrap-around is handled.
+        if ((int32_t)(now - task.nextRun) >= 0)
+        {
+#ifdef TRACE
+            {
+                TraceScope scope(task.traceId);
+                task.run(now);
+            }
+#else
+            task.run(now);
+#endif
+
+            // Skip the periods that were missed instead of running the task several times in a row.
+            uint32_t missed = (now - task.nextRun) / task.periodMs;
+            task.overruns += missed;
+            task.nextRun += (missed + 1) * task.periodMs;
+        }
+
+        uint32_t wait = task.nextRun - now;
+        if (wait < untilNext)
+        {
+            untilNext = wait;
+        }
+    }
+    return untilNext;
+}
+
+// Run the due tasks, then idle until the next deadline.
+void Scheduler::loopOnce()
+{
+    uint32_t wait = runDue(hal.clock->millis());
+    if (wait > 0 && wait != UINT32_MAX)
+    {
+        hal.clock->delay(wait);
+    }
+}
+
+// Number of missed deadlines of a task.
+int Scheduler::getOverruns(const char *name) const
+{
+    for (int i = 0; i < numTasks; i++)
+    {
+        if (strcmp(tasks[i].name, name) == 0)
+        {
+            return tasks[i].overruns;
+        }
+    }
+    return -1;
+}
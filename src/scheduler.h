@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+#include "trace.h"
+
+// Maximum number of tasks in a scheduler.
+#define MAX_TASKS 8
+
+/** Fixed-tick cooperative scheduler.
+ * Every task has a period and runs when its deadline has passed, in the order the tasks were added.
+ * Between deadlines the core idles in Clock::delay instead of busy polling. */
+class Scheduler
+{
+private:
+    struct Task
+    {
+        const char *name;
+        uint32_t periodMs;
+        uint32_t nextRun;
+        bool started;
+        void (*run)(uint32_t now);
+        uint32_t overruns; // Number of deadlines that were missed completely.
+#ifdef TRACE
+        uint8_t traceId; // Every run of the task is a span named after it.
+#endif
+    };
+
+    Task tasks[MAX_TASKS];
+    int numTasks = 0;
+
+public:
+    // Add a task that runs every periodMs, starting at the first call of runDue.
+    bool addTask(const char *name, uint32_t periodMs, void (*run)(uint32_t now));
+
+    // Run the tasks whose deadline has passed. Returns the time until the next deadline.
+    uint32_t runDue(uint32_t now);
+
+    // Run the due tasks, then idle until the next deadline.
+    void loopOnce();
+
+    // Number of missed deadlines of a task (-1 if there is no such task).
+    int getOverruns(const char *name) const;
+};
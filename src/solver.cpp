@@ -0,0 +1,204 @@
+#include <algorithm>
+#include "solver.h"
+#include "hal.h"
+
+// Constructor of the Solver class. The beams are allocated here, once.
+Solver::Solver() : beam(SOLVER_MAX_BEAM), nextBeam(SOLVER_MAX_BEAM)
+{
+    candidates.reserve(SOLVER_MAX_BEAM * SOLVER_CANDIDATES_PER_SLOT);
+}
+
+// Start a search from the board.
+void Solver::start(const PackedBoard &board)
+{
+    root.board = board;
+    root.hash = board.hash();
+    root.score = 0;
+    root.firstMove = -1;
+    root.depth = 0;
+    std::fill(root.counts, root.counts + MAX_BLOCK_TYPES, 0);
+    for (int cellIndex = 0; cellIndex < board.getNumCells(); cellIndex++)
+    {
+        if (board[cellIndex] != EMPTY_CELL)
+        {
+            root.counts[board[cellIndex]]++;
+        }
+    }
+    moves.setDimensions(board.getWidth(), board.getHeight());
+
+    result = SolverResult();
+    beamWidth = 1;
+    running = true;
+    startIteration();
+}
+
+// Begin a search of the current width from the root.
+void Solver::startIteration()
+{
+    beam[0] = root;
+    beamSize = 1;
+    expandIndex = 0;
+    candidates.clear();
+}
+
+// Search for at most budgetMicros.
+bool Solver::step(uint32_t budgetMicros)
+{
+    uint32_t startTime = hal.clock->micros();
+    while (running && hal.clock->micros() - startTime < budgetMicros)
+    {
+        if (expandIndex < beamSize)
+        {
+            expand(expandIndex);
+            expandIndex++;
+            continue;
+        }
+        if (!candidates.empty())
+        {
+            buildNextLevel();
+            continue;
+        }
+
+        // Every line of this iteration finished. Try again with a wider beam.
+        result.beamWidth = beamWidth;
+        if (beamWidth >= SOLVER_MAX_BEAM || result.cellIndex < 0)
+        {
+            running = false; // Done, or the position has no move at all.
+            break;
+        }
+        beamWidth *= 2;
+        startIteration();
+    }
+    return !running;
+}
+
+// Generate the moves of a node of the beam. A node without moves ends a line.
+void Solver::expand(int nodeIndex)
+{
+    const Node &node = beam[nodeIndex];
+    result.numNodes++;
+
+    // Rank of the position without the move: (n - 2)^2 for the n blocks left of every type.
+    int32_t baseRank = 0;
+    int numBlocks = 0;
+    for (int type = 0; type < MAX_BLOCK_TYPES; type++)
+    {
+        numBlocks += node.counts[type];
+        if (node.counts[type] > 2)
+        {
+            baseRank += moveScore(node.counts[type]);
+        }
+    }
+
+    bool anyMove = false;
+    moves.forEachMove(node.board, [&](int cellIndex, int blockType, int size)
+                      {
+                          anyMove = true;
+                          int count = node.counts[blockType];
+                          int32_t score = node.score + moveScore(size);
+                          int32_t rank = score + baseRank - (count > 2 ? moveScore(count) : 0) +
+                                         (count - size > 2 ? moveScore(count - size) : 0);
+                          if (numBlocks == size)
+                          {
+                              rank += CLEAR_BONUS;
+                          }
+                          addCandidate({rank, score, nodeIndex, cellIndex, blockType, size}); });
+
+    if (!anyMove)
+    {
+        int32_t finalScore = node.score + (numBlocks == 0 ? CLEAR_BONUS : 0);
+        if (node.depth > 0 && (result.cellIndex < 0 || finalScore > result.score))
+        {
+            result.cellIndex = node.firstMove;
+            result.score = finalScore;
+            result.numMoves = node.depth;
+        }
+    }
+}
+
+// Keep the move if it is one of the beamWidth best of the level.
+void Solver::addCandidate(const Candidate &candidate)
+{
+    auto worseFirst = [](const Candidate &a, const Candidate &b)
+    { return a.rank > b.rank; };
+    int maxCandidates = skipDuplicates ? beamWidth * SOLVER_CANDIDATES_PER_SLOT : beamWidth;
+    if ((int)candidates.size() < maxCandidates)
+    {
+        candidates.push_back(candidate);
+        std::push_heap(candidates.begin(), candidates.end(), worseFirst);
+    }
+    else if (candidate.rank > candidates.front().rank)
+    {
+        std::pop_heap(candidates.begin(), candidates.end(), worseFirst);
+        candidates.back() = candidate;
+        std::push_heap(candidates.begin(), candidates.end(), worseFirst);
+    }
+}
+
+/** Put the position in the set of the level. Returns false if it is there already.
+ * The cleared board hashes to 0 and is never found, which only costs an expansion that finds no move. */
+bool Solver::addToLevel(uint64_t hash)
+{
+    for (uint64_t slot = hash;; slot++)
+    {
+        uint64_t &entry = levelHashes[slot & (SOLVER_LEVEL_SLOTS - 1)];
+        if (entry == 0)
+        {
+            entry = hash;
+            return true;
+        }
+        if (entry == hash)
+        {
+            return false;
+        }
+    }
+}
+
+// Play the kept moves to make the next level of the beam.
+void Solver::buildNextLevel()
+{
+    auto worseFirst = [](const Candidate &a, const Candidate &b)
+    { return a.rank > b.rank; };
+    if (skipDuplicates)
+    {
+        std::sort_heap(candidates.begin(), candidates.end(), worseFirst); // Best rank first.
+        std::fill(levelHashes, levelHashes + SOLVER_LEVEL_SLOTS, 0);
+    }
+
+    beamSize = 0;
+    for (size_t i = 0; i < candidates.size() && beamSize < beamWidth; i++)
+    {
+        const Candidate &candidate = candidates[i];
+        const Node &parent = beam[candidate.parent];
+        Node &child = nextBeam[beamSize];
+        child.board = parent.board; // Reuses the memory of the node.
+        child.hash = parent.hash;
+        moves.play(child.board, candidate.cellIndex, &child.hash);
+        child.score = candidate.score;
+        child.firstMove = parent.depth == 0 ? candidate.cellIndex : parent.firstMove;
+        child.depth = parent.depth + 1;
+
+        // The same board ranks by its score, so the copy that came first scored at least as much: skip this one.
+        if (skipDuplicates && !addToLevel(child.hash))
+        {
+            result.numDuplicates++;
+            continue;
+        }
+
+        std::copy(parent.counts, parent.counts + MAX_BLOCK_TYPES, child.counts);
+        child.counts[candidate.blockType] -= candidate.size;
+        beamSize++;
+    }
+    expandIndex = 0;
+    candidates.clear();
+    std::swap(beam, nextBeam);
+}
+
+// Search the board for at most budgetMicros and return the best move.
+SolverResult Solver::solve(const PackedBoard &board, uint32_t budgetMicros)
+{
+    start(board);
+    step(budgetMicros);
+    running = false;
+    return result;
+}
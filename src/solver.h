@@ -0,0 +1,100 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "board.h"
+#include "moves.h"
+
+// Widest beam the solver tries. Its memory is allocated once for this width.
+#define SOLVER_MAX_BEAM 32
+// When duplicates are left out, this many candidates per beam slot are kept, so the duplicates can be replaced.
+#define SOLVER_CANDIDATES_PER_SLOT 2
+// Slots of the hash set of the positions of a level, a power of two at least twice SOLVER_MAX_BEAM.
+#define SOLVER_LEVEL_SLOTS (2 * SOLVER_MAX_BEAM)
+
+// Best move the solver found.
+struct SolverResult
+{
+    int cellIndex = -1;    // Packed index of a cell of the best first move, -1 if there is no move.
+    int32_t score = 0;     // Standard SameGame score of the best line: (n - 2)^2 per move of n blocks, plus the clear bonus.
+    int numMoves = 0;      // Length of the best line.
+    int beamWidth = 0;     // Width of the widest search that completed.
+    uint32_t numNodes = 0; // Positions expanded so far.
+    uint32_t numDuplicates = 0; // Positions left out because a better ranked move of the level reached them first.
+};
+
+/** Hint and auto-play solver: iterative-deepening beam search with the standard SameGame scoring.
+ * Every iteration plays the position to the end with a beam twice as wide as the previous one
+ * (1, 2, 4, ... SOLVER_MAX_BEAM). The positions of a level are ranked by their score so far
+ * plus (n - 2)^2 for the n blocks left of every type, as if each type could go in one move.
+ * The search runs in slices of a time budget, so it can be spread over the ticks of the game loop.
+ * The result is the first move of the best line any iteration played to the end.
+ * A level keeps only the best ranked copy of a position that different move orders reach, and fills its beam
+ * with the next best candidates instead. The positions of the level are kept in a small hash set for that.
+ * Nothing is allocated after the constructor once the board size stays the same. */
+class Solver
+{
+private:
+    struct Node
+    {
+        PackedBoard board;
+        uint64_t hash = 0; // Zobrist hash of the board.
+        int32_t score = 0;
+        int firstMove = -1; // Cell of the first move of the line that led here.
+        int depth = 0;
+        int counts[MAX_BLOCK_TYPES] = {}; // Blocks left of every type.
+    };
+
+    // A move from a node of the beam, kept until the next level is built.
+    struct Candidate
+    {
+        int32_t rank;
+        int32_t score;
+        int parent;
+        int cellIndex;
+        int blockType;
+        int size;
+    };
+
+    std::vector<Node> beam;
+    std::vector<Node> nextBeam;
+    std::vector<Candidate> candidates; // Min-heap of the best moves of the level, at most beamWidth.
+    int beamSize = 0;
+    int expandIndex = 0; // Next node of the beam to expand.
+    int beamWidth = 1;   // Width of the running iteration.
+    bool running = false;
+
+    Node root;
+    SolverResult result; // Best line any iteration finished so far, written as soon as a line ends.
+
+    MoveGenerator moves;
+    bool skipDuplicates = true;
+    uint64_t levelHashes[SOLVER_LEVEL_SLOTS]; // Zobrist hashes of the positions of the level being built, 0 if free.
+
+    void startIteration();
+    void expand(int nodeIndex);
+    void addCandidate(const Candidate &candidate);
+    bool addToLevel(uint64_t hash);
+    void buildNextLevel();
+
+public:
+    Solver();
+
+    // Start a search from the board. Blocks must be of a type below MAX_BLOCK_TYPES.
+    void start(const PackedBoard &board);
+    // Leave out the positions a level already holds (the default), or keep every copy.
+    void setSkipDuplicates(bool skip) { skipDuplicates = skip; }
+    // Stop the running search. The result of the completed iterations stays.
+    void cancel() { running = false; }
+
+    /** Search for at most budgetMicros (measured with hal.clock).
+     * Returns true when the search is over: the widest beam completed or the position has no move. */
+    bool step(uint32_t budgetMicros);
+    bool isRunning() const { return running; }
+
+    // Best move found so far.
+    const SolverResult &getResult() const { return result; }
+
+    // Search the board for at most budgetMicros and return the best move.
+    SolverResult solve(const PackedBoard &board, uint32_t budgetMicros);
+};
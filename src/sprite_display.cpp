@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <string.h>
+#include "sprite_display.h"
+
+// Constructor of the SpriteDisplay class
+SpriteDisplay::SpriteDisplay(int w, int h, bool pushDirtyOnly)
+{
+    width = w;
+    height = h;
+    dirtyOnly = pushDirtyOnly;
+}
+
+// Grow the bounding box of changed pixels with the rectangle (clipped to the screen).
+void SpriteDisplay::markDirty(int x, int y, int w, int h)
+{
+    int left = std::max(x, 0);
+    int top = std::max(y, 0);
+    int right = std::min(x + w, width);
+    int bottom = std::min(y + h, height);
+    if (left >= right || top >= bottom)
+    {
+        return;
+    }
+
+    if (x0 >= x1) // The box was empty.
+    {
+        x0 = left;
+        y0 = top;
+        x1 = right;
+        y1 = bottom;
+    }
+    else
+    {
+        x0 = std::min(x0, left);
+        y0 = std::min(y0, top);
+        x1 = std::max(x1, right);
+        y1 = std::max(y1, bottom);
+    }
+}
+
+void SpriteDisplay::fillScreen(uint16_t color)
+{
+    composeFill(color);
+    markDirty(0, 0, width, height);
+}
+
+void SpriteDisplay::fillRect(int x, int y, int w, int h, uint16_t color)
+{
+    composeFillRect(x, y, w, h, color);
+    markDirty(x, y, w, h);
+}
+
+void SpriteDisplay::drawRect(int x, int y, int w, int h, uint16_t color)
+{
+    composeDrawRect(x, y, w, h, color);
+    markDirty(x, y, w, h);
+}
+
+void SpriteDisplay::setCursor(int x, int y, int font)
+{
+    cursorX = x;
+    cursorY = y;
+    cursorFont = font;
+}
+
+void SpriteDisplay::print(const char *text)
+{
+    composeText(cursorX, cursorY, cursorFont, text);
+    // Font 1 is 6x8 pixels per character, font 4 about 14x26.
+    int length = strlen(text);
+    if (cursorFont == 4)
+    {
+        markDirty(cursorX, cursorY, length * 14, 26);
+    }
+    else
+    {
+        markDirty(cursorX, cursorY, length * 6, 8);
+    }
+}
+
+// Push the frame (or only its changed part) to the panel.
+void SpriteDisplay::present()
+{
+    if (x0 >= x1)
+    {
+        return; // Nothing changed since the last frame.
+    }
+
+    uint32_t start = hal.clock != nullptr ? hal.clock->micros() : 0;
+    if (dirtyOnly)
+    {
+        pushRegion(x0, y0, x1 - x0, y1 - y0);
+        pushedPixels += (x1 - x0) * (y1 - y0);
+    }
+    else
+    {
+        pushRegion(0, 0, width, height);
+        pushedPixels += width * height;
+    }
+    if (hal.clock != nullptr)
+    {
+        lastFrameMicros = hal.clock->micros() - start;
+    }
+    numFrames++;
+
+    // Start a new empty box.
+    x0 = 0;
+    y0 = 0;
+    x1 = 0;
+    y1 = 0;
+}
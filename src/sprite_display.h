@@ -0,0 +1,67 @@
+#pragma once
+
+#include "hal.h"
+
+// Render modes, selected at build time with -DRENDER_MODE=...
+#define RENDER_DIRECT 0       // Every draw call goes straight to the panel.
+#define RENDER_SPRITE 1       // The frame is composed off-screen and pushed whole once per frame.
+#define RENDER_SPRITE_DIRTY 2 // Like RENDER_SPRITE, but only the bounding box of the changed pixels is pushed.
+
+#ifndef RENDER_MODE
+#define RENDER_MODE RENDER_DIRECT
+#endif
+
+/** Display that composes the frame in an off-screen RGB565 buffer
+ * and sends it to the panel in one bulk write when the frame is presented.
+ * Subclasses draw into the buffer (compose methods) and push a region of it (pushRegion). */
+class SpriteDisplay : public Display
+{
+private:
+    int width;
+    int height;
+    bool dirtyOnly;
+
+    // Bounding box of the pixels changed since the last present (empty when x0 >= x1).
+    int x0 = 0;
+    int y0 = 0;
+    int x1 = 0;
+    int y1 = 0;
+
+    // Text cursor, the text extent is estimated from the font size.
+    int cursorX = 0;
+    int cursorY = 0;
+    int cursorFont = 1;
+
+    // Statistics
+    uint32_t numFrames = 0;
+    uint32_t pushedPixels = 0;
+    uint32_t lastFrameMicros = 0;
+
+    void markDirty(int x, int y, int w, int h);
+
+protected:
+    virtual void composeFill(uint16_t color) = 0;
+    virtual void composeFillRect(int x, int y, int w, int h, uint16_t color) = 0;
+    virtual void composeDrawRect(int x, int y, int w, int h, uint16_t color) = 0;
+    virtual void composeText(int x, int y, int font, const char *text) = 0;
+
+    // Send the region of the buffer to the panel in one transaction.
+    virtual void pushRegion(int x, int y, int w, int h) = 0;
+
+public:
+    SpriteDisplay(int w, int h, bool pushDirtyOnly);
+
+    void fillScreen(uint16_t color) override;
+    void fillRect(int x, int y, int w, int h, uint16_t color) override;
+    void drawRect(int x, int y, int w, int h, uint16_t color) override;
+    void setCursor(int x, int y, int font = 1) override;
+    void print(const char *text) override;
+    void present() override;
+
+    // Accessors
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    uint32_t getNumFrames() const { return numFrames; }
+    uint32_t getPushedPixels() const { return pushedPixels; }
+    uint32_t getLastFrameMicros() const { return lastFrameMicros; }
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stddef.h>
+#include <atomic>
+
+/** Lock-free queue between exactly one producer and one consumer thread (or core).
+ * The producer only writes tail and the consumer only writes head, so no locks are needed:
+ * a slot is filled before tail is released, and read before head is released.
+ * Capacity must be a power of two. Items are copied in and out, so the slots should be
+ * preallocated types (a copy into a slot with enough capacity does not allocate). */
+template <typename T, size_t Capacity>
+class SpscQueue
+{
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+private:
+    T slots[Capacity];
+    std::atomic<size_t> head{0}; // Next slot to read (written by the consumer).
+    std::atomic<size_t> tail{0}; // Next slot to write (written by the producer).
+
+public:
+    // Producer: copy the item into the queue. Returns false if the queue is full.
+    bool tryPush(const T &item)
+    {
+        size_t currentTail = tail.load(std::memory_order_relaxed);
+        if (currentTail - head.load(std::memory_order_acquire) == Capacity)
+        {
+            return false;
+        }
+        slots[currentTail & (Capacity - 1)] = item;
+        tail.store(currentTail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: copy the oldest item out of the queue. Returns false if the queue is empty.
+    bool tryPop(T &item)
+    {
+        size_t currentHead = head.load(std::memory_order_relaxed);
+        if (currentHead == tail.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        item = slots[currentHead & (Capacity - 1)];
+        head.store(currentHead + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Number of items in the queue. Only exact when called from the producer or the consumer.
+    size_t size() const
+    {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+};
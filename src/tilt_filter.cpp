@@ -0,0 +1,99 @@
+#include <math.h>
+#include "tilt_filter.h"
+
+// Constructor of the TiltFilter class
+TiltFilter::TiltFilter(const TiltConfig &newConfig)
+{
+    config = newConfig;
+}
+
+// Forget the filtered tilt.
+void TiltFilter::reset()
+{
+    axes[0] = Axis();
+    axes[1] = Axis();
+    primed = false;
+}
+
+// Add a sample: the tilt to the right and down (in g) at the given time.
+void TiltFilter::addSample(uint32_t time, float right, float down)
+{
+    // The first sample is taken as it is. The next ones are weighted by the time since the previous one.
+    float weight = 1;
+    if (primed)
+    {
+        float elapsed = (float)(uint32_t)(time - lastSample);
+        weight = config.smoothingMs > 0 ? 1 - expf(-elapsed / config.smoothingMs) : 1;
+    }
+    primed = true;
+    lastSample = time;
+
+    filterAxis(axes[0], right, weight);
+    filterAxis(axes[1], down, weight);
+}
+
+// Low-pass filter one axis and update its direction with hysteresis.
+void TiltFilter::filterAxis(Axis &axis, float value, float weight)
+{
+    axis.filtered += weight * (value - axis.filtered);
+
+    int direction = 0;
+    if (axis.filtered > config.enterTilt)
+    {
+        direction = 1;
+    }
+    else if (axis.filtered < -config.enterTilt)
+    {
+        direction = -1;
+    }
+
+    if (direction != 0 && direction != axis.direction)
+    {
+        // Started moving, or tilted to the other side.
+        axis.direction = direction;
+        axis.stepNow = true;
+    }
+    else if (axis.direction != 0 && axis.filtered * axis.direction < config.leaveTilt)
+    {
+        axis.direction = 0;
+        axis.stepNow = false;
+    }
+}
+
+// The cursor steps that are due at the given time.
+CursorStep TiltFilter::step(uint32_t now)
+{
+    return {stepAxis(axes[0], now), stepAxis(axes[1], now)};
+}
+
+// The step of one axis that is due at the given time.
+int TiltFilter::stepAxis(Axis &axis, uint32_t now)
+{
+    if (axis.direction == 0)
+    {
+        return 0;
+    }
+    if (!axis.stepNow && (int32_t)(now - axis.nextStep) < 0)
+    {
+        return 0;
+    }
+    axis.stepNow = false;
+    axis.nextStep = now + repeatInterval(axis.filtered * axis.direction);
+    return axis.direction;
+}
+
+// Time until the next step, from slowRepeatMs at enterTilt down to fastRepeatMs at fastTilt.
+uint32_t TiltFilter::repeatInterval(float tilt) const
+{
+    float range = config.fastTilt - config.enterTilt;
+    float fraction = range > 0 ? (tilt - config.enterTilt) / range : 1;
+    if (fraction < 0)
+    {
+        fraction = 0;
+    }
+    else if (fraction > 1)
+    {
+        fraction = 1;
+    }
+    return config.slowRepeatMs - (uint32_t)(fraction * (float)(config.slowRepeatMs - config.fastRepeatMs));
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdint.h>
+
+// Default tuning of the tilt filter (tilt in g, times in ms).
+#define TILT_SMOOTHING_MS 40       // Time constant of the low-pass filter.
+#define TILT_ENTER 0.25            // Tilt that starts moving the cursor.
+#define TILT_LEAVE 0.15            // Tilt under which the cursor stops again (hysteresis).
+#define TILT_FAST 0.7              // Tilt at which the cursor repeats the fastest.
+#define CURSOR_REPEAT_SLOW_MS 350  // Time between two cursor steps at TILT_ENTER.
+#define CURSOR_REPEAT_FAST_MS 90   // Time between two cursor steps at TILT_FAST and more.
+
+// Tuning of a TiltFilter.
+struct TiltConfig
+{
+    float smoothingMs = TILT_SMOOTHING_MS;
+    float enterTilt = TILT_ENTER;
+    float leaveTilt = TILT_LEAVE;
+    float fastTilt = TILT_FAST;
+    uint32_t slowRepeatMs = CURSOR_REPEAT_SLOW_MS;
+    uint32_t fastRepeatMs = CURSOR_REPEAT_FAST_MS;
+};
+
+// Cursor steps of one tick: -1, 0 or 1 column and row.
+struct CursorStep
+{
+    int col;
+    int row;
+};
+
+/** Turns accelerometer samples into discrete cursor steps.
+ * The samples go through a low-pass filter (with the real time between them, so the sample rate does not matter).
+ * An axis starts moving above enterTilt and only stops under leaveTilt, so noise around the threshold does not
+ * make the cursor jitter. The first step comes right away, then the steps repeat faster the more the device is tilted. */
+class TiltFilter
+{
+private:
+    // Filter state of one axis.
+    struct Axis
+    {
+        float filtered = 0;
+        int direction = 0;     // -1, 0 or 1
+        uint32_t nextStep = 0; // Time of the next repeated step.
+        bool stepNow = false;  // The axis just started moving.
+    };
+
+    TiltConfig config;
+    Axis axes[2]; // Columns (right) and rows (down).
+    uint32_t lastSample = 0;
+    bool primed = false;
+
+    void filterAxis(Axis &axis, float value, float weight);
+    int stepAxis(Axis &axis, uint32_t now);
+    uint32_t repeatInterval(float tilt) const;
+
+public:
+    TiltFilter(const TiltConfig &newConfig = TiltConfig());
+
+    void setConfig(const TiltConfig &newConfig) { config = newConfig; }
+    const TiltConfig &getConfig() const { return config; }
+
+    // Forget the filtered tilt.
+    void reset();
+
+    // Add a sample: the tilt to the right and down (in g) at the given time.
+    void addSample(uint32_t time, float right, float down);
+
+    // The cursor steps that are due at the given time.
+    CursorStep step(uint32_t now);
+
+    // Filtered tilt to the right and down.
+    float getRight() const { return axes[0].filtered; }
+    float getDown() const { return axes[1].filtered; }
+};
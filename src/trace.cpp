@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include "trace.h"
+
+// Write the dump line of a record: the fields as hex, start and value with 8 digits, the bytes with 2.
+void formatTraceRecord(const TraceRecord &record, char *line, size_t size)
+{
+    snprintf(line, size, "trace %08x%08x%02x%02x%02x00", (unsigned)record.start, (unsigned)record.value,
+             (unsigned)record.nameId, (unsigned)record.type, (unsigned)record.thread);
+}
+
+// Read the hex digits of a dump line, after "trace ".
+bool parseTraceRecord(const char *hex, TraceRecord &record)
+{
+    uint32_t words[5] = {};
+    const int digits[5] = {8, 8, 2, 2, 2};
+    for (int field = 0; field < 5; field++)
+    {
+        for (int i = 0; i < digits[field]; i++)
+        {
+            char c = *hex++;
+            int nibble = c >= '0' && c <= '9' ? c - '0' : (c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1);
+            if (nibble < 0)
+            {
+                return false;
+            }
+            words[field] = words[field] << 4 | nibble;
+        }
+    }
+    record.start = words[0];
+    record.value = words[1];
+    record.nameId = words[2];
+    record.type = words[3];
+    record.thread = words[4];
+    return true;
+}
+
+#ifdef TRACE
+
+#ifndef ARDUINO
+#include <chrono>
+
+// Nanoseconds of the steady clock.
+uint32_t traceTicks()
+{
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// Number of the calling thread, in the order the threads first traced something.
+uint8_t traceThread()
+{
+    static std::atomic<int> numThreads{0};
+    thread_local int thread = numThreads.fetch_add(1);
+    return thread;
+}
+#endif
+
+Tracer tracer;
+
+// Give a name its id. The names after the first TRACE_MAX_NAMES share the last id.
+uint8_t Tracer::registerName(const char *name)
+{
+    int id = numNames.fetch_add(1);
+    if (id >= TRACE_MAX_NAMES)
+    {
+        numNames = TRACE_MAX_NAMES;
+        return TRACE_MAX_NAMES - 1;
+    }
+    names[id].store(name, std::memory_order_release);
+    return id;
+}
+
+#endif
@@ -0,0 +1,241 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+
+/** Tracing of the hot paths: timed spans and counters, kept in a lock-free ring buffer and dumped as text lines.
+ * Build with -DTRACE to turn it on. Without it the macros are empty and nothing of the tracer is compiled in.
+ *
+ *   TRACE_SCOPE("flood fill");           // Span from here to the end of the scope.
+ *   TRACE_COUNTER("dropped frames", n);  // Value of a counter at this time.
+ *
+ * Times are in ticks: the cycle counter of the core on the device, nanoseconds on the host.
+ * Tracer::drain writes the new events as lines that bench/trace_decode.cpp turns into Chrome trace JSON:
+ *   trace-clock <ticks per us>
+ *   trace-name <id> <name>
+ *   trace <24 hex digits: the TraceRecord>
+ *   trace-lost <events overwritten or skipped since the last dump> */
+
+// Events the ring buffer holds (a power of two). When the dump falls behind, the oldest are overwritten.
+#ifndef TRACE_BUFFER_SIZE
+#define TRACE_BUFFER_SIZE 512
+#endif
+// Different names of spans and counters.
+#define TRACE_MAX_NAMES 64
+// Longest line Tracer::drain writes, with the terminating zero.
+#define TRACE_LINE_LENGTH 48
+
+enum TraceType
+{
+    TRACE_SPAN = 0,
+    TRACE_COUNT = 1,
+};
+
+// One event as it is dumped.
+struct TraceRecord
+{
+    uint32_t start = 0;  // Ticks when the span began, or when the counter was read.
+    uint32_t value = 0;  // Ticks the span took, or the value of the counter.
+    uint8_t nameId = 0;
+    uint8_t type = TRACE_SPAN;
+    uint8_t thread = 0;  // Core on the device, thread on the host.
+};
+
+// Write the dump line of a record ("trace " and its hex digits).
+void formatTraceRecord(const TraceRecord &record, char *line, size_t size);
+// Read the hex digits of a dump line, after "trace ". Returns false if they are not a record.
+bool parseTraceRecord(const char *hex, TraceRecord &record);
+
+#ifdef TRACE
+
+#ifdef ARDUINO
+#include <freertos/FreeRTOS.h>
+#define TRACE_TICKS_PER_US (F_CPU / 1000000)
+
+// Cycle counter of the core. Wraps every 18 s at 240 MHz, the decoder unwraps it.
+static inline uint32_t traceTicks()
+{
+    uint32_t ccount;
+    __asm__ __volatile__("rsr %0, ccount" : "=a"(ccount));
+    return ccount;
+}
+
+static inline uint8_t traceThread()
+{
+    return xPortGetCoreID();
+}
+#else
+#define TRACE_TICKS_PER_US 1000
+
+// Nanoseconds of the steady clock.
+uint32_t traceTicks();
+// Number of the calling thread, in the order the threads first traced something.
+uint8_t traceThread();
+#endif
+
+/** Ring buffer of the trace events, written by any thread without locks.
+ * A writer takes the next slot with one atomic increment. Every slot carries the number of the event in it,
+ * stored last, so the dump skips the slots that are being written or were overwritten while it read them. */
+class Tracer
+{
+private:
+    struct Slot
+    {
+        std::atomic<uint32_t> sequence{0}; // Number of the event + 1, 0 while it is written.
+        std::atomic<uint32_t> start{0};
+        std::atomic<uint32_t> value{0};
+        std::atomic<uint32_t> info{0}; // nameId, type and thread.
+    };
+
+    Slot slots[TRACE_BUFFER_SIZE];
+    std::atomic<uint32_t> head{0}; // Events recorded so far.
+    std::atomic<const char *> names[TRACE_MAX_NAMES] = {};
+    std::atomic<int> numNames{0};
+
+    // Dump side.
+    uint32_t tail = 0; // Next event to dump.
+    uint32_t numLost = 0;
+    int numDumpedNames = 0;
+
+    static_assert((TRACE_BUFFER_SIZE & (TRACE_BUFFER_SIZE - 1)) == 0, "TRACE_BUFFER_SIZE must be a power of two");
+
+public:
+    // Give a name its id. Called once per TRACE_ macro, the name must stay valid (a literal).
+    uint8_t registerName(const char *name);
+
+    void record(uint8_t nameId, TraceType type, uint32_t start, uint32_t value)
+    {
+        uint32_t number = head.fetch_add(1, std::memory_order_relaxed);
+        Slot &slot = slots[number & (TRACE_BUFFER_SIZE - 1)];
+        slot.sequence.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.start.store(start, std::memory_order_relaxed);
+        slot.value.store(value, std::memory_order_relaxed);
+        slot.info.store(nameId | type << 8 | traceThread() << 16, std::memory_order_relaxed);
+        slot.sequence.store(number + 1, std::memory_order_release);
+    }
+
+    /** Write the events recorded since the last call, and the names registered since, as dump lines.
+     * writeLine(line) returns false when the output has no room for it: the dump stops there and the events left
+     * are dumped next time, or counted as lost once they are overwritten. Call from one thread only.
+     * Returns the number of events written. */
+    template <typename Writer>
+    int drain(Writer writeLine);
+};
+
+template <typename Writer>
+int Tracer::drain(Writer writeLine)
+{
+    char line[TRACE_LINE_LENGTH];
+    int registered = numNames.load(std::memory_order_acquire);
+    if (numDumpedNames < registered)
+    {
+        snprintf(line, sizeof(line), "trace-clock %u", (unsigned)TRACE_TICKS_PER_US);
+        if (!writeLine(line))
+        {
+            return 0;
+        }
+    }
+    while (numDumpedNames < registered)
+    {
+        const char *name = names[numDumpedNames].load(std::memory_order_acquire);
+        if (name == nullptr)
+        {
+            break; // Still being registered.
+        }
+        snprintf(line, sizeof(line), "trace-name %d %.32s", numDumpedNames, name);
+        if (!writeLine(line))
+        {
+            return 0;
+        }
+        numDumpedNames++;
+    }
+
+    uint32_t end = head.load(std::memory_order_acquire);
+    if (end - tail > TRACE_BUFFER_SIZE)
+    {
+        numLost += end - tail - TRACE_BUFFER_SIZE;
+        tail = end - TRACE_BUFFER_SIZE;
+    }
+    int numWritten = 0;
+    for (; tail != end; tail++)
+    {
+        Slot &slot = slots[tail & (TRACE_BUFFER_SIZE - 1)];
+        TraceRecord record;
+        uint32_t sequence = slot.sequence.load(std::memory_order_acquire);
+        record.start = slot.start.load(std::memory_order_relaxed);
+        record.value = slot.value.load(std::memory_order_relaxed);
+        uint32_t info = slot.info.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence == 0 || (int32_t)(sequence - (tail + 1)) < 0)
+        {
+            break; // Still being written, it is dumped next time.
+        }
+        if (sequence != tail + 1 || slot.sequence.load(std::memory_order_relaxed) != sequence)
+        {
+            numLost++; // Overwritten by a newer event.
+            continue;
+        }
+        record.nameId = info & 0xFF;
+        record.type = (info >> 8) & 0xFF;
+        record.thread = (info >> 16) & 0xFF;
+        formatTraceRecord(record, line, sizeof(line));
+        if (!writeLine(line))
+        {
+            break;
+        }
+        numWritten++;
+    }
+
+    if (numLost > 0)
+    {
+        snprintf(line, sizeof(line), "trace-lost %u", (unsigned)numLost);
+        if (writeLine(line))
+        {
+            numLost = 0;
+        }
+    }
+    return numWritten;
+}
+
+// The tracer of the program.
+extern Tracer tracer;
+
+// Span from its construction to the end of the scope.
+class TraceScope
+{
+private:
+    uint8_t nameId;
+    uint32_t start;
+
+public:
+    explicit TraceScope(uint8_t id) : nameId(id), start(traceTicks()) {}
+    ~TraceScope() { tracer.record(nameId, TRACE_SPAN, start, traceTicks() - start); }
+};
+
+#define TRACE_JOIN2(a, b) a##b
+#define TRACE_JOIN(a, b) TRACE_JOIN2(a, b)
+#define TRACE_SCOPE(name)                                                           \
+    static const uint8_t TRACE_JOIN(traceId, __LINE__) = tracer.registerName(name); \
+    TraceScope TRACE_JOIN(traceScope, __LINE__)(TRACE_JOIN(traceId, __LINE__))
+#define TRACE_COUNTER(name, value)                                            \
+    do                                                                        \
+    {                                                                         \
+        static const uint8_t traceId = tracer.registerName(name);             \
+        tracer.record(traceId, TRACE_COUNT, traceTicks(), (uint32_t)(value)); \
+    } while (0)
+
+#else
+
+#define TRACE_SCOPE(name) \
+    do                    \
+    {                     \
+    } while (0)
+#define TRACE_COUNTER(name, value) \
+    do                             \
+    {                              \
+    } while (0)
+
+#endif
@@ -0,0 +1,39 @@
+#include "transposition.h"
+
+// Constructor of the TranspositionTable class.
+TranspositionTable::TranspositionTable(int sizeBits) : slots(new Slot[(size_t)1 << sizeBits]), mask(((uint64_t)1 << sizeBits) - 1)
+{
+}
+
+// Key mixed into the check word, so that the entries of other generations do not match.
+uint64_t TranspositionTable::generationKey() const
+{
+    return (uint64_t)generation.load(std::memory_order_relaxed) * 0xD6E8FEB86659FD93ULL;
+}
+
+// Look the position up.
+bool TranspositionTable::probe(uint64_t key, TranspositionEntry &entry) const
+{
+    const Slot &slot = slots[key & mask];
+    uint64_t check = slot.check.load(std::memory_order_relaxed);
+    uint64_t data = slot.data.load(std::memory_order_relaxed);
+    if ((check ^ data ^ generationKey()) != key)
+    {
+        return false;
+    }
+    entry.score = (int32_t)(uint32_t)data;
+    entry.depth = (data >> 32) & 0xFFFF;
+    int move = data >> 48;
+    entry.move = move == 0xFFFF ? -1 : move;
+    return true;
+}
+
+// Put the position in the table.
+void TranspositionTable::store(uint64_t key, const TranspositionEntry &entry)
+{
+    uint64_t data = (uint64_t)(uint32_t)entry.score | ((uint64_t)(entry.depth & 0xFFFF) << 32) |
+                    ((uint64_t)(entry.move & 0xFFFF) << 48);
+    Slot &slot = slots[key & mask];
+    slot.data.store(data, std::memory_order_relaxed);
+    slot.check.store(key ^ data ^ generationKey(), std::memory_order_relaxed);
+}
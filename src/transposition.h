@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+
+// What a search stored about a position.
+struct TranspositionEntry
+{
+    int32_t score = 0; // Meaning is up to the search, e.g. the score with which it reached the position.
+    int depth = 0;     // Moves played to reach the position, or searched below it (at most 0xFFFF).
+    int move = -1;     // Cell of the best move found from the position, -1 if none (at most 0xFFFE).
+};
+
+/** Fixed-size table of positions keyed by their Zobrist hash, shared by any number of threads without locks.
+ * Every slot holds two 64-bit words: the packed entry, and the entry XOR the key (and the generation).
+ * A probe only accepts a slot whose two words give back its key, so a slot that another thread was writing
+ * at the same time reads as a miss instead of a mix of two entries. A store always replaces the slot.
+ * newSearch() starts a new generation: the entries of the previous ones read as misses, without clearing the table.
+ * Lock-free where 64-bit atomics are (the host); on the ESP32 they are emulated, which is still correct. */
+class TranspositionTable
+{
+private:
+    struct Slot
+    {
+        std::atomic<uint64_t> check{0};
+        std::atomic<uint64_t> data{0};
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    uint64_t mask;
+    std::atomic<uint32_t> generation{1};
+
+    uint64_t generationKey() const;
+
+public:
+    // Table of 2^sizeBits slots, 16 bytes each. Allocated once, here.
+    explicit TranspositionTable(int sizeBits);
+
+    // Look the position up. Returns true and fills entry if it is in the table for the current generation.
+    bool probe(uint64_t key, TranspositionEntry &entry) const;
+
+    // Put the position in the table, in place of whatever was in its slot.
+    void store(uint64_t key, const TranspositionEntry &entry);
+
+    // Forget all entries in O(1). Call while no other thread uses the table.
+    void newSearch() { generation++; }
+
+    uint64_t getNumSlots() const { return mask + 1; }
+};
@@ -0,0 +1,245 @@
+#include <string.h>
+#include "undo_history.h"
+
+// Size of the fixed part of a diff.
+static const int DIFF_HEADER_SIZE = 13;
+
+static void put16(uint8_t *bytes, int value)
+{
+    bytes[0] = value & 0xFF;
+    bytes[1] = (value >> 8) & 0xFF;
+}
+
+static int get16(const uint8_t *bytes)
+{
+    return bytes[0] | (bytes[1] << 8);
+}
+
+// Constructor of the UndoHistory class. The arena is allocated here, once.
+UndoHistory::UndoHistory() : arena(UNDO_ARENA_SIZE), entries(UNDO_MAX_MOVES)
+{
+}
+
+// Forget all moves.
+void UndoHistory::clear()
+{
+    firstEntry = 0;
+    numEntries = 0;
+    numApplied = 0;
+    head = 0;
+}
+
+// Check if the diff of an entry uses some of the bytes [offset, offset + size).
+bool UndoHistory::overlaps(const Entry &entry, int offset, int size) const
+{
+    return entry.offset < offset + size && offset < entry.offset + entry.size;
+}
+
+// Record the move that removed the given cells of the board, before the board collapses.
+bool UndoHistory::record(const PackedBoard &board, const std::vector<int> &removedCells, int firstCol, int lastCol,
+                         uint8_t blockType, int cursorCol, int cursorRow)
+{
+    int height = board.getHeight();
+    int numCols = lastCol - firstCol + 1;
+    int vanishedBytes = (numCols + 7) / 8;
+    int removedBytes = (numCols * height + 7) / 8;
+    int size = DIFF_HEADER_SIZE + vanishedBytes + removedBytes;
+    if (size > (int)arena.size())
+    {
+        clear();
+        return false;
+    }
+
+    // The undone moves can not be redone after a new move.
+    numEntries = numApplied;
+    if (numEntries > 0)
+    {
+        const Entry &last = entries[(firstEntry + numEntries - 1) % UNDO_MAX_MOVES];
+        head = last.offset + last.size;
+    }
+
+    // The diff goes after the previous one, or at the start of the arena if it does not fit there.
+    // The oldest moves are dropped until none of the kept ones uses those bytes.
+    int offset = head + size > (int)arena.size() ? 0 : head;
+    for (;;)
+    {
+        bool overlap = false;
+        for (int i = 0; i < numEntries && !overlap; i++)
+        {
+            overlap = overlaps(entries[(firstEntry + i) % UNDO_MAX_MOVES], offset, size);
+        }
+        if (!overlap && numEntries < UNDO_MAX_MOVES)
+        {
+            break;
+        }
+        firstEntry = (firstEntry + 1) % UNDO_MAX_MOVES;
+        numEntries--;
+    }
+
+    uint8_t *bytes = &arena[offset];
+    put16(bytes, firstCol);
+    put16(bytes + 2, numCols);
+    put16(bytes + 4, cursorCol);
+    put16(bytes + 6, cursorRow);
+    int32_t numRemoved = removedCells.size();
+    memcpy(bytes + 8, &numRemoved, 4);
+    bytes[12] = blockType;
+
+    uint8_t *vanished = bytes + DIFF_HEADER_SIZE;
+    uint8_t *removed = vanished + vanishedBytes;
+    memset(vanished, 0, vanishedBytes + removedBytes);
+    for (int col = firstCol; col <= lastCol; col++)
+    {
+        bool empty = true;
+        const uint8_t *cells = board.column(col);
+        for (int row = 0; row < height && empty; row++)
+        {
+            empty = cells[row] == EMPTY_CELL;
+        }
+        if (empty)
+        {
+            int bit = col - firstCol;
+            vanished[bit / 8] |= 1 << (bit % 8);
+        }
+    }
+    for (int cellIndex : removedCells)
+    {
+        int bit = cellIndex - firstCol * height; // Cells are packed column after column, like the board.
+        removed[bit / 8] |= 1 << (bit % 8);
+    }
+
+    entries[(firstEntry + numEntries) % UNDO_MAX_MOVES] = {(uint16_t)offset, (uint16_t)size};
+    numEntries++;
+    numApplied = numEntries;
+    head = offset + size;
+    return true;
+}
+
+// Read the diff of an entry.
+MoveDiff UndoHistory::readDiff(const Entry &entry) const
+{
+    const uint8_t *bytes = &arena[entry.offset];
+    MoveDiff diff;
+    diff.firstCol = get16(bytes);
+    diff.numCols = get16(bytes + 2);
+    diff.cursorCol = get16(bytes + 4);
+    diff.cursorRow = get16(bytes + 6);
+    memcpy(&diff.numRemoved, bytes + 8, 4);
+    diff.blockType = bytes[12];
+    diff.vanished = bytes + DIFF_HEADER_SIZE;
+    diff.removed = diff.vanished + (diff.numCols + 7) / 8;
+    return diff;
+}
+
+// Diff of the last applied move. Only call when canUndo().
+MoveDiff UndoHistory::undo()
+{
+    numApplied--;
+    return readDiff(entries[(firstEntry + numApplied) % UNDO_MAX_MOVES]);
+}
+
+// Diff of the first undone move. Only call when canRedo().
+MoveDiff UndoHistory::redo()
+{
+    numApplied++;
+    return readDiff(entries[(firstEntry + numApplied - 1) % UNDO_MAX_MOVES]);
+}
+
+// Put the board back as it was before the move of the diff.
+ColumnRange undoMove(PackedBoard &board, const MoveDiff &diff)
+{
+    int width = board.getWidth();
+    int height = board.getHeight();
+    int firstCol = diff.firstCol;
+    int lastCol = diff.firstCol + diff.numCols - 1;
+
+    int numVanished = 0;
+    for (int col = firstCol; col <= lastCol; col++)
+    {
+        numVanished += diff.isVanished(col);
+    }
+
+    /** Every column from firstCol on comes from the column of the board after the move that is as many columns
+     * to the left as there are vanished columns before it. Going from the right to the left,
+     * a column is always read before it gets overwritten. */
+    int vanishedBefore = numVanished;
+    for (int col = width - 1; col >= firstCol; col--)
+    {
+        uint8_t *cells = board.column(col);
+        if (col > lastCol)
+        {
+            if (numVanished > 0)
+            {
+                memcpy(cells, board.column(col - numVanished), height);
+            }
+            continue;
+        }
+
+        if (diff.isVanished(col))
+        {
+            // Only the removed blocks were in this column.
+            vanishedBefore--;
+            for (int row = 0; row < height; row++)
+            {
+                cells[row] = diff.isRemoved(col, row, height) ? diff.blockType : EMPTY_CELL;
+            }
+            continue;
+        }
+
+        /** The removed blocks go back in their rows, the blocks that fell go back on top of them: the block of a row
+         * fell by the number of removed blocks below it. Going from the top down, a row is always read before it gets
+         * overwritten, so the column is rebuilt in place, whatever its height. */
+        const uint8_t *fallen = board.column(col - vanishedBefore);
+        int removedBelow = 0;
+        for (int row = 0; row < height; row++)
+        {
+            removedBelow += diff.isRemoved(col, row, height);
+        }
+        for (int row = 0; row < height; row++)
+        {
+            if (diff.isRemoved(col, row, height))
+            {
+                cells[row] = diff.blockType;
+                removedBelow--;
+            }
+            else
+            {
+                cells[row] = fallen[row + removedBelow];
+            }
+        }
+    }
+
+    // Without vanished columns only the touched ones changed, otherwise all the non-empty ones after them shifted.
+    ColumnRange changed = {firstCol, lastCol};
+    if (numVanished > 0)
+    {
+        changed.last = width - 1;
+        while (changed.last > lastCol && board.isColumnEmpty(changed.last))
+        {
+            changed.last--;
+        }
+    }
+    return changed;
+}
+
+// Apply the move of the diff again.
+ColumnRange redoMove(PackedBoard &board, const MoveDiff &diff, uint64_t *hash)
+{
+    int height = board.getHeight();
+    int lastCol = diff.firstCol + diff.numCols - 1;
+    for (int col = diff.firstCol; col <= lastCol; col++)
+    {
+        for (int row = 0; row < height; row++)
+        {
+            if (diff.isRemoved(col, row, height))
+            {
+                if (hash)
+                {
+                    *hash ^= zobristKey(board.index(col, row), diff.blockType);
+                }
+                board.erase(col, row);
+            }
+        }
+    }
+    return board.collapse(diff.firstCol, lastCol, hash);
+}
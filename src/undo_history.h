@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "board.h"
+
+// Size of the history: the bytes of all diffs, and the number of moves.
+#define UNDO_ARENA_SIZE 4096
+#define UNDO_MAX_MOVES 128
+
+/** Diff of one move, as it is stored in the arena of an UndoHistory.
+ *
+ *   firstCol     2 bytes  first column the move touched
+ *   numCols      2 bytes  number of columns it touched
+ *   cursorCol    2 bytes  the clicked cell
+ *   cursorRow    2 bytes
+ *   numRemoved   4 bytes  number of blocks removed (the score of the move)
+ *   blockType    1 byte   type of the removed blocks
+ *   vanished     bits     per touched column, 1 if the move removed all its blocks (it was shifted out)
+ *   removed      bits     per touched cell (column after column), 1 if its block was removed
+ *
+ * Together with the board after the move, this gives back the board before it:
+ * the vanished columns are the column permutation of the collapse, and the removed blocks all had the same type. */
+struct MoveDiff
+{
+    int firstCol;
+    int numCols;
+    int cursorCol;
+    int cursorRow;
+    int32_t numRemoved;
+    uint8_t blockType;
+    const uint8_t *vanished;
+    const uint8_t *removed;
+
+    bool isVanished(int col) const
+    {
+        int bit = col - firstCol;
+        return (vanished[bit / 8] >> (bit % 8)) & 1;
+    }
+    bool isRemoved(int col, int row, int height) const
+    {
+        int bit = (col - firstCol) * height + row;
+        return (removed[bit / 8] >> (bit % 8)) & 1;
+    }
+};
+
+/** Undo/redo history of a board: the diffs of the last moves in a fixed-size ring arena.
+ * The arena is allocated once, so recording a move never allocates. When it is full, the oldest moves are dropped.
+ * A new move drops the moves that were undone. */
+class UndoHistory
+{
+private:
+    struct Entry
+    {
+        uint16_t offset;
+        uint16_t size;
+    };
+
+    std::vector<uint8_t> arena;
+    std::vector<Entry> entries; // Ring of the recorded moves, oldest first from firstEntry.
+    int firstEntry = 0;
+    int numEntries = 0; // Recorded moves.
+    int numApplied = 0; // Moves that are on the board: the ones after them were undone.
+    int head = 0;       // Where the next diff goes in the arena.
+
+    MoveDiff readDiff(const Entry &entry) const;
+    bool overlaps(const Entry &entry, int offset, int size) const;
+
+public:
+    UndoHistory();
+
+    // Forget all moves.
+    void clear();
+
+    /** Record the move that removed the given cells of the board, before the board collapses.
+     * Returns false (and clears the history) if the diff does not fit in the arena. */
+    bool record(const PackedBoard &board, const std::vector<int> &removedCells, int firstCol, int lastCol,
+                uint8_t blockType, int cursorCol, int cursorRow);
+
+    bool canUndo() const { return numApplied > 0; }
+    bool canRedo() const { return numApplied < numEntries; }
+
+    // Diff of the move to undo (the last applied one) or to redo (the first undone one), and step over it.
+    MoveDiff undo();
+    MoveDiff redo();
+
+    int getNumMoves() const { return numEntries; }
+};
+
+/** Put the board back as it was before the move of the diff. The board must have been settled before the move.
+ * Returns the range of columns that changed. */
+ColumnRange undoMove(PackedBoard &board, const MoveDiff &diff);
+
+// Apply the move of the diff again, and update the Zobrist hash if it is given. Returns the range of columns that changed.
+ColumnRange redoMove(PackedBoard &board, const MoveDiff &diff, uint64_t *hash = nullptr);